@@ -0,0 +1,27 @@
+#version 450
+
+//position only stream of the geometry pool, quantized like CompactVertex, the model matrix dequantizes it
+layout(location = 0) in vec3 position;
+
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo{
+    mat4 projectionViewMatrix;
+    vec3 directionLight;
+} ubo;
+
+//one per object, indexed by the first instance of its draws. normalMatrix holds the columns of the 3x3 one
+struct Instance{
+    mat4 modelMatrix;
+    vec4 normalMatrix[3];
+    uint textureIndex;
+    uint padding[3];
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Instances{
+    Instance instances[];
+};
+
+void main(){
+    gl_Position = ubo.projectionViewMatrix * instances[gl_InstanceIndex].modelMatrix * vec4(position, 1.0);
+}
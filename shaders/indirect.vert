@@ -0,0 +1,63 @@
+#version 450
+
+//CompactVertex: position is [0, 1] inside the mesh's quantization box, the model matrix dequantizes it.
+//normal is octahedral encoded, color and uv arrive as floats already
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 uv_out;
+//slot of the object's texture in the global texture table
+layout(location = 2) flat out uint textureIndex;
+//the depth pre-pass computes the same position, EQUAL depth testing needs it bit exact
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo{
+    mat4 projectionViewMatrix;
+    vec3 directionLight;
+} ubo;
+
+struct ObjectData{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 boundingSphere;
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    uint block;
+    uint firstMeshlet;
+    uint meshletCount;
+    uint meshletVisibility;
+    uint textureIndex;
+};
+
+//firstInstance of every indirect draw is the object index
+layout(std430, set = 1, binding = 0) readonly buffer Objects{
+    ObjectData objects[];
+};
+
+const float AMBIENT = 0.05;
+
+vec3 octahedralDecode(vec2 encoded){
+    vec3 decoded = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    //lower half was folded over the corners
+    float fold = max(-decoded.z, 0.0);
+    decoded.x += decoded.x >= 0.0 ? -fold : fold;
+    decoded.y += decoded.y >= 0.0 ? -fold : fold;
+    return normalize(decoded);
+}
+
+void main(){
+    ObjectData object = objects[gl_InstanceIndex];
+    gl_Position = ubo.projectionViewMatrix * object.modelMatrix * vec4(position, 1.0);
+
+    vec3 normalWorldSpace = normalize(mat3(object.normalMatrix) * octahedralDecode(normal));
+
+    float lightIntensity = max(dot(normalWorldSpace, ubo.directionLight), AMBIENT);
+    uv_out = uv;
+    textureIndex = object.textureIndex;
+
+    fragColor = lightIntensity * color.rgb;
+}
@@ -0,0 +1,35 @@
+#version 450
+
+//position only stream of the geometry pool, quantized like CompactVertex, the model matrix dequantizes it
+layout(location = 0) in vec3 position;
+
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo{
+    mat4 projectionViewMatrix;
+    vec3 directionLight;
+} ubo;
+
+struct ObjectData{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 boundingSphere;
+    uint firstIndex;
+    uint indexCount;
+    int vertexOffset;
+    uint block;
+    uint firstMeshlet;
+    uint meshletCount;
+    uint meshletVisibility;
+    uint textureIndex;
+};
+
+//firstInstance of every indirect draw is the object index
+layout(std430, set = 1, binding = 0) readonly buffer Objects{
+    ObjectData objects[];
+};
+
+void main(){
+    ObjectData object = objects[gl_InstanceIndex];
+    gl_Position = ubo.projectionViewMatrix * object.modelMatrix * vec4(position, 1.0);
+}
@@ -1,23 +1,29 @@
 #version 450
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 uv;
+layout(location = 2) flat in uint textureIndex;
 
 layout(location = 0) out vec4 outColor;
 
-layout(push_constant) uniform Push{
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
-
-layout(binding = 1) uniform sampler2D texSampler;
+//every texture of the scene, sized by TextureTable. the BINDLESS build is used with descriptor indexing, there
+//neighbouring fragments may read different slots. without it the index is the same for the whole draw
+layout(constant_id = 0) const uint TEXTURE_COUNT = 1;
+layout(set = 0, binding = 1) uniform sampler2D textures[TEXTURE_COUNT];
 
 vec3 gammaCorrection(vec3 inColor, float gamma){
     return pow(inColor.rgb, vec3(1.0/gamma));
 }
 
 void main() {
-    outColor = texture(texSampler, uv) * vec4(fragColor, 1.0);
+#ifdef BINDLESS
+    outColor = texture(textures[nonuniformEXT(textureIndex)], uv) * vec4(fragColor, 1.0);
+#else
+    outColor = texture(textures[textureIndex], uv) * vec4(fragColor, 1.0);
+#endif
 //    outColor = texture(texSampler, uv);
 
     float gamma = 2.2;
@@ -1,37 +1,62 @@
 #version 450
 
+//CompactVertex: position is [0, 1] inside the mesh's quantization box, the model matrix dequantizes it.
+//normal is octahedral encoded, color and uv arrive as floats already
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 color;
-layout(location = 2) in vec3 normal;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 normal;
 layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 uv_out;
+//slot of the object's texture in the global texture table
+layout(location = 2) flat out uint textureIndex;
+//the depth pre-pass computes the same position, EQUAL depth testing needs it bit exact
+invariant gl_Position;
 
 layout(set = 0, binding = 0) uniform GlobalUbo{
     mat4 projectionViewMatrix;
     vec3 directionLight;
 } ubo;
 
-layout(push_constant) uniform Push{
+//one per object, indexed by the first instance of its draws. normalMatrix holds the columns of the 3x3 one
+struct Instance{
     mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
+    vec4 normalMatrix[3];
+    uint textureIndex;
+    uint padding[3];
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Instances{
+    Instance instances[];
+};
 
 const float AMBIENT = 0.05;
 
+vec3 octahedralDecode(vec2 encoded){
+    vec3 decoded = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    //lower half was folded over the corners
+    float fold = max(-decoded.z, 0.0);
+    decoded.x += decoded.x >= 0.0 ? -fold : fold;
+    decoded.y += decoded.y >= 0.0 ? -fold : fold;
+    return normalize(decoded);
+}
+
 void main(){
 //    gl_Position = vec4(mat3(push.transformation) * position + vec3(push.offset, 0.0), 1.0);
-    gl_Position = ubo.projectionViewMatrix * push.modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projectionViewMatrix * instances[gl_InstanceIndex].modelMatrix * vec4(position, 1.0);
 
 //    vec3 normalWorldSpace = normalize(mat3(push.modelMatrix) * normal);
     //optimize
 //    mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)));
-    vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
+    vec4 normalColumns[3] = instances[gl_InstanceIndex].normalMatrix;
+    mat3 normalMatrix = mat3(normalColumns[0].xyz, normalColumns[1].xyz, normalColumns[2].xyz);
+    vec3 normalWorldSpace = normalize(normalMatrix * octahedralDecode(normal));
 
     //only works in certain conditions
     float lightIntensity = max(dot(normalWorldSpace, ubo.directionLight), AMBIENT);
     uv_out = uv;
+    textureIndex = instances[gl_InstanceIndex].textureIndex;
 
-    fragColor = lightIntensity * color;
+    fragColor = lightIntensity * color.rgb;
 }
\ No newline at end of file
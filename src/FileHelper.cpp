@@ -2,8 +2,15 @@
 #include <fstream>
 #include <iostream>
 #include "FileHelper.h"
+#include "IO/AssetPack.h"
+
+std::vector<std::unique_ptr<AssetPack>> FileHelper::mountedPacks;
 
 std::vector<char> FileHelper::readFile(const std::string &filename) {
+    if (const AssetPack *pack = findMountedPack(filename)) {
+        return pack->read(*pack->find(filename));
+    }
+
     std::ifstream file(filename, std::ios::ate | std::ios::binary);
 
     if (!file.is_open()) {
@@ -20,3 +27,26 @@ std::vector<char> FileHelper::readFile(const std::string &filename) {
     file.close();
     return buffer;
 }
+
+bool FileHelper::mount(const std::string &packPath) {
+    std::ifstream file(packPath);
+    if (!file.is_open())
+        return false;
+    file.close();
+
+    //later mounts shadow earlier ones
+    mountedPacks.insert(mountedPacks.begin(), std::make_unique<AssetPack>(packPath));
+    return true;
+}
+
+void FileHelper::unmountAll() {
+    mountedPacks.clear();
+}
+
+const AssetPack *FileHelper::findMountedPack(const std::string &filename) {
+    for (const auto &pack : mountedPacks) {
+        if (pack->find(filename))
+            return pack.get();
+    }
+    return nullptr;
+}
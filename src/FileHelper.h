@@ -1,8 +1,18 @@
 #pragma once
+#include <memory>
 #include <string>
 #include <vector>
 
+class AssetPack;
+
 class FileHelper {
 public:
+    //files found in a mounted pack are served from it, everything else still comes from disk
     static std::vector<char> readFile(const std::string& filename);
-};
\ No newline at end of file
+    static bool mount(const std::string& packPath);
+    static void unmountAll();
+    static const AssetPack* findMountedPack(const std::string& filename);
+
+private:
+    static std::vector<std::unique_ptr<AssetPack>> mountedPacks;
+};
@@ -1,13 +1,27 @@
 #include "App.h"
 #include "systems/ImGuiRenderSystem.h"
+#include "systems/IndirectRenderSystem.h"
+#include "LodSelector.h"
+#include "StaticBatcher.h"
+#include "../FileHelper.h"
+
+#include <algorithm>
+#include <glm/geometric.hpp>
 
 App::App() {
+    if (FileHelper::mount("./assets.pak"))
+        log.printInfo("Mounted asset pack: ./assets.pak");
+    assetManager = std::make_unique<AssetManager>(device, geometryPool, workers, log);
+
+    //every global set holds the whole texture table, imgui takes one more sampler
     globalPool = lve::LveDescriptorPool::Builder(device)
             .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT * 3)
+            .setPoolFlags(textureTable.isBindless() ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0)
             .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT * (textureTable.getCapacity() + 1))
             .build();
     loadObjects();
+    buildStaticBatches();
     createCameraObject();
 }
 
@@ -40,20 +54,22 @@ void App::run() {
 
     auto globalSetLayout = lve::LveDescriptorSetLayout::Builder(device)
             .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
-            .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(TEXTURE_TABLE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT,
+                        textureTable.getCapacity(), textureTable.getBindingFlags())
             .build();
 
+    //the textures are written by the table at the start of every frame
     std::vector<VkDescriptorSet> globalDescriptorSetsList(SwapChain::MAX_FRAMES_IN_FLIGHT);
     for (int i = 0; i < globalDescriptorSetsList.size(); ++i) {
 
         auto bufferInfo = uboBuffers[i]->descriptorInfo();
-        auto imageInfo = objects[0].mesh->getTextureBuffer().descriptorInfo();
 
         lve::LveDescriptorWriter(*globalSetLayout, *globalPool)
                 .writeBuffer(0, &bufferInfo)
-                .writeImage(1, &imageInfo)
                 .build(globalDescriptorSetsList[i]);
     }
+    log.printInfo(std::string(textureTable.isBindless() ? "Bindless texture table" : "Bounded texture table") + " of " +
+                  std::to_string(textureTable.getCapacity()) + " textures");
 
     //loading texture
 //    VkDescriptorSet globalTextureDescriptorSet;
@@ -64,12 +80,32 @@ void App::run() {
 //    }
     //loading texture
 
-    BasicRenderSystem basicRenderSystem{device, renderer.getRenderPass(), globalSetLayout->getDescriptorSetLayout(), log};
+    BasicRenderSystem basicRenderSystem{device, renderer.getRenderPass(), globalSetLayout->getDescriptorSetLayout(), textureTable,
+                                        DEPTH_PRE_PASS, log, &workers};
+    //gpu driven path needs several draws per indirect call, otherwise every object is drawn from the cpu
+    std::unique_ptr<IndirectRenderSystem> indirectRenderSystem;
+    if (device.getFeatures().multiDrawIndirect) {
+        indirectRenderSystem = std::make_unique<IndirectRenderSystem>(device, geometryPool, renderer.getRenderPass(), globalSetLayout->getDescriptorSetLayout(),
+                                                                      textureTable, renderer.getSwapChainExtent(), DEPTH_PRE_PASS, log);
+        log.printInfo(device.getFeatures().drawIndirectCount ? "Rendering with indirect draw count" : "Rendering with multi draw indirect");
+    }
     ImGuiRenderSystem imGuiRenderSystem{mainWindow, device, log, renderer.getRenderPass(), globalPool->getDescriptorPool()};
 
     Object ViewerObject{};
     ViewerObject.transform.translation = {0, 0, -1};
     KeyboardMovementController cameraController{};
+    float cullingStatsTimer = 0.0f;
+    //of the last recorded frame
+    CommandRecorderStats recorderStats{};
+
+    //cpu fallback for occlusion culling when the gpu driven path is not available
+    SoftwareOcclusionCuller softwareOcclusionCuller{};
+    //the culler's last results stand for the current camera and scene
+    bool occlusionValid = false;
+    LodSelector lodSelector{};
+    //of the last frame, anything else means the camera moved
+    glm::mat4 lastProjectionView{0.0f};
+    float lastViewportHeight = 0.0f;
 
 
     while (!mainWindow.shouldClose()) {
@@ -84,39 +120,240 @@ void App::run() {
 //        mainCamera->setViewYXZ(ViewerObject.transform.translation, ViewerObject.transform.rotation);
         mainCamera->setViewYXZ(ViewerObject.transform.translation, ViewerObject.transform.rotation);
         mainCamera->setProspectiveProjection(glm::radians(50.f), renderer.getAspectRatio(), 0.1f, 10.0f);
+        glm::mat4 projectionView = mainCamera->getProjectionMatrix() * mainCamera->getViewMatrix();
+        auto viewportHeight = static_cast<float>(renderer.getSwapChainExtent().height);
+        bool cameraMoved = projectionView != lastProjectionView || viewportHeight != lastViewportHeight;
+        lastProjectionView = projectionView;
+        lastViewportHeight = viewportHeight;
+
+        //finished loads replace their placeholders here, between two frames, before anything reads the meshes
+        size_t pendingLoads = assetManager->getPendingLoadCount();
+        assetManager->updateAsyncLoads();
+        if (assetManager->getPendingLoadCount() != pendingLoads) {
+            sceneVersion++;
+            sceneChanged = true;
+            //the models were replaced in place, their geometry moved
+            changedObjects.markAll();
+        }
+        if (pendingLoads > 0 && assetManager->getPendingLoadCount() == 0)
+            assetManager->reportMemoryUsage();
+
+        //a still scene seen from a still camera keeps its matrices, levels and culling results
+        if (sceneChanged)
+            updateTransforms();
+        if (sceneChanged || cameraMoved) {
+            lodSelector.select(objects, sceneGraph, *mainCamera, viewportHeight);
+            changedObjects.mark(lodSelector.getChangedList());
+            //the cached draws are recorded at these levels and culled against both
+            sceneVersion++;
+        }
+        bool commandCache = COMMAND_CACHE && !indirectRenderSystem;
+
+        //occluders are rasterized and the objects tested on the workers while imgui and the frame setup run here
+        bool softwareCulling = false;
+        if (!indirectRenderSystem && (sceneChanged || cameraMoved)) {
+            std::vector<OccluderInstance> occludersList;
+            std::vector<OcclusionBounds> occlusionBoundsList;
+            softwareCulling = collectOcclusionInputs(occludersList, occlusionBoundsList);
+            if (softwareCulling)
+                softwareOcclusionCuller.cullAsync(workers, projectionView, std::move(occludersList), std::move(occlusionBoundsList));
+            occlusionValid = softwareCulling;
+        }
+        imGuiRenderSystem.buildImGui();
 
         auto commandBuffer = renderer.beginFrame();
         if (commandBuffer != nullptr){
             int frameIndex = renderer.getFrameIndex();
-            FrameInfo frameInfo{frameIndex, timestep, commandBuffer, *mainCamera, globalDescriptorSetsList[frameIndex]};
+
+            //textures of released models free their slots, new ones get one. the instances pick the slots up
+            uint64_t texturesVersion = textureTable.getVersion();
+            textureTable.releaseUnused();
+            if (sceneChanged) {
+                for (auto &obj : objects)
+                    textureTable.acquire(obj.mesh->getSharedTexture());
+            }
+            if (textureTable.getVersion() != texturesVersion)
+                changedObjects.markAll();
+            //the fence of this frame was waited on, so its set is not in use anymore
+            bool texturesWritten = textureTable.writeDescriptors(frameIndex, *globalSetLayout, *globalPool,
+                                                                 globalDescriptorSetsList[frameIndex], TEXTURE_TABLE_BINDING);
+            //without update after bind, updating a set invalidates every command buffer that bound it
+            if (texturesWritten && !textureTable.isBindless())
+                sceneVersion++;
+
+            CommandRecorder recorder{commandBuffer};
+            FrameInfo frameInfo{frameIndex, timestep, commandBuffer, recorder, *mainCamera, globalDescriptorSetsList[frameIndex], sceneGraph,
+                                textureTable, changedObjects};
 
             //update
             GlobalUBO ubo{};
-            ubo.projectionView = mainCamera->getProjectionMatrix() * mainCamera->getViewMatrix();
+            ubo.projectionView = projectionView;
             uboBuffers[frameIndex]->writeToBuffer(&ubo);
             uboBuffers[frameIndex]->flush();
 
+            //culling runs in compute, so it has to be recorded before the render pass
+            if (indirectRenderSystem)
+                indirectRenderSystem->cullGameObjects(frameInfo, objects, renderer.getSwapChainExtent());
+
             //render
-            renderer.beginRenderPass(commandBuffer);
+            renderer.beginRenderPass(recorder, commandCache ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+            const std::vector<uint8_t> *visibility = occlusionValid ? &softwareOcclusionCuller.waitForResults() : nullptr;
+            if (indirectRenderSystem)
+                indirectRenderSystem->renderGameObjects(frameInfo);
+            else if (commandCache)
+                basicRenderSystem.renderCachedGameObjects(frameInfo, objects, visibility, sceneVersion, renderer.getRenderPass(),
+                                                          renderer.getSwapChainExtent());
+            else
+                basicRenderSystem.renderGameObjects(frameInfo, objects, visibility);
+
+            renderer.endRenderPass(commandBuffer);
+
+            //depth pyramid of what was just drawn, then the objects hidden last frame get a second chance
+            if (indirectRenderSystem)
+                indirectRenderSystem->cullOccludedGameObjects(frameInfo, renderer.getCurrentDepthImageView());
 
-            basicRenderSystem.renderGameObjects(frameInfo, objects);
+            renderer.beginOverlayRenderPass(recorder);
+
+            if (indirectRenderSystem)
+                indirectRenderSystem->renderLateGameObjects(frameInfo);
             imGuiRenderSystem.renderImGui(frameInfo);
 
             renderer.endRenderPass(commandBuffer);
             renderer.endFrame();
+            recorderStats = recorder.getStats();
+            changedObjects.clear();
+            sceneChanged = false;
+        }
+        //a frame that was skipped still has to collect its results before the next cullAsync
+        if (softwareCulling)
+            softwareOcclusionCuller.waitForResults();
+
+        cullingStatsTimer += timestep;
+        if (cullingStatsTimer >= 2.0f) {
+            if (indirectRenderSystem) {
+                const auto &stats = indirectRenderSystem->getStats();
+                log.printInfo("Culling: " + std::to_string(stats.drawnEarly + stats.drawnLate) + " drawn (" +
+                              std::to_string(stats.drawnEarly) + " early, " + std::to_string(stats.drawnLate) + " late), " +
+                              std::to_string(stats.frustumCulled) + " outside the frustum, " +
+                              std::to_string(stats.occlusionCulled) + " occluded; triangles: " +
+                              std::to_string(stats.trianglesDrawn) + " drawn, " +
+                              std::to_string(stats.trianglesOcclusionCulled) + " saved by occlusion, " +
+                              std::to_string(stats.trianglesFrustumCulled) + " by the frustum");
+                log.printInfo("Meshlets: " + std::to_string(stats.meshletsDrawn) + " drawn, " +
+                              std::to_string(stats.meshletsFrustumCulled) + " outside the frustum, " +
+                              std::to_string(stats.meshletsBackfaceCulled) + " back facing, " +
+                              std::to_string(stats.meshletsOcclusionCulled) + " occluded; " +
+                              std::to_string(stats.trianglesBackfaceCulled) + " triangles saved by the cones");
+            } else {
+                if (occlusionValid) {
+                    const auto &stats = softwareOcclusionCuller.getStats();
+                    log.printInfo("Software occlusion: " + std::to_string(stats.occludedObjects) + " of " +
+                                  std::to_string(stats.testedObjects) + " objects occluded by " +
+                                  std::to_string(stats.rasterizedTriangles) + " occluder triangles");
+                }
+                const auto &meshletStats = basicRenderSystem.getMeshletStats();
+                log.printInfo("Meshlets: " + std::to_string(meshletStats.meshlets - meshletStats.frustumCulled - meshletStats.backfaceCulled) +
+                              " of " + std::to_string(meshletStats.meshlets) + " drawn, " +
+                              std::to_string(meshletStats.frustumCulled) + " outside the frustum, " +
+                              std::to_string(meshletStats.backfaceCulled) + " back facing; " +
+                              std::to_string(meshletStats.trianglesCulled) + " triangles saved");
+                if (commandCache) {
+                    const auto &cacheStats = basicRenderSystem.getCommandCacheStats();
+                    log.printInfo("Command cache: " + std::to_string(cacheStats.replayedFrames) + " frames replayed, " +
+                                  std::to_string(cacheStats.recordedFrames) + " recorded");
+                    basicRenderSystem.resetCommandCacheStats();
+                }
+                const auto &instanceStats = basicRenderSystem.getInstanceStats();
+                log.printInfo("Instances: " + std::to_string(instanceStats.uploadedInstances) + " of " +
+                              std::to_string(instanceStats.instances) + " uploaded in " +
+                              std::to_string(instanceStats.uploadedRanges) + " ranges");
+                const auto &queueStats = basicRenderSystem.getQueueStats();
+                log.printInfo("Render queue: " + std::to_string(queueStats.draws) + " draws, binds issued/avoided: pipeline " +
+                              std::to_string(queueStats.pipelineBinds) + "/" + std::to_string(queueStats.pipelineBindsAvoided) +
+                              ", descriptor set " + std::to_string(queueStats.descriptorSetBinds) + "/" +
+                              std::to_string(queueStats.descriptorSetBindsAvoided) + ", vertex buffer " +
+                              std::to_string(queueStats.vertexBufferBinds) + "/" + std::to_string(queueStats.vertexBufferBindsAvoided));
+            }
+            log.printInfo("Commands: " + std::to_string(recorderStats.getIssued()) + " issued, " +
+                          std::to_string(recorderStats.getFiltered()) + " filtered (pipelines " +
+                          std::to_string(recorderStats.filtered[BIND_PIPELINE]) + ", descriptor sets " +
+                          std::to_string(recorderStats.filtered[BIND_DESCRIPTOR_SETS]) + ", vertex buffers " +
+                          std::to_string(recorderStats.filtered[BIND_VERTEX_BUFFERS]) + ", index buffers " +
+                          std::to_string(recorderStats.filtered[BIND_INDEX_BUFFER]) + ", viewports " +
+                          std::to_string(recorderStats.filtered[SET_VIEWPORT]) + ", scissors " +
+                          std::to_string(recorderStats.filtered[SET_SCISSOR]) + ", push constants " +
+                          std::to_string(recorderStats.filtered[PUSH_CONSTANTS]) + ")");
+            const auto &transformStats = transforms.getStats();
+            const auto &sceneStats = sceneGraph.getStats();
+            log.printInfo("Transforms: " + std::to_string(transformStats.updated) + " of " +
+                          std::to_string(transformStats.transforms) + " rebuilt, " + std::to_string(sceneStats.updatedNodes) +
+                          " world matrices over " + std::to_string(sceneStats.levels) + " levels");
+            log.printInfo("Textures: " + std::to_string(textureTable.getUsedCount()) + " of " +
+                          std::to_string(textureTable.getCapacity()) + " slots in use");
+            const auto &lodStats = lodSelector.getStats();
+            log.printInfo("LOD: " + std::to_string(lodStats.reducedObjects) + " of " + std::to_string(lodStats.objects) +
+                          " objects reduced, " + std::to_string(lodStats.trianglesSelected) + " of " +
+                          std::to_string(lodStats.trianglesFull) + " triangles submitted, " +
+                          std::to_string(lodStats.trianglesFull - lodStats.trianglesSelected) + " saved per frame");
+            cullingStatsTimer = 0.0f;
         }
+        assetManager->collectGarbage();
     }
     vkDeviceWaitIdle(device.getDevice());
 }
 
+bool App::collectOcclusionInputs(std::vector<OccluderInstance> &_occluders, std::vector<OcclusionBounds> &_bounds) {
+    _bounds.reserve(objects.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        auto &obj = objects[i];
+        const glm::mat4 &modelMatrix = sceneGraph.getWorldMatrix(static_cast<uint32_t>(i));
+        if (obj.occluder)
+            _occluders.push_back({obj.occluder, modelMatrix});
+
+        //box around the world space bounding sphere
+        const glm::vec4 &sphere = obj.mesh->getBoundingSphere();
+        glm::vec3 center = modelMatrix * glm::vec4(glm::vec3(sphere), 1.0f);
+        float scale = std::max({glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])),
+                                glm::length(glm::vec3(modelMatrix[2]))});
+        glm::vec3 extent{sphere.w * scale};
+        _bounds.push_back({center - extent, center + extent});
+    }
+    return !_occluders.empty();
+}
+
+void App::updateTransforms() {
+    std::vector<uint32_t> parentsList(objects.size());
+    transforms.resize(static_cast<uint32_t>(objects.size()));
+    for (size_t i = 0; i < objects.size(); ++i) {
+        transforms.set(static_cast<uint32_t>(i), objects[i].transform);
+        uint32_t parent = objects.getIndex(objects[i].parent);
+        parentsList[i] = parent == SlotMap<Object>::INVALID_INDEX ? SceneGraph::NO_PARENT : parent;
+    }
+    transforms.update();
+    sceneGraph.setHierarchy(parentsList);
+    sceneGraph.update(transforms, &workers);
+    changedObjects.mark(sceneGraph.getUpdatedList());
+}
+
+void App::buildStaticBatches() {
+    //the batches are made from the real meshes, the placeholders would be merged otherwise
+    assetManager->finishAsyncLoads();
+    auto batchStats = StaticBatcher::build(*assetManager, workers, objects);
+    if (batchStats.batches > 0)
+        log.printInfo("Static batching: " + std::to_string(batchStats.objects) + " objects merged into " +
+                      std::to_string(batchStats.batches) + " batches of " + std::to_string(batchStats.triangles) + " triangles");
+    assetManager->reportMemoryUsage();
+}
+
 void App::loadObjects() {
     Object cube{};
-    auto model = Model::loadFromFile(device, "./models/viking_room.obj", "./textures/viking_room.png");
-
-    cube.mesh = std::move(model);
+    //draws a placeholder until the workers are done with the files
+    cube.mesh = assetManager->loadModelAsync("./models/viking_room.obj", "./textures/viking_room.png");
     cube.transform.rotation = {glm::half_pi<float>(), 0.0f, 0.0f};
     cube.transform.translation = {0.0f, 0.0f, 0.0f};
     cube.transform.scaleVector = {0.5f, 0.5f, 0.5f};
+    cube.isStatic = true;
 
-    objects.push_back(std::move(cube));
+    objects.insert(std::move(cube));
 }
@@ -18,6 +18,10 @@
 #include "systems/BasicRenderSystem.h"
 
 #include "imguiImports.h"
+#include "../Jobs/ThreadPool.h"
+#include "AssetManager.h"
+#include "TextureTable.h"
+#include "DirtyObjects.h"
 
 struct GlobalUBO {
     alignas(16) glm::mat4 projectionView{1.0f};
@@ -37,17 +41,58 @@ public:
     App &operator=(const App &) = delete;
 
 private:
+    //objects are drawn depth only first, then shaded with an EQUAL depth test. pays off when fragments are
+    //expensive or the scene has a lot of overdraw, costs a second pass over the vertices otherwise
+    static constexpr bool DEPTH_PRE_PASS = true;
+    //without the gpu driven path the culled draws are recorded into secondary command buffers and replayed while the
+    //scene version stays the same, so a still scene seen from a still camera costs next to no cpu per frame. moving
+    //either records again, at about the cost of drawing without the cache
+    static constexpr bool COMMAND_CACHE = true;
+    //texture array of the global set, the ubo is binding 0
+    static constexpr uint32_t TEXTURE_TABLE_BINDING = 1;
+
     void createCameraObject();
 
     void loadObjects();
+    //merges the static objects once their meshes are loaded. it reads them back from the gpu and imports the batches,
+    //so it runs while the scene is built instead of stalling a frame
+    void buildStaticBatches();
+    //occluders and test boxes for the software occlusion culler, false when no object is an occluder
+    bool collectOcclusionInputs(std::vector<OccluderInstance> &_occluders, std::vector<OcclusionBounds> &_bounds);
+    //hands every object's transform and parent to the transform system and the scene graph, and rebuilds the
+    //matrices of the objects that changed and of everything below them
+    void updateTransforms();
 
 private:
     Window mainWindow{600, 800, "SpectrareFX"};
     Device device{mainWindow, log};
     Logger log;
     int frame = 0;
-    std::vector<Object> objects;
+    //the position stream feeds the depth pre-pass
+    GeometryPool geometryPool{device, sizeof(CompactVertex), sizeof(CompactPosition)};
+    //slots of every texture the objects use, written into the global sets
+    TextureTable textureTable{device};
+    //declared before the objects so every handle is released before the manager goes away
+    std::unique_ptr<AssetManager> assetManager;
+    //systems walk the dense array and take dense indices, everything that has to outlive an erase keeps a handle
+    SlotMap<Object> objects;
+    //local matrices of the objects, by dense index
+    TransformSystem transforms;
+    //world matrices of the objects, by dense index
+    SceneGraph sceneGraph;
+    //bumped by everything that changes what the draws record: the camera and the objects they are culled with, the
+    //object list, lods, meshes and the global descriptor sets unless the texture table is bindless. texture slots
+    //only reach the instance buffer
+    uint64_t sceneVersion = 0;
+    //objects were added, erased, moved, reparented or had their meshes replaced since the last recorded frame. the
+    //transforms, texture slots, lods and occlusion culling are only redone while it is set or the camera moved, so
+    //whoever touches the objects sets it
+    bool sceneChanged = true;
+    //objects whose matrices, level, mesh or texture changed since the last recorded frame, the render systems only
+    //rewrite the gpu data of these
+    DirtyObjects changedObjects;
     Render renderer{mainWindow, device};
+    ThreadPool workers{};
 
     std::unique_ptr<lve::LveDescriptorPool> globalPool{};
     std::unique_ptr<Camera> mainCamera;
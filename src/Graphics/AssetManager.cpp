@@ -0,0 +1,472 @@
+#include "AssetManager.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#include <glm/geometric.hpp>
+
+#include "../FileHelper.h"
+#include "../IO/AssetPack.h"
+#include "../IO/BatchFileReader.h"
+#include "../IO/ContentHash.h"
+
+AssetManager::AssetManager(Device &_device, GeometryPool &_geometryPool, ThreadPool &_workers, const Logger &_log)
+        : device(_device), geometryPool(_geometryPool), workers(_workers), log(_log), releaseQueue(std::make_shared<ReleaseQueue>()) {}
+
+AssetManager::~AssetManager() {
+    vkDeviceWaitIdle(device.getDevice());
+
+    //the workers are joined by now, only finished loads can still hold decoded pixels
+    for (auto &load : asyncLoadsList) {
+        if (load->finished.load(std::memory_order_acquire))
+            load->textureBuilder.freeTexturePixels();
+    }
+
+    std::vector<std::pair<uint64_t, std::function<void()>>> pendingList;
+    {
+        std::lock_guard<std::mutex> lock(releaseQueue->mutex);
+        releaseQueue->alive = false;
+        pendingList.swap(releaseQueue->pendingList);
+    }
+    //models release their textures while being destroyed, those are deleted right away now
+    for (auto &pending : pendingList)
+        pending.second();
+}
+
+template<typename T>
+std::shared_ptr<T> AssetManager::makeHandle(std::unique_ptr<T> _asset) {
+    std::shared_ptr<ReleaseQueue> queue = releaseQueue;
+    return std::shared_ptr<T>(_asset.release(), [queue](T *asset) {
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            if (queue->alive) {
+                queue->pendingList.emplace_back(queue->currentFrame, [asset] { delete asset; });
+                return;
+            }
+        }
+        delete asset;
+    });
+}
+
+std::string AssetManager::makeModelKey(const std::string &_modelFilepath, const std::string &_textureFilepath) {
+    return AssetPack::normalizePath(_modelFilepath) + "|" + AssetPack::normalizePath(_textureFilepath);
+}
+
+std::shared_ptr<ImageBuffer> AssetManager::findTexture(const std::string &_path, uint64_t *_contentHash) {
+    auto hashIt = textureHashByPath.find(AssetPack::normalizePath(_path));
+    if (hashIt == textureHashByPath.end())
+        return nullptr;
+
+    auto cacheIt = texturesCache.find(hashIt->second);
+    if (cacheIt == texturesCache.end())
+        return nullptr;
+
+    if (_contentHash)
+        *_contentHash = hashIt->second;
+    return cacheIt->second.asset.lock();
+}
+
+std::shared_ptr<Model> AssetManager::loadModel(const std::string &_modelFilepath, const std::string &_textureFilepath) {
+    return loadModels({{_modelFilepath, _textureFilepath}})[0];
+}
+
+std::vector<std::shared_ptr<Model>> AssetManager::loadModels(const std::vector<ModelLoadInfo> &_loadInfos) {
+    struct PendingModel {
+        std::string key;
+        std::string texturePath;
+        Builder builder;
+        uint64_t contentHash = 0;
+        uint64_t textureHash = 0;
+        std::shared_ptr<ImageBuffer> texture;
+        std::vector<size_t> resultIndices;
+    };
+    struct PendingTexture {
+        std::string path;
+        Builder builder;
+        uint64_t contentHash = 0;
+    };
+
+    std::vector<std::shared_ptr<Model>> modelsList(_loadInfos.size());
+
+    //collect cache misses, the same model requested twice in one batch is loaded once
+    std::vector<PendingModel> pendingModels;
+    std::unordered_map<std::string, size_t> pendingModelByKey;
+    for (size_t i = 0; i < _loadInfos.size(); ++i) {
+        std::string key = makeModelKey(_loadInfos[i].modelFilepath, _loadInfos[i].textureFilepath);
+
+        auto hashIt = modelHashByKey.find(key);
+        if (hashIt != modelHashByKey.end()) {
+            auto cacheIt = modelsCache.find(hashIt->second);
+            if (cacheIt != modelsCache.end()) {
+                modelsList[i] = cacheIt->second.asset.lock();
+                if (modelsList[i])
+                    continue;
+            }
+        }
+        //a file still loading in the background is not read a second time, its handle gets the data once it is done
+        auto asyncIt = asyncModelsByKey.find(key);
+        if (asyncIt != asyncModelsByKey.end()) {
+            modelsList[i] = asyncIt->second.lock();
+            if (modelsList[i])
+                continue;
+        }
+
+        auto pendingIt = pendingModelByKey.find(key);
+        if (pendingIt == pendingModelByKey.end()) {
+            pendingIt = pendingModelByKey.emplace(key, pendingModels.size()).first;
+            PendingModel pending{};
+            pending.key = key;
+            pending.texturePath = _loadInfos[i].textureFilepath;
+            pendingModels.push_back(std::move(pending));
+        }
+        pendingModels[pendingIt->second].resultIndices.push_back(i);
+    }
+
+    if (pendingModels.empty())
+        return modelsList;
+
+    std::vector<PendingTexture> pendingTextures;
+    std::unordered_map<std::string, size_t> pendingTextureByPath;
+    for (auto &pending : pendingModels) {
+        if (pending.texturePath.empty())
+            continue;
+        pending.texture = findTexture(pending.texturePath, &pending.textureHash);
+        if (pending.texture)
+            continue;
+
+        std::string path = AssetPack::normalizePath(pending.texturePath);
+        if (pendingTextureByPath.emplace(path, pendingTextures.size()).second) {
+            PendingTexture pendingTexture{};
+            pendingTexture.path = path;
+            pendingTextures.push_back(std::move(pendingTexture));
+        }
+    }
+
+    //both vectors are complete, the decoders can hold pointers into them
+    BatchFileReader reader{workers, log};
+    for (size_t i = 0; i < pendingModels.size(); ++i) {
+        PendingModel *pending = &pendingModels[i];
+        const auto &loadInfo = _loadInfos[pending->resultIndices[0]];
+        reader.enqueue(loadInfo.modelFilepath, [pending](FileBlob &blob) {
+            pending->contentHash = ContentHash::hash64(blob.data.get(), blob.size);
+            pending->builder.loadFromModelMemory(blob.data.get(), blob.size, pending->contentHash);
+        });
+    }
+    for (auto &pendingTexture : pendingTextures) {
+        PendingTexture *pending = &pendingTexture;
+        reader.enqueue(pending->path, [pending](FileBlob &blob) {
+            pending->contentHash = ContentHash::hash64(blob.data.get(), blob.size);
+            pending->builder.loadTextureMemory(blob.data.get(), blob.size);
+        });
+    }
+    reader.readAll();
+
+    //upload on this thread, identical content behind a different path reuses the existing asset
+    for (auto &pending : pendingTextures) {
+        auto cacheIt = texturesCache.find(pending.contentHash);
+        std::shared_ptr<ImageBuffer> texture = cacheIt != texturesCache.end() ? cacheIt->second.asset.lock() : nullptr;
+        if (!texture) {
+            texture = makeHandle(Model::createTexture(device, pending.builder.image));
+            texturesCache[pending.contentHash] = {pending.path, texture};
+        }
+        pending.builder.freeTexturePixels();
+        textureHashByPath[pending.path] = pending.contentHash;
+    }
+
+    for (auto &pending : pendingModels) {
+        if (!pending.texture && !pending.texturePath.empty())
+            pending.texture = findTexture(pending.texturePath, &pending.textureHash);
+
+        std::size_t hash = pending.contentHash;
+        hashCombine(hash, pending.textureHash);
+
+        auto cacheIt = modelsCache.find(hash);
+        std::shared_ptr<Model> model = cacheIt != modelsCache.end() ? cacheIt->second.asset.lock() : nullptr;
+        if (!model) {
+            reportMeshOptimization(_loadInfos[pending.resultIndices[0]].modelFilepath, pending.builder);
+            auto created = std::make_unique<Model>(geometryPool, pending.builder);
+            created->setTexture(pending.texture);
+            model = makeHandle(std::move(created));
+            modelsCache[hash] = {pending.key, model};
+        }
+        modelHashByKey[pending.key] = hash;
+
+        for (size_t index : pending.resultIndices)
+            modelsList[index] = model;
+    }
+
+    return modelsList;
+}
+
+std::shared_ptr<ImageBuffer> AssetManager::loadTexture(const std::string &_filepath) {
+    if (auto texture = findTexture(_filepath))
+        return texture;
+
+    std::string path = AssetPack::normalizePath(_filepath);
+    auto bytes = FileHelper::readFile(path);
+    uint64_t contentHash = ContentHash::hash64(bytes.data(), bytes.size());
+    textureHashByPath[path] = contentHash;
+
+    auto cacheIt = texturesCache.find(contentHash);
+    if (cacheIt != texturesCache.end()) {
+        if (auto texture = cacheIt->second.asset.lock())
+            return texture;
+    }
+
+    Builder builder{};
+    builder.loadTextureMemory(bytes.data(), bytes.size());
+    auto texture = makeHandle(Model::createTexture(device, builder.image));
+    builder.freeTexturePixels();
+    texturesCache[contentHash] = {path, texture};
+    return texture;
+}
+
+std::shared_ptr<Model> AssetManager::loadModelAsync(const std::string &_modelFilepath, const std::string &_textureFilepath) {
+    std::string key = makeModelKey(_modelFilepath, _textureFilepath);
+
+    auto hashIt = modelHashByKey.find(key);
+    if (hashIt != modelHashByKey.end()) {
+        auto cacheIt = modelsCache.find(hashIt->second);
+        if (cacheIt != modelsCache.end()) {
+            if (auto model = cacheIt->second.asset.lock())
+                return model;
+        }
+    }
+    auto asyncIt = asyncModelsByKey.find(key);
+    if (asyncIt != asyncModelsByKey.end()) {
+        if (auto model = asyncIt->second.lock())
+            return model;
+    }
+
+    auto model = makeHandle(createPlaceholder());
+
+    auto load = std::make_shared<AsyncLoad>();
+    load->key = key;
+    load->modelPath = AssetPack::normalizePath(_modelFilepath);
+    load->texturePath = _textureFilepath.empty() ? "" : AssetPack::normalizePath(_textureFilepath);
+    load->target = model;
+    if (!load->texturePath.empty())
+        load->texture = findTexture(load->texturePath, &load->textureHash);
+
+    //the job only touches the load itself, so it can outlive the manager
+    bool decodeTexture = !load->texturePath.empty() && !load->texture;
+    workers.submit([load, decodeTexture] {
+        try {
+            auto bytes = FileHelper::readFile(load->modelPath);
+            load->contentHash = ContentHash::hash64(bytes.data(), bytes.size());
+            load->builder.loadFromModelMemory(bytes.data(), bytes.size(), load->contentHash);
+
+            if (decodeTexture) {
+                auto textureBytes = FileHelper::readFile(load->texturePath);
+                load->textureHash = ContentHash::hash64(textureBytes.data(), textureBytes.size());
+                load->textureBuilder.loadTextureMemory(textureBytes.data(), textureBytes.size());
+            }
+        } catch (...) {
+            load->error = std::current_exception();
+        }
+        load->finished.store(true, std::memory_order_release);
+    });
+
+    asyncLoadsList.push_back(load);
+    asyncModelsByKey[key] = model;
+    return model;
+}
+
+void AssetManager::updateAsyncLoads(uint32_t _maxUploads) {
+    uint32_t uploads = 0;
+    for (auto it = asyncLoadsList.begin(); it != asyncLoadsList.end() && uploads < _maxUploads;) {
+        if (!(*it)->finished.load(std::memory_order_acquire)) {
+            ++it;
+            continue;
+        }
+        std::shared_ptr<AsyncLoad> load = *it;
+        it = asyncLoadsList.erase(it);
+
+        finishAsyncLoad(*load);
+        uploads++;
+    }
+}
+
+void AssetManager::finishAsyncLoads() {
+    workers.wait();
+    updateAsyncLoads(std::numeric_limits<uint32_t>::max());
+}
+
+std::shared_ptr<Model> AssetManager::addModel(const std::string &_name, Builder &_builder, const std::shared_ptr<ImageBuffer> &_texture,
+                                              uint64_t _contentHash) {
+    reportMeshOptimization(_name, _builder);
+    auto created = std::make_unique<Model>(geometryPool, _builder);
+    created->setTexture(_texture);
+    auto model = makeHandle(std::move(created));
+
+    //keyed apart from loaded files, nothing looks these up by path
+    std::size_t hash = _contentHash;
+    hashCombine(hash, _name);
+    modelsCache[hash] = {_name, model};
+    return model;
+}
+
+void AssetManager::finishAsyncLoad(AsyncLoad &_load) {
+    asyncModelsByKey.erase(_load.key);
+
+    auto target = _load.target.lock();
+    if (_load.error || !target) {
+        _load.textureBuilder.freeTexturePixels();
+        if (_load.error) {
+            try {
+                std::rethrow_exception(_load.error);
+            } catch (const std::exception &e) {
+                log.printError("failed to load " + _load.modelPath + ", keeping placeholder: " + e.what());
+            }
+        }
+        return;
+    }
+
+    std::shared_ptr<ImageBuffer> texture = _load.texture;
+    if (!texture && !_load.texturePath.empty()) {
+        auto cacheIt = texturesCache.find(_load.textureHash);
+        texture = cacheIt != texturesCache.end() ? cacheIt->second.asset.lock() : nullptr;
+        if (!texture) {
+            texture = makeHandle(Model::createTexture(device, _load.textureBuilder.image));
+            texturesCache[_load.textureHash] = {_load.texturePath, texture};
+        }
+        _load.textureBuilder.freeTexturePixels();
+        textureHashByPath[_load.texturePath] = _load.textureHash;
+    }
+
+    reportMeshOptimization(_load.modelPath, _load.builder);
+    auto loaded = std::make_unique<Model>(geometryPool, _load.builder);
+    loaded->setTexture(texture);
+    target->swapContents(*loaded);
+    //loaded now holds the placeholder data, frames in flight may still draw it
+    makeHandle(std::move(loaded));
+
+    std::size_t hash = _load.contentHash;
+    hashCombine(hash, _load.textureHash);
+    auto cacheIt = modelsCache.find(hash);
+    if (cacheIt == modelsCache.end() || cacheIt->second.asset.expired())
+        modelsCache[hash] = {_load.key, target};
+    modelHashByKey[_load.key] = hash;
+}
+
+std::unique_ptr<Model> AssetManager::createPlaceholder() {
+    if (!placeholderTexture) {
+        uint32_t whitePixel = 0xffffffff;
+        ImageBuilder image{};
+        image.pixels = &whitePixel;
+        image.width = 1;
+        image.height = 1;
+        image.channels_size = 4;
+        image.initialized = true;
+        placeholderTexture = makeHandle(Model::createTexture(device, image));
+    }
+
+    //unit cube, the real bounds are not known before the file is parsed.
+    //vertex i sits at +0.5 on every axis whose bit is set in i
+    Builder builder{};
+    for (int i = 0; i < 8; ++i) {
+        Vertex vertex{};
+        vertex.position = {(i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f};
+        vertex.color = {0.5f, 0.5f, 0.5f};
+        vertex.normal = glm::normalize(vertex.position);
+        builder.vertices.push_back(vertex);
+    }
+    builder.indices = {
+            0, 2, 6, 0, 6, 4,   1, 5, 7, 1, 7, 3,
+            0, 4, 5, 0, 5, 1,   2, 3, 7, 2, 7, 6,
+            0, 1, 3, 0, 3, 2,   4, 6, 7, 4, 7, 5,
+    };
+
+    auto placeholder = std::make_unique<Model>(geometryPool, builder);
+    placeholder->setTexture(placeholderTexture);
+    return placeholder;
+}
+
+void AssetManager::collectGarbage() {
+    std::vector<std::function<void()>> readyList;
+    {
+        std::lock_guard<std::mutex> lock(releaseQueue->mutex);
+        releaseQueue->currentFrame++;
+
+        auto &pendingList = releaseQueue->pendingList;
+        auto it = std::partition(pendingList.begin(), pendingList.end(), [this](const auto &pending) {
+            return pending.first + SwapChain::MAX_FRAMES_IN_FLIGHT > releaseQueue->currentFrame;
+        });
+        for (auto ready = it; ready != pendingList.end(); ++ready)
+            readyList.push_back(std::move(ready->second));
+        pendingList.erase(it, pendingList.end());
+    }
+    //destructors may release more handles and take the lock again
+    for (auto &destroy : readyList)
+        destroy();
+
+    for (auto it = modelsCache.begin(); it != modelsCache.end();) {
+        it = it->second.asset.expired() ? modelsCache.erase(it) : std::next(it);
+    }
+    for (auto it = modelHashByKey.begin(); it != modelHashByKey.end();) {
+        it = modelsCache.count(it->second) == 0 ? modelHashByKey.erase(it) : std::next(it);
+    }
+    for (auto it = texturesCache.begin(); it != texturesCache.end();) {
+        it = it->second.asset.expired() ? texturesCache.erase(it) : std::next(it);
+    }
+    for (auto it = textureHashByPath.begin(); it != textureHashByPath.end();) {
+        it = texturesCache.count(it->second) == 0 ? textureHashByPath.erase(it) : std::next(it);
+    }
+}
+
+std::vector<AssetMemoryInfo> AssetManager::getModelsMemoryUsage() const {
+    std::vector<AssetMemoryInfo> usageList;
+    for (const auto &entry : modelsCache) {
+        if (auto model = entry.second.asset.lock()) {
+            //minus the reference taken by lock() above
+            usageList.push_back({entry.second.name, model->getGeometryMemorySize(), model.use_count() - 1});
+        }
+    }
+    return usageList;
+}
+
+std::vector<AssetMemoryInfo> AssetManager::getTexturesMemoryUsage() const {
+    std::vector<AssetMemoryInfo> usageList;
+    for (const auto &entry : texturesCache) {
+        if (auto texture = entry.second.asset.lock()) {
+            usageList.push_back({entry.second.name, texture->getMemorySize(), texture.use_count() - 1});
+        }
+    }
+    return usageList;
+}
+
+void AssetManager::reportMeshOptimization(const std::string &_name, const Builder &_builder) const {
+    const auto &stats = _builder.optimizationStats;
+    std::ostringstream line;
+    line.precision(3);
+    line << std::fixed << _name << ": acmr " << stats.before.acmr << " -> " << stats.after.acmr
+         << ", atvr " << stats.before.atvr << " -> " << stats.after.atvr;
+    if (!_builder.lods.empty()) {
+        line << ", lod triangles";
+        for (size_t level = 0; level < _builder.lods.size(); ++level)
+            line << (level == 0 ? " " : "/") << _builder.lods[level].indexCount / 3;
+    }
+    if (!_builder.meshlets.empty())
+        line << ", " << _builder.meshlets.size() << " meshlets";
+    log.printInfo(line.str());
+}
+
+void AssetManager::reportMemoryUsage() const {
+    auto report = [this](const char *kind, const std::vector<AssetMemoryInfo> &usageList) {
+        VkDeviceSize total = 0;
+        for (const auto &usage : usageList) {
+            std::ostringstream line;
+            line << kind << " " << usage.name << ": " << usage.bytes / 1024 << " KiB, " << usage.references << " refs";
+            log.printInfo(line.str());
+            total += usage.bytes;
+        }
+        log.printInfo(std::string(kind) + " total: " + std::to_string(total / 1024) + " KiB in " + std::to_string(usageList.size()) + " assets");
+    };
+
+    report("model", getModelsMemoryUsage());
+    report("texture", getTexturesMemoryUsage());
+    log.printInfo("geometry pool: " + std::to_string(geometryPool.getUsedMemory() / 1024) + " KiB used of " +
+                  std::to_string(geometryPool.getReservedMemory() / 1024) + " KiB in " +
+                  std::to_string(geometryPool.getBlockCount()) + " blocks");
+}
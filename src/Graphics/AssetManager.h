@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Model.h"
+#include "SwapChain.h"
+#include "../Jobs/ThreadPool.h"
+
+struct AssetMemoryInfo {
+    std::string name;
+    VkDeviceSize bytes = 0;
+    long references = 0;
+};
+
+//caches models and textures by path and content hash and hands out shared handles.
+//when the last handle goes away the gpu resources are kept until no frame in flight can still use them
+class AssetManager {
+public:
+    AssetManager(Device &_device, GeometryPool &_geometryPool, ThreadPool &_workers, const Logger &_log);
+    ~AssetManager();
+
+    AssetManager(const AssetManager &) = delete;
+    AssetManager &operator=(const AssetManager &) = delete;
+
+    std::shared_ptr<Model> loadModel(const std::string &_modelFilepath, const std::string &_textureFilepath = "");
+    //cache misses are read in one batch and decoded in parallel. models still loading through loadModelAsync are
+    //returned as their pending handle, which holds the placeholder until updateAsyncLoads swaps the data in
+    std::vector<std::shared_ptr<Model>> loadModels(const std::vector<ModelLoadInfo> &_loadInfos);
+    std::shared_ptr<ImageBuffer> loadTexture(const std::string &_filepath);
+
+    //returns right away with a placeholder cube, the file is read and decoded on the workers
+    //and the real data is swapped into the same handle by updateAsyncLoads()
+    std::shared_ptr<Model> loadModelAsync(const std::string &_modelFilepath, const std::string &_textureFilepath = "");
+    //call at a frame boundary before recording, uploads at most _maxUploads finished loads
+    void updateAsyncLoads(uint32_t _maxUploads = 4);
+    //waits for the workers to decode every pending load and uploads them all, for building the scene before the
+    //first frame. the workers must not be busy with anything that never finishes
+    void finishAsyncLoads();
+    size_t getPendingLoadCount() const { return asyncLoadsList.size(); }
+
+    //uploads a mesh built at runtime, like a static batch, and keeps track of it like a loaded one. _builder has to be
+    //quantized, _name is what the memory report lists it as
+    std::shared_ptr<Model> addModel(const std::string &_name, Builder &_builder, const std::shared_ptr<ImageBuffer> &_texture,
+                                    uint64_t _contentHash);
+
+    //call once per frame, destroys assets released MAX_FRAMES_IN_FLIGHT frames ago
+    void collectGarbage();
+
+    std::vector<AssetMemoryInfo> getModelsMemoryUsage() const;
+    std::vector<AssetMemoryInfo> getTexturesMemoryUsage() const;
+    void reportMemoryUsage() const;
+
+private:
+    template<typename T>
+    struct CacheEntry {
+        std::string name;
+        std::weak_ptr<T> asset;
+    };
+
+    //shared with every handle deleter so a handle released after the manager is gone is still safe
+    struct ReleaseQueue {
+        std::mutex mutex;
+        uint64_t currentFrame = 0;
+        bool alive = true;
+        std::vector<std::pair<uint64_t, std::function<void()>>> pendingList;
+    };
+
+    struct AsyncLoad {
+        std::string key;
+        std::string modelPath;
+        std::string texturePath;
+        std::weak_ptr<Model> target;
+        //set up front when the texture is already resident
+        std::shared_ptr<ImageBuffer> texture;
+
+        //written by the worker before finished is set
+        Builder builder;
+        Builder textureBuilder;
+        uint64_t contentHash = 0;
+        uint64_t textureHash = 0;
+        std::exception_ptr error;
+        std::atomic<bool> finished{false};
+    };
+
+    template<typename T>
+    std::shared_ptr<T> makeHandle(std::unique_ptr<T> _asset);
+
+    std::unique_ptr<Model> createPlaceholder();
+    void finishAsyncLoad(AsyncLoad &_load);
+    void reportMeshOptimization(const std::string &_name, const Builder &_builder) const;
+
+    std::shared_ptr<ImageBuffer> findTexture(const std::string &_path, uint64_t *_contentHash = nullptr);
+    static std::string makeModelKey(const std::string &_modelFilepath, const std::string &_textureFilepath);
+
+    Device &device;
+    GeometryPool &geometryPool;
+    ThreadPool &workers;
+    Logger log;
+    std::shared_ptr<ReleaseQueue> releaseQueue;
+
+    //path -> content hash -> asset, so the same file reached through different paths is loaded once
+    std::unordered_map<std::string, uint64_t> modelHashByKey;
+    std::unordered_map<uint64_t, CacheEntry<Model>> modelsCache;
+    std::unordered_map<std::string, uint64_t> textureHashByPath;
+    std::unordered_map<uint64_t, CacheEntry<ImageBuffer>> texturesCache;
+
+    std::shared_ptr<ImageBuffer> placeholderTexture;
+    std::vector<std::shared_ptr<AsyncLoad>> asyncLoadsList;
+    std::unordered_map<std::string, std::weak_ptr<Model>> asyncModelsByKey;
+};
@@ -0,0 +1,171 @@
+#include "CommandRecorder.h"
+
+#include <cassert>
+#include <cstring>
+
+uint32_t CommandRecorderStats::getIssued() const {
+    uint32_t count = 0;
+    for (uint32_t calls : issued)
+        count += calls;
+    return count;
+}
+
+uint32_t CommandRecorderStats::getFiltered() const {
+    uint32_t count = 0;
+    for (uint32_t calls : filtered)
+        count += calls;
+    return count;
+}
+
+CommandRecorder::CommandRecorder(VkCommandBuffer _commandBuffer) : commandBuffer(_commandBuffer) {
+    invalidate();
+}
+
+void CommandRecorder::invalidate() {
+    pipeline = VK_NULL_HANDLE;
+    descriptorSetLayout = VK_NULL_HANDLE;
+    for (auto &set : descriptorSetsList)
+        set = VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < MAX_VERTEX_BINDINGS; ++i) {
+        vertexBuffersList[i] = VK_NULL_HANDLE;
+        vertexOffsetsList[i] = 0;
+    }
+    indexBuffer = VK_NULL_HANDLE;
+    indexOffset = 0;
+    indexType = VK_INDEX_TYPE_UINT32;
+    hasViewport = false;
+    viewport = {};
+    hasScissor = false;
+    scissor = {};
+    pushConstantLayout = VK_NULL_HANDLE;
+    pushConstantStages = 0;
+    pushConstantValid.reset();
+}
+
+void CommandRecorder::bindPipeline(VkPipeline _pipeline) {
+    if (_pipeline == pipeline) {
+        stats.filtered[BIND_PIPELINE]++;
+        return;
+    }
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
+    pipeline = _pipeline;
+    stats.issued[BIND_PIPELINE]++;
+}
+
+void CommandRecorder::bindDescriptorSets(VkPipelineLayout _layout, uint32_t _firstSet, uint32_t _setCount, const VkDescriptorSet *_sets) {
+    assert(_firstSet + _setCount <= MAX_DESCRIPTOR_SETS && "more descriptor sets than the recorder tracks");
+    if (_layout != descriptorSetLayout) {
+        for (auto &set : descriptorSetsList)
+            set = VK_NULL_HANDLE;
+        descriptorSetLayout = _layout;
+    }
+
+    bool bound = true;
+    for (uint32_t i = 0; i < _setCount && bound; ++i)
+        bound = descriptorSetsList[_firstSet + i] == _sets[i];
+    if (bound) {
+        stats.filtered[BIND_DESCRIPTOR_SETS]++;
+        return;
+    }
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _layout, _firstSet, _setCount, _sets, 0, nullptr);
+    for (uint32_t i = 0; i < _setCount; ++i)
+        descriptorSetsList[_firstSet + i] = _sets[i];
+    stats.issued[BIND_DESCRIPTOR_SETS]++;
+}
+
+void CommandRecorder::bindVertexBuffers(uint32_t _firstBinding, uint32_t _bindingCount, const VkBuffer *_buffers,
+                                        const VkDeviceSize *_offsets) {
+    assert(_firstBinding + _bindingCount <= MAX_VERTEX_BINDINGS && "more vertex bindings than the recorder tracks");
+    bool bound = true;
+    for (uint32_t i = 0; i < _bindingCount && bound; ++i)
+        bound = vertexBuffersList[_firstBinding + i] == _buffers[i] && vertexOffsetsList[_firstBinding + i] == _offsets[i];
+    if (bound) {
+        stats.filtered[BIND_VERTEX_BUFFERS]++;
+        return;
+    }
+    vkCmdBindVertexBuffers(commandBuffer, _firstBinding, _bindingCount, _buffers, _offsets);
+    for (uint32_t i = 0; i < _bindingCount; ++i) {
+        vertexBuffersList[_firstBinding + i] = _buffers[i];
+        vertexOffsetsList[_firstBinding + i] = _offsets[i];
+    }
+    stats.issued[BIND_VERTEX_BUFFERS]++;
+}
+
+void CommandRecorder::bindIndexBuffer(VkBuffer _buffer, VkDeviceSize _offset, VkIndexType _indexType) {
+    if (_buffer == indexBuffer && _offset == indexOffset && _indexType == indexType) {
+        stats.filtered[BIND_INDEX_BUFFER]++;
+        return;
+    }
+    vkCmdBindIndexBuffer(commandBuffer, _buffer, _offset, _indexType);
+    indexBuffer = _buffer;
+    indexOffset = _offset;
+    indexType = _indexType;
+    stats.issued[BIND_INDEX_BUFFER]++;
+}
+
+void CommandRecorder::setViewport(const VkViewport &_viewport) {
+    if (hasViewport && std::memcmp(&_viewport, &viewport, sizeof(VkViewport)) == 0) {
+        stats.filtered[SET_VIEWPORT]++;
+        return;
+    }
+    vkCmdSetViewport(commandBuffer, 0, 1, &_viewport);
+    viewport = _viewport;
+    hasViewport = true;
+    stats.issued[SET_VIEWPORT]++;
+}
+
+void CommandRecorder::setScissor(const VkRect2D &_scissor) {
+    if (hasScissor && std::memcmp(&_scissor, &scissor, sizeof(VkRect2D)) == 0) {
+        stats.filtered[SET_SCISSOR]++;
+        return;
+    }
+    vkCmdSetScissor(commandBuffer, 0, 1, &_scissor);
+    scissor = _scissor;
+    hasScissor = true;
+    stats.issued[SET_SCISSOR]++;
+}
+
+void CommandRecorder::pushConstants(VkPipelineLayout _layout, VkShaderStageFlags _stages, uint32_t _offset, uint32_t _size,
+                                    const void *_data) {
+    assert(_offset + _size <= MAX_PUSH_CONSTANT_SIZE && "push constant range outside of what the recorder tracks");
+    if (_layout != pushConstantLayout || _stages != pushConstantStages) {
+        pushConstantValid.reset();
+        pushConstantLayout = _layout;
+        pushConstantStages = _stages;
+    }
+
+    bool valid = true;
+    for (uint32_t i = _offset; i < _offset + _size && valid; ++i)
+        valid = pushConstantValid[i];
+    if (valid && std::memcmp(pushConstantData + _offset, _data, _size) == 0) {
+        stats.filtered[PUSH_CONSTANTS]++;
+        return;
+    }
+    vkCmdPushConstants(commandBuffer, _layout, _stages, _offset, _size, _data);
+    std::memcpy(pushConstantData + _offset, _data, _size);
+    for (uint32_t i = _offset; i < _offset + _size; ++i)
+        pushConstantValid[i] = true;
+    stats.issued[PUSH_CONSTANTS]++;
+}
+
+void CommandRecorder::draw(uint32_t _vertexCount, uint32_t _instanceCount, uint32_t _firstVertex, uint32_t _firstInstance) {
+    vkCmdDraw(commandBuffer, _vertexCount, _instanceCount, _firstVertex, _firstInstance);
+    stats.issued[DRAW]++;
+}
+
+void CommandRecorder::drawIndexed(uint32_t _indexCount, uint32_t _instanceCount, uint32_t _firstIndex, int32_t _vertexOffset,
+                                  uint32_t _firstInstance) {
+    vkCmdDrawIndexed(commandBuffer, _indexCount, _instanceCount, _firstIndex, _vertexOffset, _firstInstance);
+    stats.issued[DRAW]++;
+}
+
+void CommandRecorder::drawIndexedIndirect(VkBuffer _buffer, VkDeviceSize _offset, uint32_t _drawCount, uint32_t _stride) {
+    vkCmdDrawIndexedIndirect(commandBuffer, _buffer, _offset, _drawCount, _stride);
+    stats.issued[DRAW]++;
+}
+
+void CommandRecorder::drawIndexedIndirectCount(VkBuffer _buffer, VkDeviceSize _offset, VkBuffer _countBuffer,
+                                               VkDeviceSize _countOffset, uint32_t _maxDrawCount, uint32_t _stride) {
+    vkCmdDrawIndexedIndirectCount(commandBuffer, _buffer, _offset, _countBuffer, _countOffset, _maxDrawCount, _stride);
+    stats.issued[DRAW]++;
+}
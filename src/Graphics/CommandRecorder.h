@@ -0,0 +1,88 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+enum RecorderCommand : uint32_t {
+    BIND_PIPELINE = 0,
+    BIND_DESCRIPTOR_SETS,
+    BIND_VERTEX_BUFFERS,
+    BIND_INDEX_BUFFER,
+    SET_VIEWPORT,
+    SET_SCISSOR,
+    PUSH_CONSTANTS,
+    DRAW,
+    RECORDER_COMMAND_COUNT
+};
+
+//calls that reached the command buffer and calls dropped because they would not have changed anything, per command
+struct CommandRecorderStats {
+    uint32_t issued[RECORDER_COMMAND_COUNT]{};
+    uint32_t filtered[RECORDER_COMMAND_COUNT]{};
+
+    uint32_t getIssued() const;
+    uint32_t getFiltered() const;
+};
+
+//thin wrapper over a graphics command buffer that remembers the bound pipeline, descriptor sets, vertex and index
+//buffers, viewport, scissor and push constant bytes, and drops calls that would set what is already set. every draw
+//recorded through it is counted, so the filtered share shows the driver calls saved.
+//state only lives as long as the command buffer's, one recorder per recording. code that records into the buffer
+//behind its back, imgui or compute work pushing constants, calls invalidate afterwards
+class CommandRecorder {
+public:
+    static constexpr uint32_t MAX_DESCRIPTOR_SETS = 8;
+    static constexpr uint32_t MAX_VERTEX_BINDINGS = 8;
+    //the largest maxPushConstantsSize a device reports in practice
+    static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 256;
+
+    explicit CommandRecorder(VkCommandBuffer _commandBuffer);
+
+    CommandRecorder(const CommandRecorder &) = delete;
+    CommandRecorder &operator=(const CommandRecorder &) = delete;
+
+    VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+    const CommandRecorderStats &getStats() const { return stats; }
+
+    //forgets everything, the next call of every kind is recorded
+    void invalidate();
+
+    void bindPipeline(VkPipeline _pipeline);
+    //binding with another layout than the last call forgets the sets bound with that one
+    void bindDescriptorSets(VkPipelineLayout _layout, uint32_t _firstSet, uint32_t _setCount, const VkDescriptorSet *_sets);
+    void bindVertexBuffers(uint32_t _firstBinding, uint32_t _bindingCount, const VkBuffer *_buffers, const VkDeviceSize *_offsets);
+    void bindIndexBuffer(VkBuffer _buffer, VkDeviceSize _offset, VkIndexType _indexType);
+    void setViewport(const VkViewport &_viewport);
+    void setScissor(const VkRect2D &_scissor);
+    //dropped when every byte of the range already holds the same value for the same layout and stages
+    void pushConstants(VkPipelineLayout _layout, VkShaderStageFlags _stages, uint32_t _offset, uint32_t _size, const void *_data);
+
+    void draw(uint32_t _vertexCount, uint32_t _instanceCount, uint32_t _firstVertex, uint32_t _firstInstance);
+    void drawIndexed(uint32_t _indexCount, uint32_t _instanceCount, uint32_t _firstIndex, int32_t _vertexOffset, uint32_t _firstInstance);
+    void drawIndexedIndirect(VkBuffer _buffer, VkDeviceSize _offset, uint32_t _drawCount, uint32_t _stride);
+    void drawIndexedIndirectCount(VkBuffer _buffer, VkDeviceSize _offset, VkBuffer _countBuffer, VkDeviceSize _countOffset,
+                                  uint32_t _maxDrawCount, uint32_t _stride);
+
+private:
+    VkCommandBuffer commandBuffer;
+    CommandRecorderStats stats{};
+
+    VkPipeline pipeline;
+    VkPipelineLayout descriptorSetLayout;
+    VkDescriptorSet descriptorSetsList[MAX_DESCRIPTOR_SETS];
+    VkBuffer vertexBuffersList[MAX_VERTEX_BINDINGS];
+    VkDeviceSize vertexOffsetsList[MAX_VERTEX_BINDINGS];
+    VkBuffer indexBuffer;
+    VkDeviceSize indexOffset;
+    VkIndexType indexType;
+    bool hasViewport;
+    VkViewport viewport;
+    bool hasScissor;
+    VkRect2D scissor;
+    VkPipelineLayout pushConstantLayout;
+    VkShaderStageFlags pushConstantStages;
+    uint8_t pushConstantData[MAX_PUSH_CONSTANT_SIZE];
+    //bytes written since the last invalidate or layout change
+    std::bitset<MAX_PUSH_CONSTANT_SIZE> pushConstantValid;
+};
@@ -0,0 +1,135 @@
+#include "ComputePipeline.h"
+
+ComputePipeline::ComputePipeline(Device &_device, const std::string &computeFilePath,
+                                 const std::vector<VkDescriptorSetLayout> &_setLayouts, uint32_t _pushConstantSize,
+                                 const Logger &_log) : device(_device), log(_log), ownsLayout(true), pushConstantSize(_pushConstantSize) {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(_setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = _setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+    if (vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create compute pipeline layout!");
+    }
+
+    createComputePipeline(computeFilePath);
+}
+
+ComputePipeline::ComputePipeline(Device &_device, const std::string &computeFilePath, VkPipelineLayout _pipelineLayout,
+                                 const Logger &_log) : device(_device), log(_log), pipelineLayout(_pipelineLayout) {
+    createComputePipeline(computeFilePath);
+}
+
+void ComputePipeline::createComputePipeline(const std::string &computeFilePath) {
+    assert(pipelineLayout != VK_NULL_HANDLE && "cant create compute pipeline: no _pipelineLayout is provided");
+
+    auto computeBytecode = FileHelper::readFile(computeFilePath);
+    computeShader = Vh::createShaderModule(computeBytecode, device.getDevice());
+
+    VkPipelineShaderStageCreateInfo computeStageInfo{};
+    computeStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeStageInfo.module = computeShader;
+    computeStageInfo.pName = "main";
+
+    VkComputePipelineCreateInfo pipelineCreateInfo{};
+    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage = computeStageInfo;
+    pipelineCreateInfo.layout = pipelineLayout;
+    pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineCreateInfo.basePipelineIndex = -1;
+
+    if (vkCreateComputePipelines(device.getDevice(), VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+        throw std::runtime_error("cant create compute pipeline");
+    }
+}
+
+ComputePipeline::~ComputePipeline() {
+    vkDestroyShaderModule(device.getDevice(), computeShader, nullptr);
+    vkDestroyPipeline(device.getDevice(), computePipeline, nullptr);
+    if (ownsLayout)
+        vkDestroyPipelineLayout(device.getDevice(), pipelineLayout, nullptr);
+}
+
+void ComputePipeline::bind(const VkCommandBuffer &commandBuffer) {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+}
+
+void ComputePipeline::bindDescriptorSets(const VkCommandBuffer &commandBuffer, const std::vector<VkDescriptorSet> &_sets, uint32_t _firstSet) {
+    vkCmdBindDescriptorSets(commandBuffer,
+                            VK_PIPELINE_BIND_POINT_COMPUTE,
+                            pipelineLayout,
+                            _firstSet,
+                            static_cast<uint32_t>(_sets.size()),
+                            _sets.data(),
+                            0,
+                            nullptr);
+}
+
+void ComputePipeline::pushConstants(const VkCommandBuffer &commandBuffer, const void *_data, uint32_t _size) {
+    assert((!ownsLayout || _size <= pushConstantSize) && "push constants bigger than the layout range");
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, _size, _data);
+}
+
+void ComputePipeline::dispatch(const VkCommandBuffer &commandBuffer, uint32_t _groupsX, uint32_t _groupsY, uint32_t _groupsZ) {
+    vkCmdDispatch(commandBuffer, _groupsX, _groupsY, _groupsZ);
+}
+
+void ComputePipeline::dispatchThreads(const VkCommandBuffer &commandBuffer, uint32_t _threadCount, uint32_t _groupSize) {
+    vkCmdDispatch(commandBuffer, (_threadCount + _groupSize - 1) / _groupSize, 1, 1);
+}
+
+void ComputePipeline::dispatchIndirect(const VkCommandBuffer &commandBuffer, VkBuffer _buffer, VkDeviceSize _offset) {
+    vkCmdDispatchIndirect(commandBuffer, _buffer, _offset);
+}
+
+void ComputePipeline::barrier(const VkCommandBuffer &commandBuffer, VkPipelineStageFlags _srcStage, VkAccessFlags _srcAccess,
+                              VkPipelineStageFlags _dstStage, VkAccessFlags _dstAccess) {
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = _srcAccess;
+    memoryBarrier.dstAccessMask = _dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, _srcStage, _dstStage, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+void ComputePipeline::transferToCompute(const VkCommandBuffer &commandBuffer) {
+    barrier(commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void ComputePipeline::computeToCompute(const VkCommandBuffer &commandBuffer) {
+    barrier(commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void ComputePipeline::computeToIndirect(const VkCommandBuffer &commandBuffer) {
+    barrier(commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+void ComputePipeline::computeToVertexInput(const VkCommandBuffer &commandBuffer) {
+    barrier(commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT);
+}
+
+void ComputePipeline::computeToGraphicsShaders(const VkCommandBuffer &commandBuffer) {
+    barrier(commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+}
+
+void ComputePipeline::computeToHost(const VkCommandBuffer &commandBuffer) {
+    barrier(commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "Vh.h"
+#include "Device.h"
+#include "../FileHelper.h"
+
+//compute counterpart of Pipeline, built from a single .comp shader
+class ComputePipeline {
+public:
+    //builds its own layout out of the given set layouts and one push constant range of _pushConstantSize bytes
+    ComputePipeline(Device &_device, const std::string &computeFilePath, const std::vector<VkDescriptorSetLayout> &_setLayouts,
+                    uint32_t _pushConstantSize, const Logger &_log);
+    //uses a layout owned by the caller
+    ComputePipeline(Device &_device, const std::string &computeFilePath, VkPipelineLayout _pipelineLayout, const Logger &_log);
+    ~ComputePipeline();
+
+    ComputePipeline(const ComputePipeline &) = delete;
+    ComputePipeline& operator=(const ComputePipeline &) = delete;
+
+    void bind(const VkCommandBuffer &commandBuffer);
+    void bindDescriptorSets(const VkCommandBuffer &commandBuffer, const std::vector<VkDescriptorSet> &_sets, uint32_t _firstSet = 0);
+    void pushConstants(const VkCommandBuffer &commandBuffer, const void *_data, uint32_t _size);
+
+    static void dispatch(const VkCommandBuffer &commandBuffer, uint32_t _groupsX, uint32_t _groupsY = 1, uint32_t _groupsZ = 1);
+    //one thread per item, rounded up to whole workgroups of _groupSize
+    static void dispatchThreads(const VkCommandBuffer &commandBuffer, uint32_t _threadCount, uint32_t _groupSize);
+    //group counts written by an earlier pass, _offset points at a VkDispatchIndirectCommand
+    static void dispatchIndirect(const VkCommandBuffer &commandBuffer, VkBuffer _buffer, VkDeviceSize _offset = 0);
+
+    //global memory barriers for the usual hand offs around compute work
+    static void barrier(const VkCommandBuffer &commandBuffer, VkPipelineStageFlags _srcStage, VkAccessFlags _srcAccess,
+                        VkPipelineStageFlags _dstStage, VkAccessFlags _dstAccess);
+    static void transferToCompute(const VkCommandBuffer &commandBuffer);
+    static void computeToCompute(const VkCommandBuffer &commandBuffer);
+    static void computeToIndirect(const VkCommandBuffer &commandBuffer);
+    static void computeToVertexInput(const VkCommandBuffer &commandBuffer);
+    static void computeToGraphicsShaders(const VkCommandBuffer &commandBuffer);
+    static void computeToHost(const VkCommandBuffer &commandBuffer);
+
+    VkPipelineLayout getPipelineLayout() const { return pipelineLayout; }
+
+private:
+    void createComputePipeline(const std::string &computeFilePath);
+
+    Device& device;
+    Logger log;
+    VkShaderModule computeShader;
+    VkPipeline computePipeline;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    bool ownsLayout = false;
+    uint32_t pushConstantSize = 0;
+};
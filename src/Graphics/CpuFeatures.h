@@ -0,0 +1,17 @@
+#pragma once
+
+//avx2 paths are compiled next to the scalar ones through a function target attribute and picked at runtime. the
+//rest of every file stays baseline x86-64, so a cpu without avx2 never runs one of its instructions.
+//CPU_AVX2 is defined when the paths are built, the functions holding them are marked CPU_AVX2_TARGET and may only
+//be called once cpuSupportsAvx2 said so
+#if defined(SPECTRARE_AVX2) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_AVX2
+#define CPU_AVX2_TARGET __attribute__((target("avx2,fma")))
+#include <immintrin.h>
+
+//avx2 and fma both, checked once
+inline bool cpuSupportsAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+#endif
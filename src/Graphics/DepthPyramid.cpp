@@ -0,0 +1,218 @@
+#include "DepthPyramid.h"
+
+#include <algorithm>
+
+static constexpr uint32_t REDUCE_GROUP_SIZE = 8;
+
+static uint32_t previousPowerOfTwo(uint32_t _value) {
+    uint32_t result = 1;
+    while (result * 2 <= _value)
+        result *= 2;
+    return result;
+}
+
+DepthPyramid::DepthPyramid(Device &_device, VkExtent2D _depthExtent, const Logger &_log) : device(_device), log(_log) {
+    createSampler();
+    createDescriptors();
+    reducePipeline = std::make_unique<ComputePipeline>(device, "shaders/depth_reduce.comp.spv",
+                                                       std::vector<VkDescriptorSetLayout>{reduceSetLayout->getDescriptorSetLayout()},
+                                                       sizeof(DepthReducePushConstants), log);
+    createPyramid(_depthExtent);
+}
+
+DepthPyramid::~DepthPyramid() {
+    destroyPyramid();
+    vkDestroySampler(device.getDevice(), sampler, nullptr);
+}
+
+void DepthPyramid::createSampler() {
+    //nearest, so a sample returns exactly one reduced texel and never blends in a nearer neighbour
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(MAX_LEVELS);
+
+    if (vkCreateSampler(device.getDevice(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("cant create depth pyramid sampler");
+    }
+}
+
+void DepthPyramid::createDescriptors() {
+    uint32_t setCount = SwapChain::MAX_FRAMES_IN_FLIGHT + MAX_LEVELS;
+    descriptorPool = lve::LveDescriptorPool::Builder(device)
+            .setMaxSets(setCount)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount)
+            .build();
+
+    reduceSetLayout = lve::LveDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+}
+
+void DepthPyramid::createPyramid(VkExtent2D _depthExtent) {
+    depthExtent = _depthExtent;
+    extent = {previousPowerOfTwo(std::max(depthExtent.width, 1u)), previousPowerOfTwo(std::max(depthExtent.height, 1u))};
+    levelCount = 1;
+    while (levelCount < MAX_LEVELS && (std::max(extent.width, extent.height) >> levelCount) > 0)
+        levelCount++;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = extent.width;
+    imageInfo.extent.height = extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.flags = 0;
+    device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = levelCount;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &pyramidView) != VK_SUCCESS) {
+        throw std::runtime_error("cant create depth pyramid view");
+    }
+
+    levelViews.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS) {
+            throw std::runtime_error("cant create depth pyramid level view");
+        }
+    }
+
+    //stays in GENERAL for its whole life, levels are written as storage and read through the sampler
+    VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1};
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    if (device.endSingleTimeCommands(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("cant transition depth pyramid");
+
+    //level 0 sets get their depth in build, only the target is known here
+    VkDescriptorImageInfo pyramidInfo{sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo targetInfo{VK_NULL_HANDLE, levelViews[0], VK_IMAGE_LAYOUT_GENERAL};
+    for (auto &set : depthReduceSets) {
+        if (!lve::LveDescriptorWriter(*reduceSetLayout, *descriptorPool)
+                .writeImage(0, &pyramidInfo)
+                .writeImage(1, &targetInfo)
+                .build(set)) {
+            throw std::runtime_error("cant allocate depth pyramid descriptors");
+        }
+    }
+
+    levelReduceSets.resize(levelCount);
+    for (uint32_t level = 1; level < levelCount; ++level) {
+        VkDescriptorImageInfo levelTargetInfo{VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+        if (!lve::LveDescriptorWriter(*reduceSetLayout, *descriptorPool)
+                .writeImage(0, &pyramidInfo)
+                .writeImage(1, &levelTargetInfo)
+                .build(levelReduceSets[level])) {
+            throw std::runtime_error("cant allocate depth pyramid descriptors");
+        }
+    }
+
+    log.printInfo("Depth pyramid: " + std::to_string(extent.width) + "x" + std::to_string(extent.height) +
+                  ", " + std::to_string(levelCount) + " levels");
+}
+
+void DepthPyramid::destroyPyramid() {
+    descriptorPool->resetPool();
+    levelReduceSets.clear();
+    for (auto view : levelViews)
+        vkDestroyImageView(device.getDevice(), view, nullptr);
+    levelViews.clear();
+    vkDestroyImageView(device.getDevice(), pyramidView, nullptr);
+    vkDestroyImage(device.getDevice(), image, nullptr);
+    vkFreeMemory(device.getDevice(), imageMemory, nullptr);
+    pyramidView = VK_NULL_HANDLE;
+    image = VK_NULL_HANDLE;
+    imageMemory = VK_NULL_HANDLE;
+}
+
+bool DepthPyramid::resize(VkExtent2D _depthExtent) {
+    if (_depthExtent.width == depthExtent.width && _depthExtent.height == depthExtent.height)
+        return false;
+
+    vkDeviceWaitIdle(device.getDevice());
+    destroyPyramid();
+    createPyramid(_depthExtent);
+    return true;
+}
+
+void DepthPyramid::build(VkCommandBuffer commandBuffer, int _frameIndex, VkImageView _depthView) {
+    //the frame's fence was waited on, nothing pending uses this set
+    VkDescriptorImageInfo depthInfo{sampler, _depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo targetInfo{VK_NULL_HANDLE, levelViews[0], VK_IMAGE_LAYOUT_GENERAL};
+    lve::LveDescriptorWriter(*reduceSetLayout, *descriptorPool)
+            .writeImage(0, &depthInfo)
+            .writeImage(1, &targetInfo)
+            .overwrite(depthReduceSets[_frameIndex]);
+
+    //the previous frame may still be sampling the pyramid in its culling pass
+    ComputePipeline::computeToCompute(commandBuffer);
+
+    reducePipeline->bind(commandBuffer);
+
+    DepthReducePushConstants push{};
+    push.sourceWidth = depthExtent.width;
+    push.sourceHeight = depthExtent.height;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        push.targetWidth = std::max(extent.width >> level, 1u);
+        push.targetHeight = std::max(extent.height >> level, 1u);
+        push.sourceLevel = level == 0 ? 0 : level - 1;
+
+        reducePipeline->bindDescriptorSets(commandBuffer, {level == 0 ? depthReduceSets[_frameIndex] : levelReduceSets[level]});
+        reducePipeline->pushConstants(commandBuffer, &push, sizeof(DepthReducePushConstants));
+        ComputePipeline::dispatch(commandBuffer,
+                                  (push.targetWidth + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE,
+                                  (push.targetHeight + REDUCE_GROUP_SIZE - 1) / REDUCE_GROUP_SIZE);
+        ComputePipeline::computeToCompute(commandBuffer);
+
+        push.sourceWidth = push.targetWidth;
+        push.sourceHeight = push.targetHeight;
+    }
+}
+
+VkDescriptorImageInfo DepthPyramid::descriptorInfo() const {
+    return VkDescriptorImageInfo{sampler, pyramidView, VK_IMAGE_LAYOUT_GENERAL};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <vector>
+#include "ComputePipeline.h"
+#include "Descriptors.h"
+#include "SwapChain.h"
+
+struct DepthReducePushConstants{
+    uint32_t sourceWidth = 0;
+    uint32_t sourceHeight = 0;
+    uint32_t targetWidth = 0;
+    uint32_t targetHeight = 0;
+    uint32_t sourceLevel = 0;
+};
+
+//hierarchical z buffer, every texel keeps the farthest depth of the area it covers, so a sample at a coarse
+//level tells whether anything behind it can still be seen. level 0 is the depth size rounded down to powers of two
+class DepthPyramid {
+public:
+    DepthPyramid(Device &_device, VkExtent2D _depthExtent, const Logger &_log);
+    ~DepthPyramid();
+
+    DepthPyramid(const DepthPyramid &) = delete;
+    DepthPyramid &operator=(const DepthPyramid &) = delete;
+
+    //recreates the pyramid for a new depth size, waits for the gpu when it does, returns true if it did.
+    //has to be called before anything referencing the pyramid is recorded in the frame
+    bool resize(VkExtent2D _depthExtent);
+    //reduces the depth the scene pass left in DEPTH_STENCIL_READ_ONLY_OPTIMAL, records compute work only
+    void build(VkCommandBuffer commandBuffer, int _frameIndex, VkImageView _depthView);
+
+    //whole mip chain in GENERAL layout with a nearest sampler, sample it with textureLod
+    VkDescriptorImageInfo descriptorInfo() const;
+    VkExtent2D getExtent() const { return extent; }
+    uint32_t getLevelCount() const { return levelCount; }
+
+    static constexpr uint32_t MAX_LEVELS = 16;
+
+private:
+    void createSampler();
+    void createDescriptors();
+    void createPyramid(VkExtent2D _depthExtent);
+    void destroyPyramid();
+
+    Device &device;
+    Logger log;
+
+    VkExtent2D depthExtent{0, 0};
+    VkExtent2D extent{0, 0};
+    uint32_t levelCount = 0;
+
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+    VkImageView pyramidView = VK_NULL_HANDLE;
+    std::vector<VkImageView> levelViews;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    std::unique_ptr<lve::LveDescriptorPool> descriptorPool;
+    std::unique_ptr<lve::LveDescriptorSetLayout> reduceSetLayout;
+    //level 0 reads the depth of the frame's swap chain image, so it is rewritten per frame in flight
+    VkDescriptorSet depthReduceSets[SwapChain::MAX_FRAMES_IN_FLIGHT]{};
+    std::vector<VkDescriptorSet> levelReduceSets;
+
+    std::unique_ptr<ComputePipeline> reducePipeline;
+};
@@ -12,7 +12,8 @@ namespace lve {
             uint32_t binding,
             VkDescriptorType descriptorType,
             VkShaderStageFlags stageFlags,
-            uint32_t count) {
+            uint32_t count,
+            VkDescriptorBindingFlags bindingFlags) {
         assert(bindings.count(binding) == 0 && "Binding already in use");
         VkDescriptorSetLayoutBinding layoutBinding{};
         layoutBinding.binding = binding;
@@ -20,27 +21,46 @@ namespace lve {
         layoutBinding.descriptorCount = count;
         layoutBinding.stageFlags = stageFlags;
         bindings[binding] = layoutBinding;
+        if (bindingFlags != 0)
+            this->bindingFlags[binding] = bindingFlags;
         return *this;
     }
 
     std::unique_ptr<LveDescriptorSetLayout> LveDescriptorSetLayout::Builder::build() const {
-        return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings);
+        return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings, bindingFlags);
     }
 
 // *************** Descriptor Set Layout *********************
 
     LveDescriptorSetLayout::LveDescriptorSetLayout(
-            Device &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+            Device &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags)
             : lveDevice{lveDevice}, bindings{bindings} {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        //flags in the same order as the bindings
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
+        bool updateAfterBind = false;
         for (auto kv : bindings) {
             setLayoutBindings.push_back(kv.second);
+            auto flagsIt = bindingFlags.find(kv.first);
+            VkDescriptorBindingFlags flags = flagsIt != bindingFlags.end() ? flagsIt->second : 0;
+            setLayoutBindingFlags.push_back(flags);
+            updateAfterBind |= (flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
         }
 
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+        if (!bindingFlags.empty())
+            descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+        if (updateAfterBind)
+            descriptorSetLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
 
         if (vkCreateDescriptorSetLayout(
                 lveDevice.getDevice(),
@@ -177,6 +197,28 @@ namespace lve {
         return *this;
     }
 
+    LveDescriptorWriter &LveDescriptorWriter::writeImages(
+            uint32_t binding, uint32_t firstElement, uint32_t count, VkDescriptorImageInfo *imageInfos) {
+        assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
+
+        auto &bindingDescription = setLayout.bindings[binding];
+
+        assert(
+                firstElement + count <= bindingDescription.descriptorCount &&
+                "Writing past the end of the binding's array");
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.descriptorType = bindingDescription.descriptorType;
+        write.dstBinding = binding;
+        write.dstArrayElement = firstElement;
+        write.pImageInfo = imageInfos;
+        write.descriptorCount = count;
+
+        writes.push_back(write);
+        return *this;
+    }
+
     bool LveDescriptorWriter::build(VkDescriptorSet &set) {
         bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
         if (!success) {
@@ -15,20 +15,24 @@ namespace lve {
         public:
             Builder(Device &lveDevice) : lveDevice{lveDevice} {}
 
+            //bindings with VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT need a pool built with the matching flag
             Builder &addBinding(
                     uint32_t binding,
                     VkDescriptorType descriptorType,
                     VkShaderStageFlags stageFlags,
-                    uint32_t count = 1);
+                    uint32_t count = 1,
+                    VkDescriptorBindingFlags bindingFlags = 0);
             std::unique_ptr<LveDescriptorSetLayout> build() const;
 
         private:
             Device &lveDevice;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
         };
 
         LveDescriptorSetLayout(
-                Device &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+                Device &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+                const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags = {});
         ~LveDescriptorSetLayout();
         LveDescriptorSetLayout(const LveDescriptorSetLayout &) = delete;
         LveDescriptorSetLayout &operator=(const LveDescriptorSetLayout &) = delete;
@@ -91,6 +95,8 @@ namespace lve {
 
         LveDescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
         LveDescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
+        //count elements of an array binding starting at firstElement, imageInfos has one entry per element
+        LveDescriptorWriter &writeImages(uint32_t binding, uint32_t firstElement, uint32_t count, VkDescriptorImageInfo *imageInfos);
 
         bool build(VkDescriptorSet &set);
         void overwrite(VkDescriptorSet &set);
@@ -14,7 +14,8 @@ Device::Device(const Window &_window, const Logger &_log) : window(_window), log
 
     queueFamilySetupData = Vh::findQueueFamilies(physicalDevice, surface_);
     populatedQueueFamiliesData = Vh::populateQueueCreateInfo(queueFamilySetupData);
-    device_ = Vh::createLogicalDevice(physicalDevice, queueFamilySetupData, populatedQueueFamiliesData);
+    features = Vh::queryDeviceFeatures(physicalDevice);
+    device_ = Vh::createLogicalDevice(physicalDevice, queueFamilySetupData, populatedQueueFamiliesData, features);
     commandPool = Vh::createCommandPool(device_, queueFamilySetupData);
 
     graphicsQueue = Vh::createGraphicsQueue(device_, queueFamilySetupData);
@@ -121,7 +122,7 @@ void Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryP
 
 }
 
-VkResult Device::copyBuffer(VkBuffer const &_srcBuffer, VkBuffer const &_dstBuffer, VkDeviceSize size) {
+VkResult Device::copyBuffer(VkBuffer const &_srcBuffer, VkBuffer const &_dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset, VkDeviceSize srcOffset) {
 
     VkResult res;
 
@@ -141,8 +142,8 @@ VkResult Device::copyBuffer(VkBuffer const &_srcBuffer, VkBuffer const &_dstBuff
     vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
     VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0; // Optional
-    copyRegion.dstOffset = 0; // Optional
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(commandBuffer, _srcBuffer, _dstBuffer, 1, &copyRegion);
 
@@ -161,6 +162,40 @@ VkResult Device::copyBuffer(VkBuffer const &_srcBuffer, VkBuffer const &_dstBuff
     return res;
 }
 
+VkCommandBuffer Device::beginSingleTimeCommands() {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    return commandBuffer;
+}
+
+VkResult Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    VkResult res = vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+
+    vkQueueWaitIdle(graphicsQueue);
+    vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+
+    return res;
+}
+
 VkResult Device::copyBufferToImage(VkBuffer const &_srcBuffer, VkImage const &_dstImage, uint32_t width, uint32_t height) {
     VkResult res;
 
@@ -7,6 +7,7 @@
 #include "../Logger/Logger.h"
 #include "QueueFamilyIndices.h"
 #include "SwapChainSupportDetails.h"
+#include "DeviceFeatures.h"
 
 class Device {
 public:
@@ -41,10 +42,14 @@ public:
     VkQueue getGraphicsQueue(){return graphicsQueue;};
     VkQueue getPresentationQueue(){return presentationQueue;};
     VkCommandPool getCommandPool(){return commandPool;};
-    VkResult copyBuffer(const VkBuffer & _srcBuffer, const VkBuffer & _dstBuffer, VkDeviceSize size);
+    VkResult copyBuffer(const VkBuffer & _srcBuffer, const VkBuffer & _dstBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0, VkDeviceSize srcOffset = 0);
     VkResult copyBufferToImage(const VkBuffer & _srcBuffer, const VkImage & _dstImage, uint32_t width, uint32_t height);
+    //one shot command buffer on the graphics queue, end submits it and waits for the queue
+    VkCommandBuffer beginSingleTimeCommands();
+    VkResult endSingleTimeCommands(VkCommandBuffer commandBuffer);
     VkInstance getInstance(){return instance; }
     VkSampleCountFlags getMaxUsableSampleCount() const;
+    const DeviceFeatures& getFeatures() const {return features;}
 
 private:
     Logger log;
@@ -57,6 +62,7 @@ private:
     VkDevice device_;
     VkSurfaceKHR surface_;
     QueueFamilyIndices queueFamilySetupData;
+    DeviceFeatures features;
     std::vector<VkDeviceQueueCreateInfo> populatedQueueFamiliesData;
 
     const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
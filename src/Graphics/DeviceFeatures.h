@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+//optional features, each one is enabled at device creation only when the gpu supports it
+struct DeviceFeatures {
+    //the device reports vulkan 1.2, every feature below that needs it stays false otherwise
+    bool vulkan12 = false;
+    bool multiDrawIndirect = false;
+    bool drawIndirectCount = false;
+    //draws a single indirect call may issue, 1 without multiDrawIndirect
+    uint32_t maxDrawIndirectCount = 1;
+    //sampler arrays indexed with a value that is the same for the whole draw
+    bool sampledImageArrayDynamicIndexing = false;
+    //sampler arrays indexed per fragment, partially bound and updated after being bound, what the bindless texture
+    //table needs
+    bool descriptorIndexing = false;
+    //largest such array a fragment shader may use, 0 without descriptorIndexing
+    uint32_t maxBindlessTextures = 0;
+};
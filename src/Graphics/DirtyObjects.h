@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+//dense indices of objects whose per object gpu data is out of date, each one listed once. markAll stands for every
+//object, for changes that add, erase, reorder or replace objects instead of updating them. everything starts out of
+//date, a fresh buffer holds nothing yet
+class DirtyObjects {
+public:
+    void mark(uint32_t _object) {
+        if (all)
+            return;
+        if (_object >= markedList.size())
+            markedList.resize(_object + 1, 0);
+        if (markedList[_object])
+            return;
+        markedList[_object] = 1;
+        objectsList.push_back(_object);
+    }
+    void mark(const std::vector<uint32_t> &_objects) {
+        for (uint32_t object : _objects)
+            mark(object);
+    }
+    void markAll() {
+        clearList();
+        all = true;
+    }
+    //adds everything _other holds
+    void merge(const DirtyObjects &_other) {
+        if (_other.all)
+            markAll();
+        else
+            mark(_other.objectsList);
+    }
+    void clear() {
+        clearList();
+        all = false;
+    }
+
+    bool isAllDirty() const { return all; }
+    bool empty() const { return !all && objectsList.empty(); }
+    //in the order they were marked, meaningless once isAllDirty
+    const std::vector<uint32_t> &getList() const { return objectsList; }
+
+private:
+    void clearList() {
+        for (uint32_t object : objectsList)
+            markedList[object] = 0;
+        objectsList.clear();
+    }
+
+    std::vector<uint32_t> objectsList;
+    std::vector<uint8_t> markedList;
+    bool all = true;
+};
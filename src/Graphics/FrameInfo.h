@@ -1,12 +1,25 @@
 #pragma once
 
 #include "Camera.h"
+#include "CommandRecorder.h"
+#include "DirtyObjects.h"
+#include "SceneGraph.h"
 #include <vulkan/vulkan.h>
 
+class TextureTable;
+
 struct FrameInfo{
     int frameIndex;
     float frameTime;
     VkCommandBuffer commandBuffer;
+    //graphics commands of every system go through it, so state already set is not set again
+    CommandRecorder &recorder;
     Camera &camera;
     VkDescriptorSet &globalDescriptorSet;
+    //world and normal matrices of the objects, by object index
+    const SceneGraph &sceneGraph;
+    //slots of the textures in the global set, instances carry the ones of their objects
+    const TextureTable &textureTable;
+    //objects whose matrices, level, mesh or texture changed since the last recorded frame
+    const DirtyObjects &changedObjects;
 };
\ No newline at end of file
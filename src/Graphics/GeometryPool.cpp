@@ -0,0 +1,261 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+GeometryPool::RangeAllocator::RangeAllocator(uint32_t _capacity) : capacity(_capacity) {
+    if (capacity > 0)
+        freeRanges.emplace(0, capacity);
+}
+
+bool GeometryPool::RangeAllocator::allocate(uint32_t _count, uint32_t &_offset) {
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < _count)
+            continue;
+
+        _offset = it->first;
+        uint32_t remaining = it->second - _count;
+        freeRanges.erase(it);
+        if (remaining > 0)
+            freeRanges.emplace(_offset + _count, remaining);
+        used += _count;
+        return true;
+    }
+    return false;
+}
+
+void GeometryPool::RangeAllocator::free(uint32_t _offset, uint32_t _count) {
+    assert(used >= _count && "freeing more than was allocated");
+    used -= _count;
+
+    auto next = freeRanges.lower_bound(_offset);
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == _offset) {
+            _offset = previous->first;
+            _count += previous->second;
+            freeRanges.erase(previous);
+        }
+    }
+    if (next != freeRanges.end() && _offset + _count == next->first) {
+        _count += next->second;
+        freeRanges.erase(next);
+    }
+    freeRanges.emplace(_offset, _count);
+}
+
+void GeometryPool::RangeAllocator::grow(uint32_t _capacity) {
+    assert(_capacity >= capacity && "allocators only grow");
+    uint32_t added = _capacity - capacity;
+    uint32_t offset = capacity;
+    capacity = _capacity;
+    if (added == 0)
+        return;
+    //counted as used so releasing it merges it with a free tail like any other range
+    used += added;
+    free(offset, added);
+}
+
+
+GeometryPool::GeometryPool(Device &_device, VkDeviceSize _vertexStride, VkDeviceSize _positionStride,
+                           uint32_t _blockVertices, uint32_t _blockIndices)
+        : device(_device), vertexStride(_vertexStride), positionStride(_positionStride), blockVertices(_blockVertices), blockIndices(_blockIndices) {
+    //most meshes fit 16 bit indices, 32 bit blocks are only added once a mesh needs one
+    addBlock(blockVertices, blockIndices, VK_INDEX_TYPE_UINT16);
+    growMeshlets(DEFAULT_MESHLETS);
+}
+
+void GeometryPool::growMeshlets(uint32_t _capacity) {
+    auto grown = std::make_unique<Buffer>(device,
+                                          sizeof(Meshlet),
+                                          _capacity,
+                                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (meshletBuffer != nullptr) {
+        //frames in flight cull with the old buffer
+        vkDeviceWaitIdle(device.getDevice());
+        VkDeviceSize size = sizeof(Meshlet) * static_cast<VkDeviceSize>(meshletAllocator.getCapacity());
+        if (device.copyBuffer(meshletBuffer->getBuffer(), grown->getBuffer(), size) != VK_SUCCESS)
+            throw std::runtime_error("cant copy meshlets into the grown buffer");
+    }
+    meshletBuffer = std::move(grown);
+    meshletAllocator.grow(_capacity);
+}
+
+void GeometryPool::addBlock(uint32_t _vertexCapacity, uint32_t _indexCapacity, VkIndexType _indexType) {
+    Block block{
+            std::make_unique<Buffer>(device,
+                                     vertexStride,
+                                     _vertexCapacity,
+                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+            std::make_unique<Buffer>(device,
+                                     getIndexSize(_indexType),
+                                     _indexCapacity,
+                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+            nullptr,
+            RangeAllocator{_vertexCapacity},
+            RangeAllocator{_indexCapacity},
+            _indexType,
+    };
+    if (positionStride > 0)
+        block.positionBuffer = std::make_unique<Buffer>(device,
+                                                        positionStride,
+                                                        _vertexCapacity,
+                                                        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    blocksList.push_back(std::move(block));
+}
+
+GeometryRange GeometryPool::allocate(const void *_vertices, const void *_positions, uint32_t _vertexCount,
+                                     const void *_indices, uint32_t _indexCount, VkIndexType _indexType,
+                                     const Meshlet *_meshlets, uint32_t _meshletCount) {
+    assert((positionStride == 0 || _positions != nullptr) && "pool has a position stream but no positions were given");
+    assert((_indexType == VK_INDEX_TYPE_UINT32 || _vertexCount <= 65536) && "too many vertices for 16 bit indices");
+    GeometryRange range{};
+    range.vertexCount = _vertexCount;
+    range.indexCount = _indexCount;
+    range.indexType = _indexType;
+
+    bool found = false;
+    for (uint32_t i = 0; i < blocksList.size() && !found; ++i) {
+        auto &block = blocksList[i];
+        if (block.indexType != _indexType)
+            continue;
+        if (!block.vertices.allocate(_vertexCount, range.vertexOffset))
+            continue;
+        if (_indexCount > 0 && !block.indices.allocate(_indexCount, range.firstIndex)) {
+            block.vertices.free(range.vertexOffset, _vertexCount);
+            continue;
+        }
+        range.block = i;
+        found = true;
+    }
+
+    if (!found) {
+        //meshes bigger than a default block get a block of their own
+        addBlock(std::max(blockVertices, _vertexCount), std::max(blockIndices, _indexCount), _indexType);
+        range.block = static_cast<uint32_t>(blocksList.size() - 1);
+        auto &block = blocksList.back();
+        block.vertices.allocate(_vertexCount, range.vertexOffset);
+        if (_indexCount > 0)
+            block.indices.allocate(_indexCount, range.firstIndex);
+    }
+
+    if (_meshletCount > 0) {
+        if (!meshletAllocator.allocate(_meshletCount, range.firstMeshlet)) {
+            growMeshlets(std::max(meshletAllocator.getCapacity() * 2, meshletAllocator.getCapacity() + _meshletCount));
+            meshletAllocator.allocate(_meshletCount, range.firstMeshlet);
+        }
+        range.meshletCount = _meshletCount;
+        upload(*meshletBuffer, _meshlets, sizeof(Meshlet) * _meshletCount, sizeof(Meshlet) * range.firstMeshlet);
+    }
+
+    auto &block = blocksList[range.block];
+    upload(*block.vertexBuffer, _vertices, vertexStride * _vertexCount, vertexStride * range.vertexOffset);
+    if (block.positionBuffer)
+        upload(*block.positionBuffer, _positions, positionStride * _vertexCount, positionStride * range.vertexOffset);
+    if (_indexCount > 0) {
+        VkDeviceSize indexSize = getIndexSize(_indexType);
+        upload(*block.indexBuffer, _indices, indexSize * _indexCount, indexSize * range.firstIndex);
+    }
+
+    return range;
+}
+
+void GeometryPool::free(const GeometryRange &_range) {
+    auto &block = blocksList[_range.block];
+    if (_range.vertexCount > 0)
+        block.vertices.free(_range.vertexOffset, _range.vertexCount);
+    if (_range.indexCount > 0)
+        block.indices.free(_range.firstIndex, _range.indexCount);
+    if (_range.meshletCount > 0)
+        meshletAllocator.free(_range.firstMeshlet, _range.meshletCount);
+}
+
+void GeometryPool::read(const GeometryRange &_range, void *_vertices, void *_indices) const {
+    const auto &block = blocksList[_range.block];
+    if (_range.vertexCount > 0)
+        download(*block.vertexBuffer, _vertices, vertexStride * _range.vertexCount, vertexStride * _range.vertexOffset);
+    if (_range.indexCount > 0) {
+        VkDeviceSize indexSize = getIndexSize(_range.indexType);
+        download(*block.indexBuffer, _indices, indexSize * _range.indexCount, indexSize * _range.firstIndex);
+    }
+}
+
+void GeometryPool::upload(const Buffer &_dstBuffer, const void *_data, VkDeviceSize _size, VkDeviceSize _dstOffset) {
+    Buffer stagingBuffer{
+            device,
+            _size,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+
+    stagingBuffer.map();
+    stagingBuffer.writeToBuffer(const_cast<void *>(_data));
+    stagingBuffer.unmap();
+
+    if (device.copyBuffer(stagingBuffer.getBuffer(), _dstBuffer.getBuffer(), _size, _dstOffset) != VK_SUCCESS) {
+        throw std::runtime_error("cant copy local buffer to gpu");
+    }
+}
+
+void GeometryPool::download(const Buffer &_srcBuffer, void *_data, VkDeviceSize _size, VkDeviceSize _srcOffset) const {
+    Buffer stagingBuffer{
+            device,
+            _size,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+
+    if (device.copyBuffer(_srcBuffer.getBuffer(), stagingBuffer.getBuffer(), _size, 0, _srcOffset) != VK_SUCCESS) {
+        throw std::runtime_error("cant copy gpu buffer to local");
+    }
+
+    stagingBuffer.map();
+    std::memcpy(_data, stagingBuffer.getMappedMemory(), static_cast<size_t>(_size));
+    stagingBuffer.unmap();
+}
+
+void GeometryPool::bind(CommandRecorder &_recorder, uint32_t _block) const {
+    const auto &block = blocksList[_block];
+
+    VkBuffer buffer[] = {block.vertexBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+
+    _recorder.bindVertexBuffers(0, 1, buffer, offsets);
+    _recorder.bindIndexBuffer(block.indexBuffer->getBuffer(), 0, block.indexType);
+}
+
+void GeometryPool::bindPositions(CommandRecorder &_recorder, uint32_t _block) const {
+    const auto &block = blocksList[_block];
+    assert(block.positionBuffer && "pool was created without a position stream");
+
+    VkBuffer buffer[] = {block.positionBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+
+    _recorder.bindVertexBuffers(0, 1, buffer, offsets);
+    _recorder.bindIndexBuffer(block.indexBuffer->getBuffer(), 0, block.indexType);
+}
+
+VkDeviceSize GeometryPool::getReservedMemory() const {
+    VkDeviceSize size = 0;
+    for (const auto &block : blocksList) {
+        size += block.vertexBuffer->getBufferSize() + block.indexBuffer->getBufferSize();
+        if (block.positionBuffer)
+            size += block.positionBuffer->getBufferSize();
+    }
+    return size + meshletBuffer->getBufferSize();
+}
+
+VkDeviceSize GeometryPool::getUsedMemory() const {
+    VkDeviceSize size = 0;
+    for (const auto &block : blocksList)
+        size += (vertexStride + positionStride) * block.vertices.getUsed() + getIndexSize(block.indexType) * block.indices.getUsed();
+    return size + sizeof(Meshlet) * meshletAllocator.getUsed();
+}
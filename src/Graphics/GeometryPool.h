@@ -0,0 +1,118 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Buffer.h"
+#include "CommandRecorder.h"
+#include "MeshletBuilder.h"
+
+//where a mesh lives inside the pool, offsets are in vertices and indices, not bytes
+struct GeometryRange {
+    uint32_t block = 0;
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    //into the meshlet buffer, which is shared by all blocks
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+};
+
+//a few large device local vertex and index buffers that every mesh is suballocated from.
+//meshes sharing a block are drawn after a single bind, using vertexOffset and firstIndex.
+//with a position stride every block also keeps a tightly packed position only copy of its vertices at the same
+//offsets, so depth only passes can skip fetching the rest of the vertex.
+//every block holds one index type, meshes with up to 65536 vertices go to 16 bit blocks and the rest to 32 bit ones.
+//meshlets of all blocks live in one storage buffer, so culling shaders can reach every mesh through one binding
+class GeometryPool {
+public:
+    static constexpr uint32_t DEFAULT_BLOCK_VERTICES = 1u << 20;
+    static constexpr uint32_t DEFAULT_BLOCK_INDICES = 3u << 20;
+    static constexpr uint32_t DEFAULT_MESHLETS = 1u << 14;
+
+    GeometryPool(Device &_device, VkDeviceSize _vertexStride, VkDeviceSize _positionStride = 0,
+                 uint32_t _blockVertices = DEFAULT_BLOCK_VERTICES, uint32_t _blockIndices = DEFAULT_BLOCK_INDICES);
+
+    GeometryPool(const GeometryPool &) = delete;
+    GeometryPool &operator=(const GeometryPool &) = delete;
+
+    //finds room in the first block of the index type with space for both streams, adds a block when none has, and
+    //uploads the data. _positions is needed when the pool has a position stream and ignored otherwise.
+    //a full meshlet buffer is replaced by a larger one, which waits for the gpu
+    GeometryRange allocate(const void *_vertices, const void *_positions, uint32_t _vertexCount,
+                           const void *_indices, uint32_t _indexCount, VkIndexType _indexType,
+                           const Meshlet *_meshlets = nullptr, uint32_t _meshletCount = 0);
+    //the caller makes sure no frame in flight still draws the range
+    void free(const GeometryRange &_range);
+    //copies a range's vertices and indices back to the cpu and waits for the gpu, for build steps that need a mesh
+    //after its upload. _vertices takes vertexCount * vertexStride bytes, _indices indexCount indices of the range's type
+    void read(const GeometryRange &_range, void *_vertices, void *_indices) const;
+
+    void bind(CommandRecorder &_recorder, uint32_t _block) const;
+    //binds the position stream in place of the full vertices, same offsets and indices
+    void bindPositions(CommandRecorder &_recorder, uint32_t _block) const;
+
+    Device &getDevice() const { return device; }
+    VkDeviceSize getVertexStride() const { return vertexStride; }
+    VkDeviceSize getPositionStride() const { return positionStride; }
+    bool hasPositionStream() const { return positionStride > 0; }
+    uint32_t getBlockCount() const { return static_cast<uint32_t>(blocksList.size()); }
+    VkBuffer getVertexBuffer(uint32_t _block) const { return blocksList[_block].vertexBuffer->getBuffer(); }
+    VkBuffer getIndexBuffer(uint32_t _block) const { return blocksList[_block].indexBuffer->getBuffer(); }
+    VkIndexType getIndexType(uint32_t _block) const { return blocksList[_block].indexType; }
+    Buffer &getMeshletBuffer() const { return *meshletBuffer; }
+    //only ever grows, a new value means descriptors pointing at the meshlet buffer are stale
+    uint32_t getMeshletCapacity() const { return meshletAllocator.getCapacity(); }
+    VkDeviceSize getReservedMemory() const;
+    VkDeviceSize getUsedMemory() const;
+
+    static VkDeviceSize getIndexSize(VkIndexType _indexType) { return _indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+    //the narrowest type that can address _vertexCount vertices from the range's vertexOffset
+    static VkIndexType selectIndexType(uint32_t _vertexCount) { return _vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+
+private:
+    //first fit over a free list kept sorted by offset, neighbours are merged on release
+    class RangeAllocator {
+    public:
+        explicit RangeAllocator(uint32_t _capacity);
+
+        bool allocate(uint32_t _count, uint32_t &_offset);
+        void free(uint32_t _offset, uint32_t _count);
+        //appends free space at the end
+        void grow(uint32_t _capacity);
+
+        uint32_t getCapacity() const { return capacity; }
+        uint32_t getUsed() const { return used; }
+
+    private:
+        std::map<uint32_t, uint32_t> freeRanges;
+        uint32_t capacity;
+        uint32_t used = 0;
+    };
+
+    struct Block {
+        std::unique_ptr<Buffer> vertexBuffer;
+        std::unique_ptr<Buffer> indexBuffer;
+        std::unique_ptr<Buffer> positionBuffer;
+        RangeAllocator vertices;
+        RangeAllocator indices;
+        VkIndexType indexType;
+    };
+
+    void addBlock(uint32_t _vertexCapacity, uint32_t _indexCapacity, VkIndexType _indexType);
+    void growMeshlets(uint32_t _capacity);
+    void upload(const Buffer &_dstBuffer, const void *_data, VkDeviceSize _size, VkDeviceSize _dstOffset);
+    void download(const Buffer &_srcBuffer, void *_data, VkDeviceSize _size, VkDeviceSize _srcOffset) const;
+
+    Device &device;
+    VkDeviceSize vertexStride;
+    VkDeviceSize positionStride;
+    uint32_t blockVertices;
+    uint32_t blockIndices;
+    std::vector<Block> blocksList;
+    std::unique_ptr<Buffer> meshletBuffer;
+    RangeAllocator meshletAllocator{0};
+};
@@ -83,3 +83,9 @@ VkDescriptorImageInfo ImageBuffer::descriptorInfo() {
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
     };
 }
+
+VkDeviceSize ImageBuffer::getMemorySize() const {
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device.getDevice(), textureImage, &memRequirements);
+    return memRequirements.size;
+}
@@ -21,6 +21,7 @@ private:
 
 public:
     VkImage& getImage(){return textureImage;}
+    VkDeviceSize getMemorySize() const;
 
 public:
     void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
@@ -0,0 +1,54 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <glm/geometric.hpp>
+
+void LodSelector::select(SlotMap<Object> &_objects, const SceneGraph &_sceneGraph, Camera &_camera, float _viewportHeight) {
+    const glm::mat4 &projection = _camera.getProjectionMatrix();
+    const glm::mat4 &view = _camera.getViewMatrix();
+    //a perspective projection divides by view depth, an orthographic one keeps the same size at every distance
+    bool perspective = projection[2][3] != 0.0f;
+    float pixelsPerUnit = std::abs(projection[1][1]) * _viewportHeight * 0.5f;
+
+    stats = {};
+    changedList.clear();
+    for (size_t i = 0; i < _objects.size(); ++i) {
+        auto &obj = _objects[i];
+        const Model &mesh = *obj.mesh;
+        const glm::mat4 &modelMatrix = _sceneGraph.getWorldMatrix(static_cast<uint32_t>(i));
+        float scale = std::max({glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])),
+                                glm::length(glm::vec3(modelMatrix[2]))});
+
+        //the nearest point of the bounding sphere decides, objects around the camera stay at full detail
+        const glm::vec4 &sphere = mesh.getBoundingSphere();
+        float objectPixelsPerUnit = pixelsPerUnit * scale;
+        if (perspective) {
+            float depth = (view * modelMatrix * glm::vec4(glm::vec3(sphere), 1.0f)).z - sphere.w * scale;
+            objectPixelsPerUnit = depth > 0.0f ? objectPixelsPerUnit / depth : FLT_MAX;
+        }
+        uint32_t lod = selectLod(mesh, objectPixelsPerUnit, obj.lod);
+        if (lod != obj.lod) {
+            stats.changedObjects++;
+            changedList.push_back(static_cast<uint32_t>(i));
+        }
+        obj.lod = lod;
+
+        uint32_t fullTriangles = mesh.getLod(0).indexCount / 3;
+        uint32_t selectedTriangles = mesh.getLod(obj.lod).indexCount / 3;
+        stats.objects++;
+        stats.reducedObjects += obj.lod > 0 ? 1 : 0;
+        stats.trianglesFull += fullTriangles;
+        stats.trianglesSelected += selectedTriangles;
+    }
+}
+
+uint32_t LodSelector::selectLod(const Model &_mesh, float _pixelsPerUnit, uint32_t _currentLod) const {
+    uint32_t lod = std::min(_currentLod, _mesh.getLodCount() - 1);
+    while (lod > 0 && _mesh.getLod(lod).error * _pixelsPerUnit > pixelError)
+        lod--;
+    while (lod + 1 < _mesh.getLodCount() && _mesh.getLod(lod + 1).error * _pixelsPerUnit <= pixelError * (1.0f - HYSTERESIS))
+        lod++;
+    return lod;
+}
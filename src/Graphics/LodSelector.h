@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Camera.h"
+#include "SceneGraph.h"
+
+//triangles of the frame's objects before culling, at full detail and at the picked levels
+struct LodStats {
+    uint32_t objects = 0;
+    uint32_t reducedObjects = 0;
+    //objects that switched levels in this select
+    uint32_t changedObjects = 0;
+    uint32_t trianglesFull = 0;
+    uint32_t trianglesSelected = 0;
+};
+
+//picks every object's level of detail from how large the level's error shows up on screen. a level is used while its
+//error stays under pixelError pixels, and only replaced by a coarser one once that one stays under
+//pixelError * (1 - HYSTERESIS), so objects sitting near a switching distance do not pop back and forth
+class LodSelector {
+public:
+    static constexpr float DEFAULT_PIXEL_ERROR = 1.0f;
+    static constexpr float HYSTERESIS = 0.25f;
+
+    explicit LodSelector(float _pixelError = DEFAULT_PIXEL_ERROR) : pixelError(_pixelError) {}
+
+    //updates Object::lod, _viewportHeight is in pixels. _sceneGraph holds the objects' world matrices by index
+    void select(SlotMap<Object> &_objects, const SceneGraph &_sceneGraph, Camera &_camera, float _viewportHeight);
+
+    //counts of the last select
+    const LodStats &getStats() const { return stats; }
+    //objects that switched levels in the last select, ascending
+    const std::vector<uint32_t> &getChangedList() const { return changedList; }
+
+private:
+    //_pixelsPerUnit turns a model space distance into pixels at the object's distance
+    uint32_t selectLod(const Model &_mesh, float _pixelsPerUnit, uint32_t _currentLod) const;
+
+    float pixelError;
+    LodStats stats{};
+    std::vector<uint32_t> changedList;
+};
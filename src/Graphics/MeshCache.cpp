@@ -0,0 +1,146 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+static constexpr char MESH_MAGIC[4] = {'S', 'M', 'S', 'H'};
+
+std::string MeshCache::directory = "cache/meshes";
+
+std::string MeshCache::getPath(uint64_t _contentHash) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.mesh", static_cast<unsigned long long>(_contentHash));
+    return directory + "/" + name;
+}
+
+//a file that passed the header checks can still be truncated or corrupt, anything out of range would later index
+//past the vertices or the pool's ranges, so it counts as a miss like an old version
+static bool isConsistent(uint32_t _vertexCount, const std::vector<uint32_t> &_indices, const std::vector<MeshLod> &_lods,
+                         const std::vector<Meshlet> &_meshlets) {
+    if (_indices.size() % 3 != 0)
+        return false;
+    for (uint32_t index : _indices) {
+        if (index >= _vertexCount)
+            return false;
+    }
+    for (const auto &lod : _lods) {
+        if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > _indices.size() || lod.indexCount % 3 != 0 ||
+            static_cast<uint64_t>(lod.firstMeshlet) + lod.meshletCount > _meshlets.size())
+            return false;
+        for (uint32_t i = lod.firstMeshlet; i < lod.firstMeshlet + lod.meshletCount; ++i) {
+            const auto &meshlet = _meshlets[i];
+            if (static_cast<uint64_t>(meshlet.firstIndex) + static_cast<uint64_t>(meshlet.triangleCount) * 3 > lod.indexCount)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool MeshCache::load(uint64_t _contentHash, Builder &builder) {
+    std::string path = getPath(_contentHash);
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return false;
+
+    Header header{};
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in || memcmp(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC)) != 0 || header.version != VERSION ||
+        header.vertexSize != sizeof(Vertex) || header.contentHash != _contentHash ||
+        (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)))
+        return false;
+    //indices are uploaded in the type the vertex count picks, the stored ones have to match it
+    uint32_t expectedIndexSize = GeometryPool::selectIndexType(header.vertexCount) == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    if (header.indexSize != expectedIndexSize)
+        return false;
+    //the counts are checked against the file before anything is allocated for them
+    uint64_t expectedSize = sizeof(Header) + static_cast<uint64_t>(header.vertexCount) * sizeof(Vertex) +
+                            static_cast<uint64_t>(header.indexCount) * header.indexSize +
+                            static_cast<uint64_t>(header.lodCount) * sizeof(MeshLod) +
+                            static_cast<uint64_t>(header.meshletCount) * sizeof(Meshlet);
+    std::error_code error;
+    auto fileSize = std::filesystem::file_size(path, error);
+    if (error || fileSize != expectedSize)
+        return false;
+
+    std::vector<Vertex> verticesList(header.vertexCount);
+    std::vector<uint32_t> indicesList(header.indexCount);
+    std::vector<uint16_t> compactIndicesList;
+    in.read(reinterpret_cast<char *>(verticesList.data()), static_cast<std::streamsize>(sizeof(Vertex) * verticesList.size()));
+    if (header.indexSize == sizeof(uint16_t)) {
+        compactIndicesList.resize(header.indexCount);
+        in.read(reinterpret_cast<char *>(compactIndicesList.data()), static_cast<std::streamsize>(sizeof(uint16_t) * compactIndicesList.size()));
+        std::copy(compactIndicesList.begin(), compactIndicesList.end(), indicesList.begin());
+    } else {
+        in.read(reinterpret_cast<char *>(indicesList.data()), static_cast<std::streamsize>(sizeof(uint32_t) * indicesList.size()));
+    }
+    std::vector<MeshLod> lodsList(header.lodCount);
+    in.read(reinterpret_cast<char *>(lodsList.data()), static_cast<std::streamsize>(sizeof(MeshLod) * lodsList.size()));
+    std::vector<Meshlet> meshletsList(header.meshletCount);
+    in.read(reinterpret_cast<char *>(meshletsList.data()), static_cast<std::streamsize>(sizeof(Meshlet) * meshletsList.size()));
+    if (!in || !isConsistent(header.vertexCount, indicesList, lodsList, meshletsList))
+        return false;
+
+    builder.vertices = std::move(verticesList);
+    builder.indices = std::move(indicesList);
+    builder.compactIndices = std::move(compactIndicesList);
+    builder.indexType = header.indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    builder.lods = std::move(lodsList);
+    builder.meshlets = std::move(meshletsList);
+    builder.optimizationStats = header.optimizationStats;
+    return true;
+}
+
+void MeshCache::store(uint64_t _contentHash, const Builder &builder) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error)
+        return;
+
+    Header header{};
+    memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+    header.version = VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+    header.indexCount = static_cast<uint32_t>(builder.indices.size());
+    //indices are stored in the type they are uploaded with, small meshes take half the space
+    std::vector<uint16_t> compactIndicesList;
+    if (GeometryPool::selectIndexType(header.vertexCount) == VK_INDEX_TYPE_UINT16) {
+        compactIndicesList.assign(builder.indices.begin(), builder.indices.end());
+        header.indexSize = sizeof(uint16_t);
+    } else {
+        header.indexSize = sizeof(uint32_t);
+    }
+    header.lodCount = static_cast<uint32_t>(builder.lods.size());
+    header.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+    header.contentHash = _contentHash;
+    header.optimizationStats = builder.optimizationStats;
+
+    //written under a name of its own and renamed into place, so readers never see a partial file
+    std::string path = getPath(_contentHash);
+    std::string temporaryPath = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+            return;
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(builder.vertices.data()), static_cast<std::streamsize>(sizeof(Vertex) * builder.vertices.size()));
+        if (header.indexSize == sizeof(uint16_t))
+            out.write(reinterpret_cast<const char *>(compactIndicesList.data()), static_cast<std::streamsize>(sizeof(uint16_t) * compactIndicesList.size()));
+        else
+            out.write(reinterpret_cast<const char *>(builder.indices.data()), static_cast<std::streamsize>(sizeof(uint32_t) * builder.indices.size()));
+        out.write(reinterpret_cast<const char *>(builder.lods.data()), static_cast<std::streamsize>(sizeof(MeshLod) * builder.lods.size()));
+        out.write(reinterpret_cast<const char *>(builder.meshlets.data()), static_cast<std::streamsize>(sizeof(Meshlet) * builder.meshlets.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temporaryPath, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+        std::filesystem::remove(temporaryPath, error);
+}
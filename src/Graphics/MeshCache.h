@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Model.h"
+
+//processed meshes on disk, one file per source content hash. a hit skips parsing and optimization, so the cost of
+//importing a model is paid once per machine. safe to call from several decoding threads at once
+class MeshCache {
+public:
+    //bump whenever the importer or the optimizer produce different results, old files are then ignored
+    static constexpr uint32_t VERSION = 4;
+
+    //fills vertices, indices, compact indices, lods, meshlets and optimization stats, false on a miss or a file that is
+    //unreadable, truncated or has anything out of range
+    static bool load(uint64_t _contentHash, Builder &builder);
+    //failures are ignored, the mesh just gets imported again next time
+    static void store(uint64_t _contentHash, const Builder &builder);
+
+    static void setDirectory(const std::string &_directory) { directory = _directory; }
+
+private:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexSize;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        //2 when the indices are stored as 16 bit, 4 otherwise
+        uint32_t indexSize;
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        uint64_t contentHash;
+        MeshOptimizationStats optimizationStats;
+    };
+
+    static std::string getPath(uint64_t _contentHash);
+
+    static std::string directory;
+};
@@ -0,0 +1,246 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+//a vertex is cached while fewer than _cacheSize misses happened since it was last loaded, which is exactly a fifo
+static bool isCached(const std::vector<uint32_t> &_cacheTime, uint32_t _vertex, uint32_t _timestamp, uint32_t _cacheSize) {
+    return _timestamp - _cacheTime[_vertex] <= _cacheSize;
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexCache(std::vector<uint32_t> &_indices, uint32_t _vertexCount, uint32_t _cacheSize) {
+    std::vector<uint32_t> clustersList;
+    uint32_t triangleCount = static_cast<uint32_t>(_indices.size() / 3);
+    if (triangleCount == 0)
+        return clustersList;
+
+    //triangles around every vertex, packed into one array
+    std::vector<uint32_t> liveTriangles(_vertexCount, 0);
+    for (uint32_t index : _indices)
+        liveTriangles[index]++;
+    std::vector<uint32_t> adjacencyOffsets(_vertexCount + 1, 0);
+    for (uint32_t v = 0; v < _vertexCount; ++v)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    std::vector<uint32_t> adjacency(_indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < _indices.size(); ++i)
+            adjacency[fill[_indices[i]]++] = i / 3;
+    }
+
+    std::vector<uint32_t> cacheTime(_vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEndStack;
+    deadEndStack.reserve(_indices.size());
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(_indices.size());
+
+    uint32_t timestamp = _cacheSize + 1;
+    uint32_t cursor = 0;
+
+    //recently used vertices that still have triangles first, then the next one in input order
+    auto skipDeadEnd = [&]() -> uint32_t {
+        while (!deadEndStack.empty()) {
+            uint32_t vertex = deadEndStack.back();
+            deadEndStack.pop_back();
+            if (liveTriangles[vertex] > 0)
+                return vertex;
+        }
+        while (cursor < _vertexCount) {
+            if (liveTriangles[cursor] > 0)
+                return cursor;
+            ++cursor;
+        }
+        return UNUSED;
+    };
+
+    uint32_t fanning = skipDeadEnd();
+    clustersList.push_back(0);
+    while (fanning != UNUSED) {
+        candidates.clear();
+        for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = 1;
+
+            for (uint32_t k = 0; k < 3; ++k) {
+                uint32_t vertex = _indices[triangle * 3 + k];
+                result.push_back(vertex);
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (!isCached(cacheTime, vertex, timestamp, _cacheSize))
+                    cacheTime[vertex] = timestamp++;
+            }
+        }
+
+        //the candidate that stays in the cache while its remaining triangles are emitted, oldest first
+        uint32_t next = UNUSED;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0)
+                continue;
+            int64_t priority = 0;
+            int64_t age = static_cast<int64_t>(timestamp) - cacheTime[vertex];
+            if (age + 2 * static_cast<int64_t>(liveTriangles[vertex]) <= _cacheSize)
+                priority = age;
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = vertex;
+            }
+        }
+        if (next == UNUSED) {
+            next = skipDeadEnd();
+            if (next != UNUSED)
+                clustersList.push_back(static_cast<uint32_t>(result.size() / 3));
+        }
+        fanning = next;
+    }
+
+    _indices.swap(result);
+    return clustersList;
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t> &_indices, const std::vector<uint32_t> &_clusters,
+                                     const float *_positions, size_t _positionStride, uint32_t _vertexCount,
+                                     float _threshold, uint32_t _cacheSize) {
+    uint32_t triangleCount = static_cast<uint32_t>(_indices.size() / 3);
+    if (triangleCount == 0 || _clusters.empty())
+        return;
+
+    //soft boundaries: inside a hard cluster a new one starts whenever the local acmr is good enough, the cache
+    //starts cold for every cluster since they get reordered anyway
+    float meshAcmr = analyzeVertexCache(_indices, _vertexCount, _cacheSize).acmr;
+    std::vector<uint32_t> clustersList;
+    std::vector<uint32_t> cacheTime(_vertexCount, 0);
+    uint32_t timestamp = _cacheSize + 1;
+    for (size_t c = 0; c < _clusters.size(); ++c) {
+        uint32_t end = c + 1 < _clusters.size() ? _clusters[c + 1] : triangleCount;
+        uint32_t start = _clusters[c];
+        uint32_t misses = 0;
+        clustersList.push_back(start);
+        timestamp += _cacheSize + 1;
+        for (uint32_t triangle = start; triangle < end; ++triangle) {
+            for (uint32_t k = 0; k < 3; ++k) {
+                uint32_t vertex = _indices[triangle * 3 + k];
+                if (!isCached(cacheTime, vertex, timestamp, _cacheSize)) {
+                    cacheTime[vertex] = timestamp++;
+                    misses++;
+                }
+            }
+            uint32_t clusterTriangles = triangle - clustersList.back() + 1;
+            if (triangle + 1 < end && static_cast<float>(misses) <= _threshold * meshAcmr * clusterTriangles) {
+                clustersList.push_back(triangle + 1);
+                misses = 0;
+                timestamp += _cacheSize + 1;
+            }
+        }
+        //a tail that never got within the budget would pay for its cold start, it stays with the piece before it
+        uint32_t tailTriangles = end - clustersList.back();
+        if (clustersList.back() != start && static_cast<float>(misses) > _threshold * meshAcmr * tailTriangles)
+            clustersList.pop_back();
+    }
+
+    auto position = [&](uint32_t _vertex) {
+        return reinterpret_cast<const float *>(reinterpret_cast<const char *>(_positions) + _positionStride * _vertex);
+    };
+
+    //area weighted centroid and normal of every cluster, cross products are twice the area times the normal
+    struct ClusterInfo {
+        float centroid[3];
+        float normal[3];
+        float area;
+    };
+    std::vector<ClusterInfo> infoList(clustersList.size(), ClusterInfo{{0, 0, 0}, {0, 0, 0}, 0});
+    float meshCentroid[3] = {0, 0, 0};
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clustersList.size(); ++c) {
+        uint32_t end = c + 1 < clustersList.size() ? clustersList[c + 1] : triangleCount;
+        auto &info = infoList[c];
+        for (uint32_t triangle = clustersList[c]; triangle < end; ++triangle) {
+            const float *p0 = position(_indices[triangle * 3 + 0]);
+            const float *p1 = position(_indices[triangle * 3 + 1]);
+            const float *p2 = position(_indices[triangle * 3 + 2]);
+            float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            float cross[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float area = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+            for (int axis = 0; axis < 3; ++axis) {
+                float center = (p0[axis] + p1[axis] + p2[axis]) / 3.0f;
+                info.centroid[axis] += center * area;
+                info.normal[axis] += cross[axis];
+                meshCentroid[axis] += center * area;
+            }
+            info.area += area;
+            meshArea += area;
+        }
+    }
+    if (meshArea > 0.0f) {
+        for (float &axis : meshCentroid)
+            axis /= meshArea;
+    }
+
+    std::vector<float> sortKeys(clustersList.size(), 0.0f);
+    for (size_t c = 0; c < clustersList.size(); ++c) {
+        auto &info = infoList[c];
+        if (info.area <= 0.0f)
+            continue;
+        float normalLength = std::sqrt(info.normal[0] * info.normal[0] + info.normal[1] * info.normal[1] + info.normal[2] * info.normal[2]);
+        if (normalLength <= 0.0f)
+            continue;
+        for (int axis = 0; axis < 3; ++axis)
+            sortKeys[c] += (info.centroid[axis] / info.area - meshCentroid[axis]) * info.normal[axis] / normalLength;
+    }
+
+    std::vector<uint32_t> order(clustersList.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(_indices.size());
+    for (uint32_t c : order) {
+        uint32_t end = c + 1 < clustersList.size() ? clustersList[c + 1] : triangleCount;
+        result.insert(result.end(), _indices.begin() + clustersList[c] * 3, _indices.begin() + end * 3);
+    }
+    _indices.swap(result);
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexFetch(std::vector<uint32_t> &_indices, uint32_t &_vertexCount) {
+    std::vector<uint32_t> remap(_vertexCount, UNUSED);
+    uint32_t nextVertex = 0;
+    for (uint32_t &index : _indices) {
+        if (remap[index] == UNUSED)
+            remap[index] = nextVertex++;
+        index = remap[index];
+    }
+    _vertexCount = nextVertex;
+    return remap;
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t> &_indices, uint32_t _vertexCount, uint32_t _cacheSize) {
+    VertexCacheStats stats{};
+    if (_indices.empty())
+        return stats;
+
+    std::vector<uint32_t> cacheTime(_vertexCount, 0);
+    std::vector<uint8_t> referenced(_vertexCount, 0);
+    uint32_t timestamp = _cacheSize + 1;
+    uint32_t misses = 0;
+    uint32_t uniqueVertices = 0;
+    for (uint32_t index : _indices) {
+        if (!referenced[index]) {
+            referenced[index] = 1;
+            uniqueVertices++;
+        }
+        if (!isCached(cacheTime, index, timestamp, _cacheSize)) {
+            cacheTime[index] = timestamp++;
+            misses++;
+        }
+    }
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(_indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
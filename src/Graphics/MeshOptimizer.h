@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//post transform cache efficiency of an index buffer under a simulated fifo cache.
+//acmr: cache misses per triangle, 0.5 is the ideal for large grids, 3 is no reuse at all.
+//atvr: cache misses per referenced vertex, 1 means every vertex is transformed exactly once
+struct VertexCacheStats {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+struct MeshOptimizationStats {
+    VertexCacheStats before{};
+    VertexCacheStats after{};
+};
+
+//import time reordering of indexed triangle lists, works on plain index and position arrays so it has no gpu
+//dependencies. the usual order is optimizeVertexCache, optimizeOverdraw, then optimizeVertexFetch
+class MeshOptimizer {
+public:
+    //slightly below the post transform cache of current gpus, so the result does not depend on the exact size
+    static constexpr uint32_t CACHE_SIZE = 16;
+    //how much acmr optimizeOverdraw may give up to split clusters into smaller, better sortable pieces
+    static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+    //tipsify (sander, nehab, barczak 2007): fans around the most recently cached vertices in linear time.
+    //returns the first triangle of every cluster that starts after a cache flush, for optimizeOverdraw
+    static std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t> &_indices, uint32_t _vertexCount,
+                                                     uint32_t _cacheSize = CACHE_SIZE);
+    //splits the clusters further while acmr stays within _threshold of the whole mesh, then orders them so the ones
+    //facing away from the mesh center come first, they are the likeliest to hide the rest and let early z reject it
+    static void optimizeOverdraw(std::vector<uint32_t> &_indices, const std::vector<uint32_t> &_clusters,
+                                 const float *_positions, size_t _positionStride, uint32_t _vertexCount,
+                                 float _threshold = OVERDRAW_THRESHOLD, uint32_t _cacheSize = CACHE_SIZE);
+    //renumbers vertices in order of first use so fetches walk memory forward. returns old index -> new index,
+    //unreferenced vertices map to UNUSED. _vertexCount is updated to the number of used vertices
+    static std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t> &_indices, uint32_t &_vertexCount);
+
+    static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t> &_indices, uint32_t _vertexCount,
+                                               uint32_t _cacheSize = CACHE_SIZE);
+
+    //applies the table of optimizeVertexFetch to any per vertex array
+    template<typename T>
+    static void remapVertices(std::vector<T> &_vertices, const std::vector<uint32_t> &_remap, uint32_t _vertexCount) {
+        std::vector<T> remapped(_vertexCount);
+        for (size_t i = 0; i < _remap.size(); ++i) {
+            if (_remap[i] != UNUSED)
+                remapped[_remap[i]] = _vertices[i];
+        }
+        _vertices.swap(remapped);
+    }
+
+    static constexpr uint32_t UNUSED = ~0u;
+};
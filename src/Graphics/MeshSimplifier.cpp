@@ -0,0 +1,436 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+static constexpr uint32_t NONE = ~0u;
+
+//manifold: inside a surface, collapses anywhere. border: on exactly one open edge loop. seam: two wedges that split
+//along exactly one edge loop. locked: anything more tangled, never moves
+enum VertexKind : uint8_t {
+    KIND_MANIFOLD,
+    KIND_BORDER,
+    KIND_SEAM,
+    KIND_LOCKED,
+};
+
+//source kind against target kind
+static constexpr bool CAN_COLLAPSE[4][4] = {
+        {true,  true,  true,  true},
+        {false, true,  false, true},
+        {false, false, true,  true},
+        {false, false, false, false},
+};
+
+//symmetric plane quadric, error(p) = p^T A p + 2 b^T p + c, divided by the accumulated weight
+struct Quadric {
+    float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f, a10 = 0.0f, a20 = 0.0f, a21 = 0.0f;
+    float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+    float c = 0.0f;
+    float weight = 0.0f;
+};
+
+static void addPlane(Quadric &_quadric, const float *_normal, float _distance, float _weight) {
+    float nx = _normal[0], ny = _normal[1], nz = _normal[2];
+    _quadric.a00 += _weight * nx * nx;
+    _quadric.a11 += _weight * ny * ny;
+    _quadric.a22 += _weight * nz * nz;
+    _quadric.a10 += _weight * ny * nx;
+    _quadric.a20 += _weight * nz * nx;
+    _quadric.a21 += _weight * nz * ny;
+    _quadric.b0 += _weight * nx * _distance;
+    _quadric.b1 += _weight * ny * _distance;
+    _quadric.b2 += _weight * nz * _distance;
+    _quadric.c += _weight * _distance * _distance;
+    _quadric.weight += _weight;
+}
+
+static void addQuadric(Quadric &_to, const Quadric &_from) {
+    _to.a00 += _from.a00;
+    _to.a11 += _from.a11;
+    _to.a22 += _from.a22;
+    _to.a10 += _from.a10;
+    _to.a20 += _from.a20;
+    _to.a21 += _from.a21;
+    _to.b0 += _from.b0;
+    _to.b1 += _from.b1;
+    _to.b2 += _from.b2;
+    _to.c += _from.c;
+    _to.weight += _from.weight;
+}
+
+//squared distance to the planes, weighted by their areas
+static float quadricError(const Quadric &_quadric, const float *_position) {
+    float x = _position[0], y = _position[1], z = _position[2];
+    float result = _quadric.a00 * x * x + _quadric.a11 * y * y + _quadric.a22 * z * z +
+                   2.0f * (_quadric.a10 * x * y + _quadric.a20 * x * z + _quadric.a21 * y * z) +
+                   2.0f * (_quadric.b0 * x + _quadric.b1 * y + _quadric.b2 * z) + _quadric.c;
+    return _quadric.weight > 0.0f ? std::fabs(result) / _quadric.weight : 0.0f;
+}
+
+static void cross(const float *_a, const float *_b, float *_result) {
+    _result[0] = _a[1] * _b[2] - _a[2] * _b[1];
+    _result[1] = _a[2] * _b[0] - _a[0] * _b[2];
+    _result[2] = _a[0] * _b[1] - _a[1] * _b[0];
+}
+
+static float dot(const float *_a, const float *_b) {
+    return _a[0] * _b[0] + _a[1] * _b[1] + _a[2] * _b[2];
+}
+
+//every triangle corner as an outgoing half edge of its vertex, next and prev continue the winding
+struct HalfEdge {
+    uint32_t next;
+    uint32_t prev;
+};
+
+struct Adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<HalfEdge> edges;
+};
+
+static void buildAdjacency(Adjacency &_adjacency, const std::vector<uint32_t> &_indices, uint32_t _vertexCount) {
+    _adjacency.offsets.assign(_vertexCount + 1, 0);
+    for (uint32_t index : _indices)
+        _adjacency.offsets[index + 1]++;
+    for (uint32_t v = 0; v < _vertexCount; ++v)
+        _adjacency.offsets[v + 1] += _adjacency.offsets[v];
+
+    _adjacency.edges.resize(_indices.size());
+    std::vector<uint32_t> fill(_adjacency.offsets.begin(), _adjacency.offsets.end() - 1);
+    for (size_t i = 0; i + 2 < _indices.size(); i += 3) {
+        uint32_t a = _indices[i], b = _indices[i + 1], c = _indices[i + 2];
+        _adjacency.edges[fill[a]++] = {b, c};
+        _adjacency.edges[fill[b]++] = {c, a};
+        _adjacency.edges[fill[c]++] = {a, b};
+    }
+}
+
+static bool hasEdge(const Adjacency &_adjacency, uint32_t _from, uint32_t _to) {
+    for (uint32_t e = _adjacency.offsets[_from]; e < _adjacency.offsets[_from + 1]; ++e) {
+        if (_adjacency.edges[e].next == _to)
+            return true;
+    }
+    return false;
+}
+
+//moving _moving to _target turns the triangle around by more than about 75 degrees
+static bool hasTriangleFlip(const float *_a, const float *_b, const float *_moving, const float *_target) {
+    float ab[3] = {_b[0] - _a[0], _b[1] - _a[1], _b[2] - _a[2]};
+    float am[3] = {_moving[0] - _a[0], _moving[1] - _a[1], _moving[2] - _a[2]};
+    float at[3] = {_target[0] - _a[0], _target[1] - _a[1], _target[2] - _a[2]};
+    float before[3], after[3];
+    cross(ab, am, before);
+    cross(ab, at, after);
+    return dot(before, after) <= 0.25f * std::sqrt(dot(before, before) * dot(after, after));
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<uint32_t> &_indices, const float *_positions,
+                                               size_t _positionStride, uint32_t _vertexCount, size_t _targetIndexCount,
+                                               float _targetError, float &_error) {
+    _error = 0.0f;
+    auto sourcePosition = [&](uint32_t _vertex) {
+        return reinterpret_cast<const float *>(reinterpret_cast<const char *>(_positions) + _positionStride * _vertex);
+    };
+
+    //vertices that only differ in attributes share an id, the smallest index among them
+    std::vector<uint32_t> positionId(_vertexCount);
+    {
+        std::vector<uint32_t> order(_vertexCount);
+        std::iota(order.begin(), order.end(), 0);
+        auto less = [&](uint32_t a, uint32_t b) {
+            const float *pa = sourcePosition(a);
+            const float *pb = sourcePosition(b);
+            return std::lexicographical_compare(pa, pa + 3, pb, pb + 3);
+        };
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return less(a, b) || (!less(b, a) && a < b); });
+        for (size_t i = 0; i < order.size(); ++i)
+            positionId[order[i]] = i > 0 && !less(order[i - 1], order[i]) ? positionId[order[i - 1]] : order[i];
+    }
+
+    //the unit cube keeps the quadrics well conditioned whatever the model scale, and makes errors relative
+    float minPosition[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    for (uint32_t v = 0; v < _vertexCount; ++v) {
+        for (int axis = 0; axis < 3; ++axis)
+            minPosition[axis] = std::min(minPosition[axis], sourcePosition(v)[axis]);
+    }
+    float extent = getScale(_positions, _positionStride, _vertexCount);
+    float scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+    std::vector<float> positions(_vertexCount * 3);
+    for (uint32_t v = 0; v < _vertexCount; ++v) {
+        for (int axis = 0; axis < 3; ++axis)
+            positions[v * 3 + axis] = (sourcePosition(v)[axis] - minPosition[axis]) * scale;
+    }
+    auto position = [&](uint32_t _vertex) { return &positions[_vertex * 3]; };
+
+    std::vector<uint32_t> result;
+    result.reserve(_indices.size());
+    for (size_t i = 0; i + 2 < _indices.size(); i += 3) {
+        uint32_t a = _indices[i], b = _indices[i + 1], c = _indices[i + 2];
+        if (positionId[a] != positionId[b] && positionId[b] != positionId[c] && positionId[c] != positionId[a])
+            result.insert(result.end(), {a, b, c});
+    }
+
+    Adjacency adjacency;
+    buildAdjacency(adjacency, result, _vertexCount);
+
+    //surface planes, plus planes standing on open edges so borders and seams resist moving sideways
+    std::vector<Quadric> quadrics(_vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const uint32_t corners[3] = {result[i], result[i + 1], result[i + 2]};
+        const float *p0 = position(corners[0]);
+        const float *p1 = position(corners[1]);
+        const float *p2 = position(corners[2]);
+        float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        float normal[3];
+        cross(e1, e2, normal);
+        float area = std::sqrt(dot(normal, normal));
+        if (area > 0.0f) {
+            for (float &axis : normal)
+                axis /= area;
+            for (uint32_t corner : corners)
+                addPlane(quadrics[positionId[corner]], normal, -dot(normal, p0), area);
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            uint32_t from = corners[k], to = corners[(k + 1) % 3], opposite = corners[(k + 2) % 3];
+            if (hasEdge(adjacency, to, from))
+                continue;
+            const float *pf = position(from);
+            const float *pt = position(to);
+            const float *po = position(opposite);
+            float edge[3] = {pt[0] - pf[0], pt[1] - pf[1], pt[2] - pf[2]};
+            float length = std::sqrt(dot(edge, edge));
+            if (length == 0.0f)
+                continue;
+            for (float &axis : edge)
+                axis /= length;
+            float toOpposite[3] = {po[0] - pf[0], po[1] - pf[1], po[2] - pf[2]};
+            float along = dot(toOpposite, edge);
+            float edgeNormal[3] = {toOpposite[0] - edge[0] * along, toOpposite[1] - edge[1] * along, toOpposite[2] - edge[2] * along};
+            float normalLength = std::sqrt(dot(edgeNormal, edgeNormal));
+            if (normalLength == 0.0f)
+                continue;
+            for (float &axis : edgeNormal)
+                axis /= normalLength;
+            float distance = -dot(edgeNormal, pf);
+            addPlane(quadrics[positionId[from]], edgeNormal, distance, length * length * BORDER_WEIGHT);
+            addPlane(quadrics[positionId[to]], edgeNormal, distance, length * length * BORDER_WEIGHT);
+        }
+    }
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        float error;
+    };
+
+    std::vector<uint32_t> wedge(_vertexCount);
+    std::vector<uint32_t> firstWedge(_vertexCount);
+    std::vector<uint32_t> openOut(_vertexCount);
+    std::vector<uint32_t> openIn(_vertexCount);
+    std::vector<uint8_t> kind(_vertexCount);
+    std::vector<uint8_t> referenced(_vertexCount);
+    std::vector<uint32_t> collapseRemap(_vertexCount);
+    std::vector<uint8_t> collapseLocked(_vertexCount);
+    std::vector<Collapse> collapsesList;
+    float limit = _targetError * _targetError;
+    float maxError = 0.0f;
+
+    //every pass collapses a batch of independent edges, then the topology is rebuilt from what is left
+    while (result.size() > _targetIndexCount) {
+        buildAdjacency(adjacency, result, _vertexCount);
+
+        //wedges: the referenced vertices of each position in a circular list
+        std::fill(referenced.begin(), referenced.end(), 0);
+        for (uint32_t index : result)
+            referenced[index] = 1;
+        std::fill(firstWedge.begin(), firstWedge.end(), NONE);
+        for (uint32_t v = 0; v < _vertexCount; ++v) {
+            wedge[v] = v;
+            if (!referenced[v])
+                continue;
+            uint32_t &first = firstWedge[positionId[v]];
+            if (first == NONE) {
+                first = v;
+            } else {
+                wedge[v] = wedge[first];
+                wedge[first] = v;
+            }
+        }
+
+        //open half edges have no twin with the same two vertices, a vertex on more than one gets itself as marker
+        std::fill(openOut.begin(), openOut.end(), NONE);
+        std::fill(openIn.begin(), openIn.end(), NONE);
+        for (uint32_t v = 0; v < _vertexCount; ++v) {
+            for (uint32_t e = adjacency.offsets[v]; e < adjacency.offsets[v + 1]; ++e) {
+                uint32_t target = adjacency.edges[e].next;
+                if (hasEdge(adjacency, target, v))
+                    continue;
+                openIn[target] = openIn[target] == NONE ? v : target;
+                openOut[v] = openOut[v] == NONE ? target : v;
+            }
+        }
+
+        for (uint32_t v = 0; v < _vertexCount; ++v) {
+            if (!referenced[v] || firstWedge[positionId[v]] != v)
+                continue;
+            uint8_t vertexKind = KIND_LOCKED;
+            if (wedge[v] == v) {
+                if (openIn[v] == NONE && openOut[v] == NONE)
+                    vertexKind = KIND_MANIFOLD;
+                else if (openIn[v] != NONE && openOut[v] != NONE && openIn[v] != v && openOut[v] != v)
+                    vertexKind = KIND_BORDER;
+            } else if (wedge[wedge[v]] == v) {
+                //each wedge is on one open edge loop and the two loops run between the same positions
+                uint32_t w = wedge[v];
+                bool single = openIn[v] != NONE && openIn[v] != v && openOut[v] != NONE && openOut[v] != v &&
+                              openIn[w] != NONE && openIn[w] != w && openOut[w] != NONE && openOut[w] != w;
+                if (single && positionId[openIn[v]] == positionId[openOut[w]] && positionId[openOut[v]] == positionId[openIn[w]] &&
+                    positionId[openIn[v]] != positionId[openOut[v]])
+                    vertexKind = KIND_SEAM;
+            }
+            uint32_t w = v;
+            do {
+                kind[w] = vertexKind;
+                w = wedge[w];
+            } while (w != v);
+        }
+
+        //a seam moves both wedges, the second one follows its own loop to the matching wedge of the target
+        auto seamPartner = [&](uint32_t _from, uint32_t _to) {
+            uint32_t other = wedge[_from];
+            uint32_t partner = openOut[_from] == _to ? openIn[other] : openOut[other];
+            return partner != NONE && positionId[partner] == positionId[_to] ? partner : NONE;
+        };
+        auto canCollapse = [&](uint32_t _from, uint32_t _to) {
+            if (!CAN_COLLAPSE[kind[_from]][kind[_to]])
+                return false;
+            if (kind[_from] == KIND_BORDER || kind[_from] == KIND_SEAM) {
+                if (openOut[_from] != _to && openIn[_from] != _to)
+                    return false;
+            }
+            return kind[_from] != KIND_SEAM || seamPartner(_from, _to) != NONE;
+        };
+
+        collapsesList.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; ++k) {
+                uint32_t i0 = result[i + k], i1 = result[i + (k + 1) % 3];
+                //inner edges show up once per side
+                if (i0 > i1 && hasEdge(adjacency, i1, i0))
+                    continue;
+                bool forward = canCollapse(i0, i1);
+                bool backward = canCollapse(i1, i0);
+                if (!forward && !backward)
+                    continue;
+                float forwardError = forward ? quadricError(quadrics[positionId[i0]], position(i1)) : FLT_MAX;
+                float backwardError = backward ? quadricError(quadrics[positionId[i1]], position(i0)) : FLT_MAX;
+                if (forwardError <= backwardError)
+                    collapsesList.push_back({i0, i1, forwardError});
+                else
+                    collapsesList.push_back({i1, i0, backwardError});
+            }
+        }
+        if (collapsesList.empty())
+            break;
+        std::sort(collapsesList.begin(), collapsesList.end(), [](const Collapse &a, const Collapse &b) { return a.error < b.error; });
+
+        //most collapses remove two triangles. the pass stops a little past the error of the collapse that would reach
+        //the goal, so cheap edges elsewhere get a chance before any expensive one is taken
+        size_t triangleGoal = (result.size() - _targetIndexCount) / 3;
+        size_t collapseGoal = triangleGoal / 2;
+        float passLimit = collapseGoal < collapsesList.size() ? std::min(limit, collapsesList[collapseGoal].error * 1.5f) : limit;
+
+        std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+        std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+        size_t trianglesRemoved = 0;
+        size_t collapseCount = 0;
+        for (const auto &collapse : collapsesList) {
+            if (collapse.error > passLimit || trianglesRemoved >= triangleGoal)
+                break;
+            uint32_t r0 = positionId[collapse.from], r1 = positionId[collapse.to];
+            if (collapseLocked[r0] || collapseLocked[r1])
+                continue;
+
+            bool flips = false;
+            uint32_t w = collapse.from;
+            do {
+                for (uint32_t e = adjacency.offsets[w]; e < adjacency.offsets[w + 1] && !flips; ++e) {
+                    uint32_t a = adjacency.edges[e].next, b = adjacency.edges[e].prev;
+                    if (positionId[a] == r1 || positionId[b] == r1)
+                        continue;
+                    flips = hasTriangleFlip(position(a), position(b), position(w), position(collapse.to));
+                }
+                w = wedge[w];
+            } while (w != collapse.from && !flips);
+            if (flips)
+                continue;
+
+            if (kind[collapse.from] == KIND_SEAM)
+                collapseRemap[wedge[collapse.from]] = seamPartner(collapse.from, collapse.to);
+            collapseRemap[collapse.from] = collapse.to;
+            addQuadric(quadrics[r1], quadrics[r0]);
+            collapseLocked[r0] = 1;
+            collapseLocked[r1] = 1;
+            trianglesRemoved += kind[collapse.from] == KIND_BORDER ? 1 : 2;
+            maxError = std::max(maxError, collapse.error);
+            collapseCount++;
+        }
+        if (collapseCount == 0)
+            break;
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = collapseRemap[result[i]], b = collapseRemap[result[i + 1]], c = collapseRemap[result[i + 2]];
+            if (positionId[a] == positionId[b] || positionId[b] == positionId[c] || positionId[c] == positionId[a])
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    _error = std::sqrt(maxError);
+    return result;
+}
+
+std::vector<std::vector<uint32_t>> MeshSimplifier::buildLodChain(const std::vector<uint32_t> &_indices, const float *_positions,
+                                                                 size_t _positionStride, uint32_t _vertexCount,
+                                                                 std::vector<float> &_errors, uint32_t _levelCount,
+                                                                 float _maxError) {
+    std::vector<std::vector<uint32_t>> levelsList{_indices};
+    _errors.assign(1, 0.0f);
+    while (levelsList.size() < _levelCount) {
+        const auto &previous = levelsList.back();
+        //every level starts from the one before, so their errors add up
+        float error = 0.0f;
+        auto level = simplify(previous, _positions, _positionStride, _vertexCount, previous.size() / 6 * 3,
+                              _maxError - _errors.back(), error);
+        if (level.empty() || level.size() > previous.size() / 10 * 9)
+            break;
+        _errors.push_back(_errors.back() + error);
+        levelsList.push_back(std::move(level));
+    }
+    return levelsList;
+}
+
+float MeshSimplifier::getScale(const float *_positions, size_t _positionStride, uint32_t _vertexCount) {
+    float minPosition[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float maxPosition[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (uint32_t v = 0; v < _vertexCount; ++v) {
+        const float *position = reinterpret_cast<const float *>(reinterpret_cast<const char *>(_positions) + _positionStride * v);
+        for (int axis = 0; axis < 3; ++axis) {
+            minPosition[axis] = std::min(minPosition[axis], position[axis]);
+            maxPosition[axis] = std::max(maxPosition[axis], position[axis]);
+        }
+    }
+    float extent = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+        extent = std::max(extent, maxPosition[axis] - minPosition[axis]);
+    return extent;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//edge collapse simplification driven by quadric error metrics (garland, heckbert 1997). works on plain index and
+//position arrays like MeshOptimizer, vertices are never moved or created so the result indexes the same vertex
+//buffer and every attribute stays exact.
+//vertices at the same position but with different normals or uvs form a seam, seams and open borders are only
+//collapsed along themselves so uv islands and hard edges keep their outline
+class MeshSimplifier {
+public:
+    //how much the distance to an open border or seam edge counts against the distance to the surface
+    static constexpr float BORDER_WEIGHT = 10.0f;
+    //levels of a chain including the full mesh, every level has about half the triangles of the one before
+    static constexpr uint32_t LOD_COUNT = 4;
+    //how far a level may drift from the full mesh, relative to the mesh size
+    static constexpr float LOD_MAX_ERROR = 0.02f;
+
+    //collapses edges cheapest first until at most _targetIndexCount indices are left or the next collapse would move
+    //the surface further than _targetError. errors are relative to getScale, _error receives the largest accepted one
+    static std::vector<uint32_t> simplify(const std::vector<uint32_t> &_indices, const float *_positions,
+                                          size_t _positionStride, uint32_t _vertexCount, size_t _targetIndexCount,
+                                          float _targetError, float &_error);
+    //levels for a lod chain, the first one is _indices itself. stops early once a level cannot lose a tenth of its
+    //triangles within _maxError. _errors receives the error of every level relative to the full mesh
+    static std::vector<std::vector<uint32_t>> buildLodChain(const std::vector<uint32_t> &_indices, const float *_positions,
+                                                            size_t _positionStride, uint32_t _vertexCount,
+                                                            std::vector<float> &_errors, uint32_t _levelCount = LOD_COUNT,
+                                                            float _maxError = LOD_MAX_ERROR);
+    //largest extent of the bounding box, multiplies relative errors into position units
+    static float getScale(const float *_positions, size_t _positionStride, uint32_t _vertexCount);
+};
@@ -0,0 +1,279 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+static constexpr uint32_t UNUSED = ~0u;
+
+static const float *getPosition(const float *_positions, size_t _positionStride, uint32_t _vertex) {
+    return reinterpret_cast<const float *>(reinterpret_cast<const char *>(_positions) + _positionStride * _vertex);
+}
+
+static float dot3(const float *a, const float *b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void normalize3(float *v) {
+    float length = std::sqrt(dot3(v, v));
+    if (length <= 0.0f)
+        return;
+    for (int axis = 0; axis < 3; ++axis)
+        v[axis] /= length;
+}
+
+//vertices split by normals or uvs share one id, the lowest vertex at their position
+static std::vector<uint32_t> buildPositionIds(const float *_positions, size_t _positionStride, uint32_t _vertexCount) {
+    std::vector<uint32_t> order(_vertexCount);
+    std::iota(order.begin(), order.end(), 0);
+    auto less = [&](uint32_t a, uint32_t b) {
+        const float *pa = getPosition(_positions, _positionStride, a);
+        const float *pb = getPosition(_positions, _positionStride, b);
+        return std::lexicographical_compare(pa, pa + 3, pb, pb + 3);
+    };
+    std::stable_sort(order.begin(), order.end(), less);
+    std::vector<uint32_t> positionIds(_vertexCount);
+    for (uint32_t i = 0; i < _vertexCount; ++i)
+        positionIds[order[i]] = i > 0 && !less(order[i - 1], order[i]) ? positionIds[order[i - 1]] : order[i];
+    return positionIds;
+}
+
+//sphere around the box of the meshlet's vertices, cone around its triangle normals
+static void computeBounds(Meshlet &_meshlet, const uint32_t *_indices, const float *_normals, const uint32_t *_triangles,
+                          const float *_positions, size_t _positionStride, bool _backfaceCulling) {
+    uint32_t indexCount = _meshlet.triangleCount * 3;
+    float minPosition[3], maxPosition[3];
+    std::memcpy(minPosition, getPosition(_positions, _positionStride, _indices[0]), sizeof(minPosition));
+    std::memcpy(maxPosition, minPosition, sizeof(maxPosition));
+    for (uint32_t i = 1; i < indexCount; ++i) {
+        const float *p = getPosition(_positions, _positionStride, _indices[i]);
+        for (int axis = 0; axis < 3; ++axis) {
+            minPosition[axis] = std::min(minPosition[axis], p[axis]);
+            maxPosition[axis] = std::max(maxPosition[axis], p[axis]);
+        }
+    }
+    float radiusSquared = 0.0f;
+    for (int axis = 0; axis < 3; ++axis)
+        _meshlet.center[axis] = (minPosition[axis] + maxPosition[axis]) * 0.5f;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        const float *p = getPosition(_positions, _positionStride, _indices[i]);
+        float offset[3] = {p[0] - _meshlet.center[0], p[1] - _meshlet.center[1], p[2] - _meshlet.center[2]};
+        radiusSquared = std::max(radiusSquared, dot3(offset, offset));
+    }
+    _meshlet.radius = std::sqrt(radiusSquared);
+
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for (uint32_t t = 0; t < _meshlet.triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k)
+            axis[k] += _normals[_triangles[t] * 3 + k];
+    }
+    normalize3(axis);
+    float minDot = 1.0f;
+    for (uint32_t t = 0; t < _meshlet.triangleCount; ++t) {
+        const float *normal = &_normals[_triangles[t] * 3];
+        //degenerate triangles cover no pixels, they can face anywhere
+        if (dot3(normal, normal) > 0.0f)
+            minDot = std::min(minDot, dot3(normal, axis));
+    }
+    std::memcpy(_meshlet.coneAxis, axis, sizeof(axis));
+    //the view direction has to be within 90 degrees minus the cone angle of the axis, the cosine of that is the sine
+    //of the cone angle
+    _meshlet.coneCutoff = _backfaceCulling && dot3(axis, axis) > 0.0f && minDot >= MeshletBuilder::MIN_CONE_DOT
+                          ? std::sqrt(1.0f - minDot * minDot) : 1.0f;
+}
+
+std::vector<Meshlet> MeshletBuilder::build(std::vector<uint32_t> &_indices, const float *_positions, size_t _positionStride,
+                                           uint32_t _vertexCount, bool _backfaceCulling,
+                                           uint32_t _maxVertices, uint32_t _maxTriangles) {
+    std::vector<Meshlet> meshletsList;
+    uint32_t triangleCount = static_cast<uint32_t>(_indices.size() / 3);
+    if (triangleCount == 0)
+        return meshletsList;
+
+    //unit normal of every triangle, zero for degenerate ones
+    std::vector<float> normals(triangleCount * 3, 0.0f);
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        const float *p0 = getPosition(_positions, _positionStride, _indices[t * 3 + 0]);
+        const float *p1 = getPosition(_positions, _positionStride, _indices[t * 3 + 1]);
+        const float *p2 = getPosition(_positions, _positionStride, _indices[t * 3 + 2]);
+        float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        float *normal = &normals[t * 3];
+        normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+        normalize3(normal);
+    }
+
+    //triangles around every position packed into one array, so growing crosses uv seams and hard edges
+    std::vector<uint32_t> positionIds = buildPositionIds(_positions, _positionStride, _vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(_vertexCount + 1, 0);
+    for (uint32_t index : _indices)
+        adjacencyOffsets[positionIds[index] + 1]++;
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+    std::vector<uint32_t> adjacency(_indices.size());
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < _indices.size(); ++i)
+            adjacency[fill[positionIds[_indices[i]]]++] = i / 3;
+    }
+    //triangles not yet in a meshlet around every position
+    std::vector<uint32_t> liveTriangles(_vertexCount, 0);
+    for (uint32_t index : _indices)
+        liveTriangles[positionIds[index]]++;
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    //meshlet a vertex was last added to, so membership in the current one is a single compare
+    std::vector<uint32_t> vertexMeshlet(_vertexCount, UNUSED);
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint32_t> meshletTriangles;
+    std::vector<uint32_t> trianglesList;
+    trianglesList.reserve(triangleCount);
+    std::vector<uint32_t> result;
+    result.reserve(_indices.size());
+    float normalSum[3] = {0.0f, 0.0f, 0.0f};
+    uint32_t meshletIndex = 0;
+    uint32_t cursor = 0;
+
+    auto countNewVertices = [&](uint32_t _triangle) {
+        uint32_t count = 0;
+        for (uint32_t k = 0; k < 3; ++k)
+            count += vertexMeshlet[_indices[_triangle * 3 + k]] != meshletIndex ? 1 : 0;
+        return count;
+    };
+
+    auto finishMeshlet = [&]() {
+        if (meshletTriangles.empty())
+            return;
+        Meshlet meshlet{};
+        meshlet.firstIndex = static_cast<uint32_t>(result.size());
+        meshlet.triangleCount = static_cast<uint32_t>(meshletTriangles.size());
+        meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+        for (uint32_t triangle : meshletTriangles) {
+            result.insert(result.end(), _indices.begin() + triangle * 3, _indices.begin() + triangle * 3 + 3);
+            trianglesList.push_back(triangle);
+        }
+        computeBounds(meshlet, &result[meshlet.firstIndex], normals.data(), &trianglesList[meshlet.firstIndex / 3],
+                      _positions, _positionStride, _backfaceCulling);
+        meshletsList.push_back(meshlet);
+
+        meshletVertices.clear();
+        meshletTriangles.clear();
+        std::fill(std::begin(normalSum), std::end(normalSum), 0.0f);
+        meshletIndex++;
+    };
+
+    for (uint32_t added = 0; added < triangleCount; ++added) {
+        float axis[3] = {normalSum[0], normalSum[1], normalSum[2]};
+        normalize3(axis);
+
+        //fewest new vertices first, they keep the meshlet compact. then triangles whose corners have the fewest
+        //others left, finishing a region off instead of leaving slivers for later meshlets, and the normal closest
+        //to the meshlet's for a narrow cone
+        uint32_t best = UNUSED;
+        uint32_t bestNewVertices = 4;
+        float bestScore = FLT_MAX;
+        for (uint32_t vertex : meshletVertices) {
+            uint32_t position = positionIds[vertex];
+            for (uint32_t a = adjacencyOffsets[position]; a < adjacencyOffsets[position + 1]; ++a) {
+                uint32_t triangle = adjacency[a];
+                if (emitted[triangle])
+                    continue;
+                uint32_t newVertices = countNewVertices(triangle);
+                if (meshletVertices.size() + newVertices > _maxVertices || newVertices > bestNewVertices)
+                    continue;
+                float score = 1.0f - dot3(&normals[triangle * 3], axis);
+                for (uint32_t k = 0; k < 3; ++k)
+                    score += static_cast<float>(liveTriangles[positionIds[_indices[triangle * 3 + k]]]);
+                if (newVertices < bestNewVertices || score < bestScore) {
+                    best = triangle;
+                    bestNewVertices = newVertices;
+                    bestScore = score;
+                }
+            }
+        }
+
+        //nothing connected fits, the next meshlet starts at the first triangle left in input order
+        if (best == UNUSED) {
+            finishMeshlet();
+            while (emitted[cursor])
+                ++cursor;
+            best = cursor;
+        }
+
+        emitted[best] = 1;
+        for (uint32_t k = 0; k < 3; ++k) {
+            uint32_t vertex = _indices[best * 3 + k];
+            if (vertexMeshlet[vertex] != meshletIndex) {
+                vertexMeshlet[vertex] = meshletIndex;
+                meshletVertices.push_back(vertex);
+            }
+            liveTriangles[positionIds[vertex]]--;
+            normalSum[k] += normals[best * 3 + k];
+        }
+        meshletTriangles.push_back(best);
+        if (meshletTriangles.size() == _maxTriangles)
+            finishMeshlet();
+    }
+    finishMeshlet();
+
+    _indices.swap(result);
+    return meshletsList;
+}
+
+bool MeshletBuilder::isClosed(const std::vector<uint32_t> &_indices, const float *_positions, size_t _positionStride,
+                              uint32_t _vertexCount) {
+    std::vector<uint32_t> positionIds = buildPositionIds(_positions, _positionStride, _vertexCount);
+
+    std::vector<uint64_t> edgesList;
+    std::vector<uint64_t> twinsList;
+    edgesList.reserve(_indices.size());
+    twinsList.reserve(_indices.size());
+    for (size_t i = 0; i < _indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            uint64_t from = positionIds[_indices[i + k]];
+            uint64_t to = positionIds[_indices[i + (k + 1) % 3]];
+            if (from == to)
+                continue;
+            edgesList.push_back(from << 32 | to);
+            twinsList.push_back(to << 32 | from);
+        }
+    }
+    std::sort(edgesList.begin(), edgesList.end());
+    std::sort(twinsList.begin(), twinsList.end());
+    return edgesList == twinsList;
+}
+
+bool MeshletBuilder::isOutsideFrustum(const Meshlet &_meshlet, const float _frustumPlanes[6][4]) {
+    for (int i = 0; i < 6; ++i) {
+        if (dot3(_frustumPlanes[i], _meshlet.center) + _frustumPlanes[i][3] < -_meshlet.radius)
+            return true;
+    }
+    return false;
+}
+
+bool MeshletBuilder::isBackfacing(const Meshlet &_meshlet, const float _cameraPosition[3]) {
+    float toMeshlet[3] = {_meshlet.center[0] - _cameraPosition[0], _meshlet.center[1] - _cameraPosition[1],
+                          _meshlet.center[2] - _cameraPosition[2]};
+    return dot3(toMeshlet, _meshlet.coneAxis) >= _meshlet.coneCutoff * std::sqrt(dot3(toMeshlet, toMeshlet)) + _meshlet.radius;
+}
+
+void MeshletBuilder::cull(const Meshlet *_meshlets, uint32_t _meshletCount, const float _cameraPosition[3],
+                          const float _frustumPlanes[6][4], uint8_t *_visible, MeshletCullStats &_stats) {
+    for (uint32_t i = 0; i < _meshletCount; ++i) {
+        const Meshlet &meshlet = _meshlets[i];
+        _stats.meshlets++;
+        _visible[i] = 0;
+        if (isOutsideFrustum(meshlet, _frustumPlanes)) {
+            _stats.frustumCulled++;
+            _stats.trianglesCulled += meshlet.triangleCount;
+        } else if (isBackfacing(meshlet, _cameraPosition)) {
+            _stats.backfaceCulled++;
+            _stats.trianglesCulled += meshlet.triangleCount;
+        } else {
+            _visible[i] = 1;
+        }
+    }
+}
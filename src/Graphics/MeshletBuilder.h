@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//a cluster of neighbouring triangles stored as one contiguous range of a level's indices, so it draws with a single
+//indexed draw. same layout as Meshlet in meshlet_cull.comp (std430).
+//the cone holds every triangle normal of the cluster: it faces away from a camera for which
+//dot(center - camera, coneAxis) >= coneCutoff * length(center - camera) + radius, coneCutoff 1 never culls
+struct Meshlet {
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;
+    //relative to the first index of the level
+    uint32_t firstIndex;
+    uint32_t triangleCount;
+    uint32_t vertexCount;
+    uint32_t padding;
+};
+
+//meshlets tested, and why the rest was dropped
+struct MeshletCullStats {
+    uint32_t meshlets = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t backfaceCulled = 0;
+    uint32_t trianglesCulled = 0;
+};
+
+//import time clustering of triangle lists into meshlets, on plain index and position arrays like MeshOptimizer,
+//and the cpu reference of the cluster tests in meshlet_cull.comp
+class MeshletBuilder {
+public:
+    //small enough that one workgroup covers a meshlet, 124 triangles keep the index range under 384 entries
+    static constexpr uint32_t MAX_VERTICES = 64;
+    static constexpr uint32_t MAX_TRIANGLES = 124;
+    //levels with fewer triangles are drawn whole, a handful of meshlets does not pay for the extra draws
+    static constexpr uint32_t MIN_TRIANGLES = 8 * MAX_TRIANGLES;
+    //wider cones cull too rarely to be worth testing
+    static constexpr float MIN_CONE_DOT = 0.1f;
+
+    //grows every meshlet from its seed over the neighbouring triangle that adds the fewest new vertices and bends
+    //least away from the meshlet normal, then reorders _indices so every meshlet is one range. input in vertex cache
+    //order keeps the seeds close together. without _backfaceCulling every cone gets cutoff 1
+    static std::vector<Meshlet> build(std::vector<uint32_t> &_indices, const float *_positions, size_t _positionStride,
+                                      uint32_t _vertexCount, bool _backfaceCulling,
+                                      uint32_t _maxVertices = MAX_VERTICES, uint32_t _maxTriangles = MAX_TRIANGLES);
+    //true when every edge has a twin running the other way, with vertices welded by position. only the back faces of
+    //closed meshes are always hidden, nothing culls back faces of open ones while rasterizing
+    static bool isClosed(const std::vector<uint32_t> &_indices, const float *_positions, size_t _positionStride,
+                         uint32_t _vertexCount);
+
+    //camera and planes are in the space of the meshlets, planes point inwards and have unit normals
+    static bool isOutsideFrustum(const Meshlet &_meshlet, const float _frustumPlanes[6][4]);
+    static bool isBackfacing(const Meshlet &_meshlet, const float _cameraPosition[3]);
+    //writes 1 for every meshlet that survives both tests, 0 for the rest
+    static void cull(const Meshlet *_meshlets, uint32_t _meshletCount, const float _cameraPosition[3],
+                     const float _frustumPlanes[6][4], uint8_t *_visible, MeshletCullStats &_stats);
+};
@@ -1,6 +1,20 @@
 #include "Model.h"
 
+#include <algorithm>
+#include <cmath>
+#include <streambuf>
+#include <istream>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/packing.hpp>
+
 #include "imguiImports.h"
+#include "../Jobs/ThreadPool.h"
+#include "../IO/BatchFileReader.h"
+#include "../FileHelper.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
@@ -9,133 +23,260 @@
 #include <stb_image.h>
 
 
-namespace std {
-    template <>
-    struct hash<Vertex> {
-        size_t operator()(Vertex const &vertex) const {
-            size_t seed = 0;
-            hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-            return seed;
-        }
-    };
-}
+//lets tinyobj parse straight out of a read buffer without copying it into a stringstream
+struct MemoryStreamBuffer : std::streambuf {
+    MemoryStreamBuffer(const char *data, size_t size) {
+        char *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+};
+
+static void fillFromObj(Builder &builder, const tinyobj::attrib_t &attrib, const std::vector<tinyobj::shape_t> &shapes);
 
 
-Model::Model(Device &_device, const Builder &_builder) : device(_device) {
+Model::Model(GeometryPool &_geometryPool, const Builder &_builder) : device(_geometryPool.getDevice()), geometryPool(_geometryPool) {
 
-    createVertexBuffers(_builder.vertices);
-    createIndexBuffers(_builder.indices);
+    createGeometry(_builder);
     createTextureBuffers(_builder.image);
 }
 
 
-Model::~Model() {}
+Model::~Model() {
+    geometryPool.free(geometry);
+}
+
 
+glm::mat4 VertexQuantization::getDequantizationMatrix() const {
+    glm::mat4 matrix{scale};
+    matrix[3] = glm::vec4(offset, 1.0f);
+    return matrix;
+}
 
-VkVertexInputBindingDescription Vertex::getBindingDescription() {
-    VkVertexInputBindingDescription bindingDescription{};
 
-    bindingDescription.binding = 0;
-    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    bindingDescription.stride = sizeof(Vertex);
+//maps the unit sphere onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the corners
+static glm::vec2 octahedralEncode(glm::vec3 _normal) {
+    float length = std::abs(_normal.x) + std::abs(_normal.y) + std::abs(_normal.z);
+    if (length == 0.0f)
+        return {0.0f, 0.0f};
+    _normal /= length;
 
-    return bindingDescription;
+    glm::vec2 encoded{_normal.x, _normal.y};
+    if (_normal.z < 0.0f) {
+        encoded.x = (1.0f - std::abs(_normal.y)) * (_normal.x >= 0.0f ? 1.0f : -1.0f);
+        encoded.y = (1.0f - std::abs(_normal.x)) * (_normal.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return encoded;
 }
 
 
-std::vector <VkVertexInputAttributeDescription> Vertex::getAttributeDescription() {
+static glm::vec3 octahedralDecode(glm::vec2 _encoded) {
+    glm::vec3 normal{_encoded.x, _encoded.y, 1.0f - std::abs(_encoded.x) - std::abs(_encoded.y)};
+    if (normal.z < 0.0f) {
+        normal.x = (1.0f - std::abs(_encoded.y)) * (_encoded.x >= 0.0f ? 1.0f : -1.0f);
+        normal.y = (1.0f - std::abs(_encoded.x)) * (_encoded.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    float length = glm::length(normal);
+    return length > 0.0f ? normal / length : normal;
+}
 
-    std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptionsList(4);
 
-    vertexInputAttributeDescriptionsList[0].binding = 0;
-    vertexInputAttributeDescriptionsList[0].location = 0;
-    //allocate 32 bits for every number in position vector
-    vertexInputAttributeDescriptionsList[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexInputAttributeDescriptionsList[0].offset = offsetof(Vertex, position);
+static void quantizeVertices(const std::vector<Vertex> &_vertices, std::vector<CompactVertex> &_compactVertices,
+                             VertexQuantization &_quantization) {
+    _compactVertices.resize(_vertices.size());
+    if (_vertices.empty())
+        return;
 
-    vertexInputAttributeDescriptionsList[1].binding = 0;
-    vertexInputAttributeDescriptionsList[1].location = 1;
-    //allocate 32 bits for every number in color vector
-    vertexInputAttributeDescriptionsList[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexInputAttributeDescriptionsList[1].offset = offsetof(Vertex, color);
+    glm::vec3 minPosition = _vertices[0].position;
+    glm::vec3 maxPosition = _vertices[0].position;
+    for (const auto &vertex : _vertices) {
+        minPosition = glm::min(minPosition, vertex.position);
+        maxPosition = glm::max(maxPosition, vertex.position);
+    }
+    glm::vec3 extent = maxPosition - minPosition;
+    _quantization.offset = minPosition;
+    _quantization.scale = std::max({extent.x, extent.y, extent.z, 1e-6f});
+
+    float toUnorm = 65535.0f / _quantization.scale;
+    for (size_t i = 0; i < _vertices.size(); ++i) {
+        const auto &vertex = _vertices[i];
+        auto &compact = _compactVertices[i];
+
+        glm::vec3 position = glm::round((vertex.position - minPosition) * toUnorm);
+        position = glm::clamp(position, glm::vec3(0.0f), glm::vec3(65535.0f));
+        compact.position[0] = static_cast<uint16_t>(position.x);
+        compact.position[1] = static_cast<uint16_t>(position.y);
+        compact.position[2] = static_cast<uint16_t>(position.z);
+        compact.position[3] = 0;
+
+        compact.normal = glm::packSnorm2x16(octahedralEncode(vertex.normal));
+        compact.color = glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f));
+        compact.uv = glm::packHalf2x16(vertex.uv);
+    }
+}
 
-    vertexInputAttributeDescriptionsList[2].binding = 0;
-    vertexInputAttributeDescriptionsList[2].location = 2;
-    //allocate 32 bits for every number in color vector
-    vertexInputAttributeDescriptionsList[2].format = VK_FORMAT_R32G32B32_SFLOAT;
-    vertexInputAttributeDescriptionsList[2].offset = offsetof(Vertex, normal);
 
-    vertexInputAttributeDescriptionsList[3].binding = 0;
-    vertexInputAttributeDescriptionsList[3].location = 3;
-    //allocate 24 bits for every number in texture coordinate
-    vertexInputAttributeDescriptionsList[3].format = VK_FORMAT_R32G32_SFLOAT;
-    vertexInputAttributeDescriptionsList[3].offset = offsetof(Vertex, uv);
+static void dequantizeVertices(const std::vector<CompactVertex> &_compactVertices, const VertexQuantization &_quantization,
+                               std::vector<Vertex> &_vertices) {
+    _vertices.resize(_compactVertices.size());
+    float toPosition = _quantization.scale / 65535.0f;
+    for (size_t i = 0; i < _compactVertices.size(); ++i) {
+        const auto &compact = _compactVertices[i];
+        auto &vertex = _vertices[i];
 
-    return vertexInputAttributeDescriptionsList;
+        glm::vec3 position{compact.position[0], compact.position[1], compact.position[2]};
+        vertex.position = _quantization.offset + position * toPosition;
+        vertex.normal = octahedralDecode(glm::unpackSnorm2x16(compact.normal));
+        vertex.color = glm::vec3(glm::unpackUnorm4x8(compact.color));
+        vertex.uv = glm::unpackHalf2x16(compact.uv);
+    }
 }
 
 
-void Model::createVertexBuffers(const std::vector<Vertex> &_vertexList) {
-    vertexCount = static_cast<uint32_t>(_vertexList.size());
-    assert(vertexCount > 3 && "cant be mesh with less than 3 verices");
-    VkDeviceSize instanceSize = sizeof(_vertexList[0]);
+//16 bit indices whenever every index fits, they halve index memory and bandwidth
+static void packIndices(size_t _vertexCount, const std::vector<uint32_t> &_indices, std::vector<uint16_t> &_compactIndices,
+                        VkIndexType &_indexType) {
+    _indexType = GeometryPool::selectIndexType(static_cast<uint32_t>(_vertexCount));
+    if (_indexType != VK_INDEX_TYPE_UINT16) {
+        _compactIndices.clear();
+        return;
+    }
+    _compactIndices.resize(_indices.size());
+    for (size_t i = 0; i < _indices.size(); ++i)
+        _compactIndices[i] = static_cast<uint16_t>(_indices[i]);
+}
 
-    Buffer stagingBuffer{
-        device,
-        instanceSize,
-        vertexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
 
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void *)_vertexList.data());
-    stagingBuffer.unmap();
+void Builder::quantize() {
+    quantizeVertices(vertices, compactVertices, quantization);
+    packIndices(vertices.size(), indices, compactIndices, indexType);
+}
 
-    vertexBuffer = std::make_unique<Buffer>(device,
-                                            instanceSize,
-                                            vertexCount,
-                                            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    if (device.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), vertexBuffer->getBufferSize()) != VK_SUCCESS) {
-        throw std::runtime_error("cant copy local buffer to gpu");
-    };
+void Builder::optimize() {
+    if (indices.empty())
+        return;
+
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    optimizationStats.before = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
+
+    auto clusters = MeshOptimizer::optimizeVertexCache(indices, vertexCount);
+    MeshOptimizer::optimizeOverdraw(indices, clusters, &vertices[0].position.x, sizeof(Vertex), vertexCount);
+    auto remap = MeshOptimizer::optimizeVertexFetch(indices, vertexCount);
+    MeshOptimizer::remapVertices(vertices, remap, vertexCount);
+
+    optimizationStats.after = MeshOptimizer::analyzeVertexCache(indices, vertexCount);
 }
 
 
-void Model::createIndexBuffers(const std::vector<uint32_t> &_indicesList) {
-    indicesCount = _indicesList.size();
+void Builder::generateLods() {
+    lods.clear();
+    if (indices.empty())
+        return;
+
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    std::vector<float> errorsList;
+    auto levelsList = MeshSimplifier::buildLodChain(indices, &vertices[0].position.x, sizeof(Vertex), vertexCount, errorsList);
+    float scale = MeshSimplifier::getScale(&vertices[0].position.x, sizeof(Vertex), vertexCount);
+
+    indices.clear();
+    for (size_t level = 0; level < levelsList.size(); ++level) {
+        auto &levelIndices = levelsList[level];
+        //the full mesh keeps the order optimize gave it, overdraw matters less at the distances the rest is seen from
+        if (level > 0)
+            MeshOptimizer::optimizeVertexCache(levelIndices, vertexCount);
+        lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(levelIndices.size()), errorsList[level] * scale});
+        indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+    }
+}
 
-    if (indicesCount > 0)
-        hasIndices = true;
 
-    if(!hasIndices)
+void Builder::generateMeshlets() {
+    meshlets.clear();
+    if (indices.empty())
         return;
+    if (lods.empty())
+        lods.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+
+    uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    //simplification keeps the borders, so the full level decides about the cones of all of them
+    std::vector<uint32_t> fullIndices(indices.begin() + lods[0].firstIndex, indices.begin() + lods[0].firstIndex + lods[0].indexCount);
+    bool closed = MeshletBuilder::isClosed(fullIndices, &vertices[0].position.x, sizeof(Vertex), vertexCount);
+
+    for (auto &lod : lods) {
+        if (lod.indexCount / 3 < MeshletBuilder::MIN_TRIANGLES)
+            continue;
+        std::vector<uint32_t> levelIndices(indices.begin() + lod.firstIndex, indices.begin() + lod.firstIndex + lod.indexCount);
+        auto levelMeshlets = MeshletBuilder::build(levelIndices, &vertices[0].position.x, sizeof(Vertex), vertexCount, closed);
+        std::copy(levelIndices.begin(), levelIndices.end(), indices.begin() + lod.firstIndex);
+        lod.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+        lod.meshletCount = static_cast<uint32_t>(levelMeshlets.size());
+        meshlets.insert(meshlets.end(), levelMeshlets.begin(), levelMeshlets.end());
+    }
+}
 
-    VkDeviceSize instanceSize = sizeof(_indicesList[0]);
 
-    Buffer stagingBuffer{
-            device,
-            instanceSize,
-            indicesCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-    };
+void Model::createGeometry(const Builder &_builder) {
+    const auto &vertexList = _builder.vertices;
+    const auto &indicesList = _builder.indices;
+    assert(vertexList.size() > 3 && "cant be mesh with less than 3 verices");
+    hasIndices = !indicesList.empty();
 
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void *)_indicesList.data());
-    stagingBuffer.unmap();
+    std::vector<CompactVertex> localCompactVertices;
+    const std::vector<CompactVertex> *compactVertices = &_builder.compactVertices;
+    quantization = _builder.quantization;
+    if (compactVertices->size() != vertexList.size()) {
+        quantizeVertices(vertexList, localCompactVertices, quantization);
+        compactVertices = &localCompactVertices;
+    }
 
-    indexBuffer = std::make_unique<Buffer>(device,
-                                           instanceSize,
-                                           indicesCount,
-                                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    std::vector<CompactPosition> positionsList;
+    if (geometryPool.hasPositionStream()) {
+        positionsList.resize(compactVertices->size());
+        for (size_t i = 0; i < compactVertices->size(); ++i)
+            std::memcpy(positionsList[i].position, (*compactVertices)[i].position, sizeof(CompactPosition));
+    }
 
-    if (device.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), indexBuffer->getBufferSize()) != VK_SUCCESS){
-        throw std::runtime_error("cant copy local buffer to gpu");
-    };
+    std::vector<uint16_t> localCompactIndices;
+    VkIndexType indexType = _builder.indexType;
+    const void *indexData = indicesList.data();
+    if (indexType == VK_INDEX_TYPE_UINT16 && _builder.compactIndices.size() == indicesList.size() &&
+        GeometryPool::selectIndexType(static_cast<uint32_t>(vertexList.size())) == VK_INDEX_TYPE_UINT16) {
+        indexData = _builder.compactIndices.data();
+    } else {
+        packIndices(vertexList.size(), indicesList, localCompactIndices, indexType);
+        if (indexType == VK_INDEX_TYPE_UINT16)
+            indexData = localCompactIndices.data();
+    }
+
+    //meshlet bounds move into the quantized space, cone axes keep their direction under its uniform scale
+    meshletsList = _builder.meshlets;
+    for (auto &meshlet : meshletsList) {
+        for (int axis = 0; axis < 3; ++axis)
+            meshlet.center[axis] = (meshlet.center[axis] - quantization.offset[axis]) / quantization.scale;
+        meshlet.radius /= quantization.scale;
+    }
+
+    geometry = geometryPool.allocate(compactVertices->data(), positionsList.data(), static_cast<uint32_t>(compactVertices->size()),
+                                     indexData, static_cast<uint32_t>(indicesList.size()), indexType,
+                                     meshletsList.data(), static_cast<uint32_t>(meshletsList.size()));
+    lodsList = _builder.lods;
+    if (lodsList.empty())
+        lodsList.push_back({0, geometry.indexCount, 0.0f});
+
+    //sphere around the bounding box center, loose but cheap to build and to test
+    glm::vec3 minPosition = vertexList[0].position;
+    glm::vec3 maxPosition = vertexList[0].position;
+    for (const auto &vertex : vertexList) {
+        minPosition = glm::min(minPosition, vertex.position);
+        maxPosition = glm::max(maxPosition, vertex.position);
+    }
+    glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (const auto &vertex : vertexList) {
+        glm::vec3 offset = vertex.position - center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    boundingSphere = glm::vec4(center, std::sqrt(radiusSquared));
 }
 
 
@@ -147,7 +288,61 @@ void Model::createTextureBuffers(const ImageBuilder &_image) {
     if (!hasTexture)
         return;
 
-    VkDeviceSize instanceSize = _image.width * _image.height * STBI_rgb_alpha;  
+    textureBuffer = createTexture(device, _image);
+    stbi_image_free(_image.pixels);
+}
+
+
+void Model::swapContents(Model &_other) {
+    assert(&geometryPool == &_other.geometryPool && "models from different pools");
+    std::swap(geometry, _other.geometry);
+    std::swap(lodsList, _other.lodsList);
+    std::swap(meshletsList, _other.meshletsList);
+    std::swap(quantization, _other.quantization);
+    std::swap(boundingSphere, _other.boundingSphere);
+    std::swap(textureBuffer, _other.textureBuffer);
+    std::swap(hasIndices, _other.hasIndices);
+    std::swap(hasTexture, _other.hasTexture);
+}
+
+
+void Model::readGeometry(std::vector<Vertex> &_vertices, std::vector<uint32_t> &_indices) const {
+    std::vector<CompactVertex> compactVertices(geometry.vertexCount);
+    std::vector<uint8_t> indexData(GeometryPool::getIndexSize(geometry.indexType) * geometry.indexCount);
+    geometryPool.read(geometry, compactVertices.data(), indexData.data());
+    dequantizeVertices(compactVertices, quantization, _vertices);
+
+    const MeshLod &lod = lodsList[0];
+    _indices.resize(lod.indexCount);
+    for (uint32_t i = 0; i < lod.indexCount; ++i) {
+        if (geometry.indexType == VK_INDEX_TYPE_UINT16)
+            _indices[i] = reinterpret_cast<const uint16_t *>(indexData.data())[lod.firstIndex + i];
+        else
+            _indices[i] = reinterpret_cast<const uint32_t *>(indexData.data())[lod.firstIndex + i];
+    }
+}
+
+
+glm::vec4 Model::getQuantizedBoundingSphere() const {
+    return glm::vec4((glm::vec3(boundingSphere) - quantization.offset) / quantization.scale, boundingSphere.w / quantization.scale);
+}
+
+
+void Model::setTexture(std::shared_ptr<ImageBuffer> _texture) {
+    textureBuffer = std::move(_texture);
+    hasTexture = textureBuffer != nullptr;
+}
+
+
+VkDeviceSize Model::getGeometryMemorySize() const {
+    return (geometryPool.getVertexStride() + geometryPool.getPositionStride()) * geometry.vertexCount +
+           GeometryPool::getIndexSize(geometry.indexType) * geometry.indexCount + sizeof(Meshlet) * geometry.meshletCount;
+}
+
+
+std::unique_ptr<ImageBuffer> Model::createTexture(Device &device, const ImageBuilder &_image) {
+
+    VkDeviceSize instanceSize = _image.width * _image.height * STBI_rgb_alpha;
 
     //writing staging buffer
     Buffer stagingBuffer{
@@ -161,15 +356,14 @@ void Model::createTextureBuffers(const ImageBuilder &_image) {
     stagingBuffer.map();
     stagingBuffer.writeToBuffer((void *)_image.pixels);
     stagingBuffer.unmap();
-    stbi_image_free(_image.pixels);
 
-    textureBuffer = std::make_unique<ImageBuffer>(device,
-                                                  VK_IMAGE_TYPE_2D,
-                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                                  VK_FORMAT_R8G8B8A8_SRGB,
-                                                  VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                                                  _image.width,
-                                                  _image.height);
+    auto textureBuffer = std::make_unique<ImageBuffer>(device,
+                                                       VK_IMAGE_TYPE_2D,
+                                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                       VK_FORMAT_R8G8B8A8_SRGB,
+                                                       VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                       _image.width,
+                                                       _image.height);
 
     textureBuffer->transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
     auto res = device.copyBufferToImage(stagingBuffer.getBuffer(), textureBuffer->getImage(), static_cast<uint32_t>(_image.width), static_cast<uint32_t>(_image.height));
@@ -177,29 +371,54 @@ void Model::createTextureBuffers(const ImageBuilder &_image) {
         throw std::runtime_error("failed to copy buffer to image");
     }
     textureBuffer->transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    return textureBuffer;
+}
+
+
+void Model::bindDataToBuffer(CommandRecorder &_recorder) {
+    geometryPool.bind(_recorder, geometry.block);
 }
 
 
-void Model::bindDataToBuffer(const VkCommandBuffer &commandBuffer) {
+void Model::bindPositionsToBuffer(CommandRecorder &_recorder) {
+    geometryPool.bindPositions(_recorder, geometry.block);
+}
 
-    VkBuffer buffer[] = {vertexBuffer->getBuffer()};
-    VkDeviceSize offsets[] = {0};
 
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffer, offsets);
-    if (hasIndices)
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+void Model::drawDataToBuffer(CommandRecorder &_recorder, uint32_t _lod, uint32_t _firstInstance) const {
+    if (hasIndices) {
+        const auto &lod = getLod(_lod);
+        _recorder.drawIndexed(lod.indexCount, 1, geometry.firstIndex + lod.firstIndex, static_cast<int32_t>(geometry.vertexOffset), _firstInstance);
+    } else
+        _recorder.draw(geometry.vertexCount, 1, geometry.vertexOffset, _firstInstance);
 }
 
 
-void Model::drawDataToBuffer(const VkCommandBuffer &commandBuffer) const {
-    if (hasIndices)
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indicesCount), 1, 0, 0, 0);
-    else
-        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+void Model::drawMeshletsToBuffer(CommandRecorder &_recorder, uint32_t _lod, const uint8_t *_visible, uint32_t _firstInstance) const {
+    const auto &lod = getLod(_lod);
+    uint32_t firstIndex = geometry.firstIndex + lod.firstIndex;
+    int32_t vertexOffset = static_cast<int32_t>(geometry.vertexOffset);
+
+    //meshlets are stored back to back, a run of visible ones is a single index range
+    uint32_t runFirstIndex = 0;
+    uint32_t runIndexCount = 0;
+    for (uint32_t i = 0; i < lod.meshletCount; ++i) {
+        const auto &meshlet = meshletsList[lod.firstMeshlet + i];
+        if (_visible[i]) {
+            if (runIndexCount == 0)
+                runFirstIndex = meshlet.firstIndex;
+            runIndexCount += meshlet.triangleCount * 3;
+        } else if (runIndexCount > 0) {
+            _recorder.drawIndexed(runIndexCount, 1, firstIndex + runFirstIndex, vertexOffset, _firstInstance);
+            runIndexCount = 0;
+        }
+    }
+    if (runIndexCount > 0)
+        _recorder.drawIndexed(runIndexCount, 1, firstIndex + runFirstIndex, vertexOffset, _firstInstance);
 }
 
 
-std::unique_ptr<Model> Model::loadFromFile(Device &device, const std::string &_modelFilepath = "", const std::string &_textureFilepath = "") {
+std::unique_ptr<Model> Model::loadFromFile(GeometryPool &geometryPool, const std::string &_modelFilepath = "", const std::string &_textureFilepath = "") {
     Builder builder{};
 
     if (!_modelFilepath.empty())
@@ -207,25 +426,91 @@ std::unique_ptr<Model> Model::loadFromFile(Device &device, const std::string &_m
     if (!_textureFilepath.empty())
         builder.loadTextureFile(_textureFilepath);
 
-    auto model = std::make_unique<Model>(device, builder);
+    auto model = std::make_unique<Model>(geometryPool, builder);
     return model;
 }
 
 
+std::vector<std::unique_ptr<Model>> Model::loadFromFiles(GeometryPool &geometryPool, ThreadPool &workers, const Logger &log, const std::vector<ModelLoadInfo> &_loadInfos) {
+    //every builder is written by at most two decoders touching disjoint fields, so no locking is needed
+    std::vector<Builder> buildersList(_loadInfos.size());
+
+    BatchFileReader reader{workers, log};
+    for (size_t i = 0; i < _loadInfos.size(); ++i) {
+        Builder *builder = &buildersList[i];
+        if (!_loadInfos[i].modelFilepath.empty())
+            reader.enqueue(_loadInfos[i].modelFilepath, [builder](FileBlob &blob) {
+                builder->loadFromModelMemory(blob.data.get(), blob.size);
+            });
+        if (!_loadInfos[i].textureFilepath.empty())
+            reader.enqueue(_loadInfos[i].textureFilepath, [builder](FileBlob &blob) {
+                builder->loadTextureMemory(blob.data.get(), blob.size);
+            });
+    }
+    reader.readAll();
+
+    std::vector<std::unique_ptr<Model>> modelsList;
+    modelsList.reserve(buildersList.size());
+    for (auto &builder : buildersList) {
+        modelsList.push_back(std::make_unique<Model>(geometryPool, builder));
+    }
+    return modelsList;
+}
+
+
 void Builder::loadFromModelFile(const std::string &filepath) {
+    //goes through FileHelper so models inside a mounted asset pack are found too
+    auto bytes = FileHelper::readFile(filepath);
+    loadFromModelMemory(bytes.data(), bytes.size());
+}
+
+void Builder::loadFromModelMemory(const char *data, size_t size, uint64_t _contentHash) {
+    if (_contentHash != 0 && MeshCache::load(_contentHash, *this)) {
+        quantize();
+        return;
+    }
+
     tinyobj::attrib_t attrib;
     std::vector<tinyobj::shape_t> shapes;
     std::vector<tinyobj::material_t> materials;
     std::string warn, err;
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
+    MemoryStreamBuffer streamBuffer{data, size};
+    std::istream stream{&streamBuffer};
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream)) {
         throw std::runtime_error(warn + err);
     }
 
+    fillFromObj(*this, attrib, shapes);
+    //runs on the decoding thread, the upload only copies the result
+    buildMesh(_contentHash);
+}
+
+void Builder::buildMesh(uint64_t _contentHash) {
+    optimize();
+    generateLods();
+    generateMeshlets();
+    if (_contentHash != 0)
+        MeshCache::store(_contentHash, *this);
+    quantize();
+}
+
+void Builder::importMesh(uint64_t _contentHash) {
+    if (_contentHash != 0 && MeshCache::load(_contentHash, *this)) {
+        quantize();
+        return;
+    }
+    buildMesh(_contentHash);
+}
+
+static void fillFromObj(Builder &builder, const tinyobj::attrib_t &attrib, const std::vector<tinyobj::shape_t> &shapes) {
+    auto &vertices = builder.vertices;
+    auto &indices = builder.indices;
+
     vertices.clear();
     indices.clear();
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    std::unordered_map<Vertex, uint32_t, VertexHash<Vertex>, VertexEqual<Vertex>> uniqueVertices{};
     for (const auto &shape : shapes) {
         for (const auto &index : shape.mesh.indices) {
             Vertex vertex{};
@@ -274,10 +559,20 @@ void Builder::loadFromModelFile(const std::string &filepath) {
 }
 
 void Builder::loadTextureFile(const std::string &filepath) {
+    auto bytes = FileHelper::readFile(filepath);
+    loadTextureMemory(bytes.data(), bytes.size());
+}
 
-    image.pixels = stbi_load(filepath.c_str(), &image.width, &image.height, &image.channels_size, STBI_rgb_alpha);
+void Builder::loadTextureMemory(const char *data, size_t size) {
+
+    image.pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(data), static_cast<int>(size), &image.width, &image.height, &image.channels_size, STBI_rgb_alpha);
 
     if (!image.pixels) {
         throw std::runtime_error("failed to load texture image!");
     }
 }
+
+void Builder::freeTexturePixels() {
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
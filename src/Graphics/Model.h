@@ -7,7 +7,9 @@
 #include <glm/gtx/hash.hpp>
 #include <glm/trigonometric.hpp>
 #include <glm/ext/matrix_float3x3.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
 
+#include <algorithm>
 #include <unordered_map>
 #include <cstring>
 #include <memory>
@@ -17,21 +19,64 @@
 #include "utils.h"
 #include "Buffer.h"
 #include "ImageBuffer.h"
+#include "GeometryPool.h"
+#include "VertexLayout.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
 
+class ThreadPool;
+
+//full precision vertex the loaders decode into and cpu side mesh processing works on, the gpu gets CompactVertex
 struct Vertex{
     glm::vec3 position{0.0f, 0.0f, 0.0f};
     glm::vec3 color{1.0f, 0.0f, 0.0f};
     glm::vec3 normal{};
     glm::vec2 uv{};
+};
+
+template<>
+struct VertexDescription<Vertex> : VertexLayout<Vertex,
+        VERTEX_ATTRIBUTE(Vertex, position, VK_FORMAT_R32G32B32_SFLOAT),
+        VERTEX_ATTRIBUTE(Vertex, color, VK_FORMAT_R32G32B32_SFLOAT),
+        VERTEX_ATTRIBUTE(Vertex, normal, VK_FORMAT_R32G32B32_SFLOAT),
+        VERTEX_ATTRIBUTE(Vertex, uv, VK_FORMAT_R32G32_SFLOAT)> {};
+
+//mesh space position = offset + quantized position * scale. the scale is the same on every axis, so the
+//dequantization folds into the model matrix and bounding spheres stay spheres
+struct VertexQuantization{
+    glm::vec3 offset{0.0f};
+    float scale = 1.0f;
 
-    static VkVertexInputBindingDescription getBindingDescription();
-    static std::vector <VkVertexInputAttributeDescription> getAttributeDescription();
+    glm::mat4 getDequantizationMatrix() const;
+};
+
+//20 bytes instead of the 44 of Vertex: position unorm16 inside the mesh's quantization box (w unused),
+//normal octahedral encoded in 2x snorm16, color rgba8 unorm, uv 2x half float
+struct CompactVertex{
+    uint16_t position[4];
+    uint32_t normal;
+    uint32_t color;
+    uint32_t uv;
+};
 
-    bool operator==(const Vertex &_other) const{
-        return position == _other.position && color == _other.color && normal == _other.normal && uv == _other.uv;
-    }
+//normals are octahedral coordinates in [-1, 1] decoded in the vertex shader, uvs are half floats so they can repeat
+template<>
+struct VertexDescription<CompactVertex> : VertexLayout<CompactVertex,
+        VERTEX_ATTRIBUTE(CompactVertex, position, VK_FORMAT_R16G16B16A16_UNORM),
+        VERTEX_ATTRIBUTE(CompactVertex, color, VK_FORMAT_R8G8B8A8_UNORM),
+        VERTEX_ATTRIBUTE(CompactVertex, normal, VK_FORMAT_R16G16_SNORM),
+        VERTEX_ATTRIBUTE(CompactVertex, uv, VK_FORMAT_R16G16_SFLOAT)> {};
+
+//one entry of the position only stream used by depth only passes, the same unorm16 positions at location 0,
+//so vertex shaders can share the input declaration
+struct CompactPosition{
+    uint16_t position[4];
 };
 
+template<>
+struct VertexDescription<CompactPosition> : VertexLayout<CompactPosition,
+        VERTEX_ATTRIBUTE(CompactPosition, position, VK_FORMAT_R16G16B16A16_UNORM)> {};
+
 struct ImageBuilder{
     void* pixels = nullptr;
     int width = 0;
@@ -40,13 +85,58 @@ struct ImageBuilder{
     bool initialized = false;
 };
 
+//one level of detail, a range of the index list drawn over the same vertices. error is how far the level may be from
+//the full mesh, in model units. levels split into meshlets own a range of the meshlet list, their index ranges are
+//relative to firstIndex
+struct MeshLod{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+};
+
 struct Builder{
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     ImageBuilder image{};
+    //gpu format of vertices and indices, filled by the model loaders. code that edits them afterwards calls quantize again
+    std::vector<CompactVertex> compactVertices;
+    VertexQuantization quantization{};
+    //indices narrowed to 16 bits when the vertex count allows it, empty for 32 bit meshes
+    std::vector<uint16_t> compactIndices;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    //acmr and atvr of the indices as imported and after optimize
+    MeshOptimizationStats optimizationStats{};
+    //ranges of indices, full mesh first. empty means the whole index list is the only level
+    std::vector<MeshLod> lods;
+    //clusters of every level with at least MeshletBuilder::MIN_TRIANGLES triangles, bounds in model units
+    std::vector<Meshlet> meshlets;
+
+    void quantize();
+    //reorders indices for the post transform cache and overdraw, then vertices for fetch locality
+    void optimize();
+    //appends simplified levels to the indices, call after optimize so they share its vertex order
+    void generateLods();
+    //splits the large levels into meshlets, reordering the triangles inside every level. call after generateLods
+    void generateMeshlets();
+    //optimize, generateLods, generateMeshlets and quantize. with a content hash the result goes into the mesh cache
+    void buildMesh(uint64_t _contentHash = 0);
+    //buildMesh for vertices and indices put together in memory, a hit in the mesh cache replaces them and skips the work
+    void importMesh(uint64_t _contentHash);
 
     void loadFromModelFile(const std::string &filepath);
     void loadTextureFile(const std::string &filepath);
+    //decode from an already read file, used by the batched loader on worker threads. the mesh is optimized, gets its
+    //lods and meshlets and is quantized, with the content hash of the file it is looked up in and added to the mesh cache
+    void loadFromModelMemory(const char *data, size_t size, uint64_t _contentHash = 0);
+    void loadTextureMemory(const char *data, size_t size);
+    void freeTexturePixels();
+};
+
+struct ModelLoadInfo{
+    std::string modelFilepath;
+    std::string textureFilepath;
 };
 
 class Model {
@@ -54,34 +144,72 @@ private:
 
     Device& device;
 
-    //vertex buffer
-    std::unique_ptr<Buffer> vertexBuffer;
+    //vertices and indices live in a shared pool, this is the range owned by the model
+    GeometryPool& geometryPool;
+    GeometryRange geometry{};
+    //index ranges relative to the geometry, never empty
+    std::vector<MeshLod> lodsList;
+    //bounds in the quantized space, like the bounding sphere the gpu tests
+    std::vector<Meshlet> meshletsList;
+    VertexQuantization quantization{};
+    //local space center in xyz and radius in w
+    glm::vec4 boundingSphere{0.0f};
 
-    //indices buffer
-    std::unique_ptr<Buffer> indexBuffer;
+    //texture buffer, shared between models using the same image
+    std::shared_ptr<ImageBuffer> textureBuffer;
 
-    //texture buffer
-    std::unique_ptr<ImageBuffer> textureBuffer;
-
-    uint32_t vertexCount = 0;
-
-    uint32_t indicesCount = 0;
     bool hasIndices = false;
     bool hasTexture = false;
 public:
-    Model(Device &_device, const Builder &_builder);
+    Model(GeometryPool &_geometryPool, const Builder &_builder);
     ~Model();
 
-    void createVertexBuffers(const std::vector<Vertex>& _vertexList);
-    void createIndexBuffers(const std::vector<uint32_t>& _indicesList);
+    //uses the builder's compact vertices and indices, packs its own copy when those are missing or stale
+    void createGeometry(const Builder &_builder);
     void createTextureBuffers(const ImageBuilder &_image);
 
-    void bindDataToBuffer(const VkCommandBuffer &commandBuffer);
-    void drawDataToBuffer(const VkCommandBuffer &commandBuffer) const;
+    //binds the whole pool block, models in the same block can skip it
+    void bindDataToBuffer(CommandRecorder &_recorder);
+    //same as bindDataToBuffer with the position only stream, for depth only passes
+    void bindPositionsToBuffer(CommandRecorder &_recorder);
+    //levels past the coarsest one draw the coarsest one. _firstInstance reaches the shader as gl_InstanceIndex
+    void drawDataToBuffer(CommandRecorder &_recorder, uint32_t _lod = 0, uint32_t _firstInstance = 0) const;
+    //draws the meshlets of a level that have a non zero entry in _visible, neighbours in one draw.
+    //_visible holds getLod(_lod).meshletCount entries
+    void drawMeshletsToBuffer(CommandRecorder &_recorder, uint32_t _lod, const uint8_t *_visible, uint32_t _firstInstance = 0) const;
 
     ImageBuffer& getTextureBuffer(){return *textureBuffer;}
+    const std::shared_ptr<ImageBuffer>& getSharedTexture() const {return textureBuffer;}
+    void setTexture(std::shared_ptr<ImageBuffer> _texture);
+    //exchanges all gpu data, used to replace a placeholder in place while handles to it are alive
+    void swapContents(Model &_other);
+    //device memory owned by this model, shared textures are not included
+    VkDeviceSize getGeometryMemorySize() const;
+    //downloads the vertices and the full level's indices from the pool, decoded back into model units. waits for the
+    //gpu, for build steps like static batching and never per frame
+    void readGeometry(std::vector<Vertex> &_vertices, std::vector<uint32_t> &_indices) const;
+
+    uint32_t getVertexCount() const {return geometry.vertexCount;}
+    //indices of all levels together
+    uint32_t getIndexCount() const {return geometry.indexCount;}
+    VkIndexType getIndexType() const {return geometry.indexType;}
+    uint32_t getLodCount() const {return static_cast<uint32_t>(lodsList.size());}
+    const MeshLod& getLod(uint32_t _lod) const {return lodsList[std::min(_lod, getLodCount() - 1)];}
+    const GeometryRange& getGeometry() const {return geometry;}
+    //all levels, indexed by MeshLod::firstMeshlet
+    const std::vector<Meshlet>& getMeshlets() const {return meshletsList;}
+    const glm::vec4& getBoundingSphere() const {return boundingSphere;}
+    //multiply into the model matrix of anything drawing the model, the vertices are quantized
+    glm::mat4 getDequantizationMatrix() const {return quantization.getDequantizationMatrix();}
+    //bounding sphere in the quantized space, goes with a model matrix that includes the dequantization
+    glm::vec4 getQuantizedBoundingSphere() const;
 
 public:
-    static std::unique_ptr<Model> loadFromFile(Device &device, const std::string &_modelFilepath, const std::string &_textureFilepath);
+    //uploads decoded pixels, the caller still owns them. the result can be shared by any number of models
+    static std::unique_ptr<ImageBuffer> createTexture(Device &device, const ImageBuilder &_image);
+
+    static std::unique_ptr<Model> loadFromFile(GeometryPool &geometryPool, const std::string &_modelFilepath, const std::string &_textureFilepath);
+    //reads all files in one batch and decodes them in parallel, gpu upload stays on the calling thread
+    static std::vector<std::unique_ptr<Model>> loadFromFiles(GeometryPool &geometryPool, ThreadPool &workers, const Logger &log, const std::vector<ModelLoadInfo> &_loadInfos);
 
 };
\ No newline at end of file
@@ -1,22 +1,10 @@
 #pragma once
 
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_TO_ZERO
-#include <glm/vec2.hpp>
-#include <glm/ext/matrix_float2x2.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 #include <memory>
 #include "Model.h"
-
-struct TransformationPrimitive{
-    glm::vec3 translation{};
-    glm::vec3 scaleVector = {1.0f, 1.0f, 1.0f};
-    glm::vec3 rotation{0.0f};
-
-    glm::mat4 getTransformationMatrix();
-    glm::mat4 getTransformationMatrixFAST();
-    glm::mat3 getNormalMatrix();
-};
+#include "SoftwareOcclusionCuller.h"
+#include "SlotMap.h"
+#include "Transform.h"
 
 class Object {
 public:
@@ -28,6 +16,15 @@ public:
     Object &operator=(Object &&) = default;
 
 public:
-    std::unique_ptr<Model> mesh;
+    std::shared_ptr<Model> mesh;
+    //relative to the parent's world transform when the object has one
     TransformationPrimitive transform;
+    //handle of the parent in the scene's objects, a parent that was erased leaves the object at the root
+    SlotHandle parent = INVALID_SLOT_HANDLE;
+    //simplified stand in rasterized by the cpu occlusion culler, objects without one never hide others
+    std::shared_ptr<const OccluderMesh> occluder;
+    //level of detail picked by LodSelector, kept from frame to frame for its hysteresis
+    uint32_t lod = 0;
+    //never moves after the scene is built, StaticBatcher may merge it with its neighbours
+    bool isStatic = false;
 };
\ No newline at end of file
@@ -75,6 +75,25 @@ void Pipeline::getDefaultPipelineInfo(PipelineConfigInfo &pipelineInfo) {
     pipelineInfo.dynamicStateCreateInfo.pDynamicStates = pipelineInfo.dynamicStatesList.data();
     pipelineInfo.dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(pipelineInfo.dynamicStatesList.size());
     pipelineInfo.dynamicStateCreateInfo.flags = 0;
+
+    //vertex input
+    setVertexInput<CompactVertex>(pipelineInfo);
+}
+
+void Pipeline::getDepthPrePassPipelineInfo(PipelineConfigInfo &pipelineInfo) {
+    getDefaultPipelineInfo(pipelineInfo);
+
+    setVertexInput<CompactPosition>(pipelineInfo);
+
+    //the color attachment stays part of the render pass, it is just left untouched
+    pipelineInfo.colorBlendAttachment.colorWriteMask = 0;
+}
+
+void Pipeline::getDepthEqualPipelineInfo(PipelineConfigInfo &pipelineInfo) {
+    getDefaultPipelineInfo(pipelineInfo);
+
+    pipelineInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    pipelineInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
 }
 
 VkPipelineShaderStageCreateInfo Pipeline::createFragmentShader(const std::vector<char> &bytecode) {
@@ -87,7 +106,7 @@ VkPipelineShaderStageCreateInfo Pipeline::createFragmentShader(const std::vector
     fragmentStageInfo.pName = "main";
     fragmentStageInfo.flags = 0;
     fragmentStageInfo.pNext = nullptr;
-    fragmentStageInfo.pSpecializationInfo = nullptr;
+    fragmentStageInfo.pSpecializationInfo = createInfo.fragmentSpecializationInfo;
     return fragmentStageInfo;
 }
 
@@ -110,25 +129,24 @@ void Pipeline::createGraphicsPipeline(const std::string &vertexFilePath, const s
     assert(createInfo.renderPass != VK_NULL_HANDLE && "cant create graphics pipeline: no renderPass is provided");
     assert(createInfo.pipelineLayoutInfo != VK_NULL_HANDLE && "cant create graphics pipeline: no _pipelineLayout is provided");
 
-    auto fragBytecode =  FileHelper::readFile(fragmentFilePath);
     auto vertexBytecode =  FileHelper::readFile(vertexFilePath);
-
-    fragmentShaderStageInfo = createFragmentShader(fragBytecode);
     vertexShaderStageInfo = createVertexShader(vertexBytecode);
 
-    VkPipelineShaderStageCreateInfo shaderStages[2] = {vertexShaderStageInfo, fragmentShaderStageInfo};
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages = {vertexShaderStageInfo};
+    if (!fragmentFilePath.empty()) {
+        auto fragBytecode =  FileHelper::readFile(fragmentFilePath);
+        fragmentShaderStageInfo = createFragmentShader(fragBytecode);
+        shaderStages.push_back(fragmentShaderStageInfo);
+    }
 
 
     //pipeline input data description
-    auto vertexAttributes = Vertex::getAttributeDescription();
-    auto vertexBinding = Vertex::getBindingDescription();
-
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributes.size());
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
-    vertexInputInfo.pVertexBindingDescriptions = &vertexBinding;
+    vertexInputInfo.vertexAttributeDescriptionCount = createInfo.attributeDescriptionCount;
+    vertexInputInfo.vertexBindingDescriptionCount = createInfo.bindingDescriptionCount;
+    vertexInputInfo.pVertexAttributeDescriptions = createInfo.attributeDescriptions;
+    vertexInputInfo.pVertexBindingDescriptions = createInfo.bindingDescriptions;
 
     //viewport state
     VkPipelineViewportStateCreateInfo viewportInfo{};
@@ -140,8 +158,8 @@ void Pipeline::createGraphicsPipeline(const std::string &vertexFilePath, const s
 
     VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
     pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineCreateInfo.stageCount = 2;
-    pipelineCreateInfo.pStages = shaderStages;
+    pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineCreateInfo.pStages = shaderStages.data();
     pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
     pipelineCreateInfo.pInputAssemblyState = &createInfo.inputAssemblyInfo;
     pipelineCreateInfo.pViewportState = &viewportInfo;
@@ -175,12 +193,13 @@ void Pipeline::createGraphicsPipeline(const std::string &vertexFilePath, const s
 }
 
 Pipeline::~Pipeline() {
-    vkDestroyShaderModule(device.getDevice(), fragmentShader, nullptr);
+    if (fragmentShader != VK_NULL_HANDLE)
+        vkDestroyShaderModule(device.getDevice(), fragmentShader, nullptr);
     vkDestroyShaderModule(device.getDevice(), vertexShader, nullptr);
 
     vkDestroyPipeline(device.getDevice(), graphicsPipeline, nullptr);
 }
 
-void Pipeline::bind(VkCommandBuffer const &commandBuffer) {
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+void Pipeline::bind(CommandRecorder &_recorder) {
+    _recorder.bindPipeline(graphicsPipeline);
 }
@@ -19,6 +19,15 @@ struct PipelineConfigInfo {
     std::vector<VkDynamicState> dynamicStatesList;
     VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo;
 
+    //static arrays of a VertexDescription, set with Pipeline::setVertexInput
+    const VkVertexInputBindingDescription *bindingDescriptions = nullptr;
+    uint32_t bindingDescriptionCount = 0;
+    const VkVertexInputAttributeDescription *attributeDescriptions = nullptr;
+    uint32_t attributeDescriptionCount = 0;
+
+    //constants of the fragment shader, has to outlive the pipeline's creation
+    const VkSpecializationInfo *fragmentSpecializationInfo = nullptr;
+
     VkPipelineLayout pipelineLayoutInfo = nullptr;
     VkRenderPass renderPass = nullptr;
     uint32_t subpass = 0;
@@ -26,6 +35,7 @@ struct PipelineConfigInfo {
 
 class Pipeline {
 public:
+    //an empty fragmentFilePath creates a vertex only pipeline, used for depth only passes
     Pipeline(Device &_device, const std::string &vertexFilePath, const std::string &fragmentFilePath,
              const PipelineConfigInfo &_createInfo, const Logger &_log);
     ~Pipeline();
@@ -33,11 +43,26 @@ public:
     Pipeline(const Pipeline &) = delete;
     Pipeline& operator=(const Pipeline &) = delete;
 
-    void bind(const VkCommandBuffer &commandBuffer);
+    void bind(CommandRecorder &_recorder);
     static void getDefaultPipelineInfo(PipelineConfigInfo &pipelineInfo);
+    //depth pre-pass: position only vertex stream, no color writes, fills the depth buffer
+    static void getDepthPrePassPipelineInfo(PipelineConfigInfo &pipelineInfo);
+    //main pass after a depth pre-pass: depth is complete, so only the nearest fragment passes and nothing is written.
+    //the vertex shader has to compute gl_Position exactly like the pre-pass one (invariant gl_Position)
+    static void getDepthEqualPipelineInfo(PipelineConfigInfo &pipelineInfo);
+
+    //any vertex type with a VertexDescription, the defaults use CompactVertex and CompactPosition
+    template<typename VertexType>
+    static void setVertexInput(PipelineConfigInfo &pipelineInfo) {
+        using Description = VertexDescription<VertexType>;
+        pipelineInfo.bindingDescriptions = Description::bindings.data();
+        pipelineInfo.bindingDescriptionCount = static_cast<uint32_t>(Description::bindings.size());
+        pipelineInfo.attributeDescriptions = Description::attributes.data();
+        pipelineInfo.attributeDescriptionCount = static_cast<uint32_t>(Description::attributes.size());
+    }
 private:
     VkPipelineShaderStageCreateInfo fragmentShaderStageInfo;
-    VkShaderModule fragmentShader;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
 
     VkPipelineShaderStageCreateInfo vertexShaderStageInfo;
     VkShaderModule vertexShader;
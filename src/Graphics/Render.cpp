@@ -101,13 +101,22 @@ void Render::endFrame() {
     currentFrameIndex = (currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 
-void Render::beginRenderPass(VkCommandBuffer _commandBuffer) {
+void Render::beginRenderPass(CommandRecorder &_recorder, VkSubpassContents _contents) {
+    beginRenderPass(_recorder, swapChain->getRenderPass(), _contents);
+}
+
+void Render::beginOverlayRenderPass(CommandRecorder &_recorder) {
+    beginRenderPass(_recorder, swapChain->getOverlayRenderPass(), VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void Render::beginRenderPass(CommandRecorder &_recorder, VkRenderPass _renderPass, VkSubpassContents _contents) {
+    VkCommandBuffer commandBuffer = _recorder.getCommandBuffer();
     assert(isFrameStarted && "cant beginRenderPass when already is not in progress");
-    assert(getCurrentCommandBuffer() == _commandBuffer && "cant begin render pass on command buffer from different frame");
+    assert(getCurrentCommandBuffer() == commandBuffer && "cant begin render pass on command buffer from different frame");
 
     VkRenderPassBeginInfo renderPassBeginInfo{};
     renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassBeginInfo.renderPass = swapChain->getRenderPass();
+    renderPassBeginInfo.renderPass = _renderPass;
     renderPassBeginInfo.framebuffer = swapChain->getFrameBuffer(static_cast<int>(currentImageIndex));
 
     renderPassBeginInfo.renderArea.offset = {0, 0};
@@ -119,7 +128,9 @@ void Render::beginRenderPass(VkCommandBuffer _commandBuffer) {
     renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassBeginInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, _contents);
+    if (_contents != VK_SUBPASS_CONTENTS_INLINE)
+        return;
 
     VkViewport viewport{};
     viewport.x = 0;
@@ -133,8 +144,9 @@ void Render::beginRenderPass(VkCommandBuffer _commandBuffer) {
     scissor.offset = {0, 0};
     scissor.extent = {swapChain->getSwapChainExtent().width, swapChain->getSwapChainExtent().height};
 
-    vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
-    vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+    //dynamic state outlives the render pass, the overlay pass usually finds both already set
+    _recorder.setViewport(viewport);
+    _recorder.setScissor(scissor);
 
 }
 
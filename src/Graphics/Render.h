@@ -24,6 +24,7 @@ private:
     void drawFrame();
     void recreateSwapChain();
     void freeCommandBuffers();
+    void beginRenderPass(CommandRecorder &_recorder, VkRenderPass _renderPass, VkSubpassContents _contents);
 
 public:
     VkRenderPass getRenderPass() const {return swapChain->getRenderPass();}
@@ -36,10 +37,20 @@ public:
 
     VkCommandBuffer beginFrame();
     void endFrame();
-    void beginRenderPass(VkCommandBuffer _commandBuffer);
+    //clears and draws the scene, leaves the depth readable for compute. with secondary command buffer contents the
+    //pass takes nothing but vkCmdExecuteCommands, the secondaries set their own viewport and scissor
+    void beginRenderPass(CommandRecorder &_recorder, VkSubpassContents _contents = VK_SUBPASS_CONTENTS_INLINE);
+    //continues on top of the scene pass and ends the frame's image presentable, every frame needs both
+    void beginOverlayRenderPass(CommandRecorder &_recorder);
     void endRenderPass(VkCommandBuffer _commandBuffer);
 
     float getAspectRatio(){return swapChain->extentAspectRatio();}
+    VkExtent2D getSwapChainExtent(){return swapChain->getSwapChainExtent();}
+
+    VkImageView getCurrentDepthImageView(){
+        assert(isFrameStarted && "cant get depth image when frame isnt started");
+        return swapChain->getDepthImageView(static_cast<int>(currentImageIndex));
+    }
 
     int getFrameIndex(){
         assert(isFrameStarted && "Cannot get frame index when frame not in progress");
@@ -0,0 +1,90 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "../Jobs/ThreadPool.h"
+
+static constexpr uint32_t RADIX_BITS = 8;
+static constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+uint64_t RenderQueue::makeKey(uint32_t _pass, uint32_t _pipeline, uint32_t _material, uint32_t _block, uint32_t _mesh, float _depth) {
+    auto field = [](uint64_t _value, uint32_t _bits) { return _value & ((uint64_t{1} << _bits) - 1); };
+    float clampedDepth = std::min(std::max(_depth, 0.0f), 1.0f);
+    auto depth = static_cast<uint64_t>(std::lround(clampedDepth * static_cast<float>((1u << DEPTH_BITS) - 1)));
+
+    uint64_t key = field(_pass, PASS_BITS);
+    key = (key << PIPELINE_BITS) | field(_pipeline, PIPELINE_BITS);
+    key = (key << MATERIAL_BITS) | field(_material, MATERIAL_BITS);
+    key = (key << BLOCK_BITS) | field(_block, BLOCK_BITS);
+    key = (key << MESH_BITS) | field(_mesh, MESH_BITS);
+    key = (key << DEPTH_BITS) | depth;
+    return key;
+}
+
+void RenderQueue::clear() {
+    itemsList.clear();
+    meshIdsList.clear();
+}
+
+uint32_t RenderQueue::getMeshId(const void *_mesh) {
+    return meshIdsList.emplace(_mesh, static_cast<uint32_t>(meshIdsList.size())).first->second;
+}
+
+void RenderQueue::sort(ThreadPool *_workers) {
+    size_t count = itemsList.size();
+    if (count < 2)
+        return;
+
+    uint64_t differing = 0;
+    for (const auto &item : itemsList)
+        differing |= item.key ^ itemsList[0].key;
+
+    uint32_t sliceCount = _workers != nullptr && count >= PARALLEL_SORT_MIN_ITEMS ? _workers->getWorkerCount() : 1;
+    histogramsList.resize(sliceCount);
+    scratchList.resize(count);
+    auto sliceBegin = [&](uint32_t _slice) { return count * _slice / sliceCount; };
+    auto forEachSlice = [&](const std::function<void(uint32_t)> &_job) {
+        if (sliceCount == 1) {
+            _job(0);
+            return;
+        }
+        _workers->parallelFor(sliceCount, [&_job](uint32_t begin, uint32_t end) {
+            for (uint32_t slice = begin; slice < end; ++slice)
+                _job(slice);
+        });
+    };
+
+    for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS) {
+        if (((differing >> shift) & (RADIX_SIZE - 1)) == 0)
+            continue;
+
+        forEachSlice([&](uint32_t _slice) {
+            auto &histogram = histogramsList[_slice];
+            histogram.assign(RADIX_SIZE, 0);
+            for (size_t i = sliceBegin(_slice); i < sliceBegin(_slice + 1); ++i)
+                histogram[(itemsList[i].key >> shift) & (RADIX_SIZE - 1)]++;
+        });
+
+        //digit major, slice minor: every slice writes its items of a digit behind those of the slices before it,
+        //which keeps the sort stable
+        uint32_t offset = 0;
+        for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit) {
+            for (auto &histogram : histogramsList) {
+                uint32_t digitCount = histogram[digit];
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+        }
+
+        forEachSlice([&](uint32_t _slice) {
+            auto &histogram = histogramsList[_slice];
+            for (size_t i = sliceBegin(_slice); i < sliceBegin(_slice + 1); ++i) {
+                const auto &item = itemsList[i];
+                scratchList[histogram[(item.key >> shift) & (RADIX_SIZE - 1)]++] = item;
+            }
+        });
+        itemsList.swap(scratchList);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+//one draw waiting to be recorded
+struct RenderItem {
+    uint64_t key;
+    uint32_t object;
+};
+
+//state changes of the last recorded queue as counted by the CommandRecorder. the avoided counts are the binds it
+//dropped, the ones a recorder setting all state for every draw would have issued on top
+struct RenderQueueStats {
+    uint32_t draws = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t descriptorSetBinds = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t pipelineBindsAvoided = 0;
+    uint32_t descriptorSetBindsAvoided = 0;
+    uint32_t vertexBufferBindsAvoided = 0;
+};
+
+//draws of a frame keyed by 64 bits, most significant field first:
+//pass 4 | pipeline 8 | material 12 | geometry block 8 | mesh 16 | depth 16
+//sorting the keys puts every kind of state change as far apart as the field order allows, and draws that share all
+//state front to back. ids wider than their field wrap around, which only costs grouping
+class RenderQueue {
+public:
+    static constexpr uint32_t PASS_BITS = 4;
+    static constexpr uint32_t PIPELINE_BITS = 8;
+    static constexpr uint32_t MATERIAL_BITS = 12;
+    static constexpr uint32_t BLOCK_BITS = 8;
+    static constexpr uint32_t MESH_BITS = 16;
+    static constexpr uint32_t DEPTH_BITS = 16;
+    //below this the sort stays on the calling thread, jobs cost more than they save
+    static constexpr uint32_t PARALLEL_SORT_MIN_ITEMS = 4096;
+
+    //_depth is normalized to [0, 1], smaller sorts first
+    static uint64_t makeKey(uint32_t _pass, uint32_t _pipeline, uint32_t _material, uint32_t _block, uint32_t _mesh, float _depth);
+    static uint32_t getPass(uint64_t _key) { return static_cast<uint32_t>(_key >> (64 - PASS_BITS)); }
+    static uint32_t getPipeline(uint64_t _key) { return static_cast<uint32_t>(_key >> (64 - PASS_BITS - PIPELINE_BITS)) & ((1u << PIPELINE_BITS) - 1); }
+
+    //drops the items and the mesh ids of the last frame
+    void clear();
+    void push(uint64_t _key, uint32_t _object) { itemsList.push_back({_key, _object}); }
+    //small ids in first seen order, for the mesh field. materials are texture slots, small already
+    uint32_t getMeshId(const void *_mesh);
+
+    //stable lsd radix sort over bytes, bytes every key agrees on are skipped. with _workers every pass histograms and
+    //scatters one slice of the items per worker
+    void sort(ThreadPool *_workers = nullptr);
+
+    const std::vector<RenderItem> &getItems() const { return itemsList; }
+    size_t size() const { return itemsList.size(); }
+
+private:
+    std::vector<RenderItem> itemsList;
+    std::vector<RenderItem> scratchList;
+    std::vector<std::vector<uint32_t>> histogramsList;
+    std::unordered_map<const void *, uint32_t> meshIdsList;
+};
@@ -0,0 +1,143 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+#include "../Jobs/ThreadPool.h"
+
+void SceneGraph::setHierarchy(const std::vector<uint32_t> &_parents) {
+    if (_parents == parentsList && !objectOfNodeList.empty())
+        return;
+
+    auto count = static_cast<uint32_t>(_parents.size());
+    //children of every object back to back, in object order
+    std::vector<uint32_t> childOffsetsList(count + 1, 0);
+    for (uint32_t object = 0; object < count; ++object) {
+        uint32_t parent = _parents[object];
+        if (parent == NO_PARENT)
+            continue;
+        if (parent >= count || parent == object)
+            throw std::runtime_error("scene hierarchy has an invalid parent");
+        childOffsetsList[parent + 1]++;
+    }
+    for (uint32_t object = 0; object < count; ++object)
+        childOffsetsList[object + 1] += childOffsetsList[object];
+    std::vector<uint32_t> childrenList(childOffsetsList[count]);
+    std::vector<uint32_t> cursorsList(childOffsetsList.begin(), childOffsetsList.end() - 1);
+    for (uint32_t object = 0; object < count; ++object) {
+        if (_parents[object] != NO_PARENT)
+            childrenList[cursorsList[_parents[object]]++] = object;
+    }
+
+    objectOfNodeList.clear();
+    levelOffsetsList.clear();
+    for (uint32_t object = 0; object < count; ++object) {
+        if (_parents[object] == NO_PARENT)
+            objectOfNodeList.push_back(object);
+    }
+    //the children of one level, in the order of their parents, are the next level
+    uint32_t levelBegin = 0;
+    while (levelBegin < objectOfNodeList.size()) {
+        auto levelEnd = static_cast<uint32_t>(objectOfNodeList.size());
+        levelOffsetsList.push_back(levelBegin);
+        for (uint32_t node = levelBegin; node < levelEnd; ++node) {
+            uint32_t object = objectOfNodeList[node];
+            for (uint32_t child = childOffsetsList[object]; child < childOffsetsList[object + 1]; ++child)
+                objectOfNodeList.push_back(childrenList[child]);
+        }
+        levelBegin = levelEnd;
+    }
+    levelOffsetsList.push_back(levelBegin);
+    //objects on a cycle are never reached from a root
+    if (objectOfNodeList.size() != count)
+        throw std::runtime_error("scene hierarchy has a cycle");
+
+    nodeOfObjectList.resize(count);
+    for (uint32_t node = 0; node < count; ++node)
+        nodeOfObjectList[objectOfNodeList[node]] = node;
+    parentNodeList.resize(count);
+    for (uint32_t node = 0; node < count; ++node) {
+        uint32_t parent = _parents[objectOfNodeList[node]];
+        parentNodeList[node] = parent == NO_PARENT ? NO_PARENT : nodeOfObjectList[parent];
+    }
+
+    parentsList = _parents;
+    worldMatricesList.assign(count, glm::mat4{1.0f});
+    normalMatricesList.assign(count, glm::mat3{1.0f});
+    dirtyList.assign(count, 1);
+    levelDirtyList.assign(levelOffsetsList.size() - 1, 1);
+    anyDirty = count > 0;
+}
+
+void SceneGraph::update(const TransformSystem &_local, ThreadPool *_workers) {
+    stats = {};
+    updatedList.clear();
+    if (levelOffsetsList.empty())
+        return;
+
+    auto levelCount = static_cast<uint32_t>(levelOffsetsList.size()) - 1;
+    stats.nodes = static_cast<uint32_t>(objectOfNodeList.size());
+    stats.levels = levelCount;
+
+    for (uint32_t object : _local.getUpdatedList()) {
+        uint32_t node = nodeOfObjectList[object];
+        dirtyList[node] = 1;
+        auto level = std::upper_bound(levelOffsetsList.begin(), levelOffsetsList.end(), node) - levelOffsetsList.begin() - 1;
+        levelDirtyList[level] = 1;
+        anyDirty = true;
+    }
+    if (!anyDirty)
+        return;
+
+    std::atomic<uint32_t> updatedNodes{0};
+    auto updateNodes = [&](uint32_t _begin, uint32_t _end) {
+        uint32_t updated = 0;
+        for (uint32_t node = _begin; node < _end; ++node) {
+            uint32_t parent = parentNodeList[node];
+            if (parent != NO_PARENT && dirtyList[parent])
+                dirtyList[node] = 1;
+            if (!dirtyList[node])
+                continue;
+
+            uint32_t object = objectOfNodeList[node];
+            if (parent == NO_PARENT) {
+                worldMatricesList[node] = _local.getModelMatrix(object);
+                normalMatricesList[node] = _local.getNormalMatrix(object);
+            } else {
+                //the inverse transpose of a product is the product of the inverse transposes
+                worldMatricesList[node] = worldMatricesList[parent] * _local.getModelMatrix(object);
+                normalMatricesList[node] = normalMatricesList[parent] * _local.getNormalMatrix(object);
+            }
+            updated++;
+        }
+        updatedNodes += updated;
+    };
+
+    //a level is skipped when nothing in it changed and nothing above it did
+    bool parentLevelDirty = false;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        if (!parentLevelDirty && !levelDirtyList[level])
+            continue;
+
+        uint32_t begin = levelOffsetsList[level];
+        uint32_t end = levelOffsetsList[level + 1];
+        uint32_t before = updatedNodes;
+        if (_workers != nullptr && end - begin >= PARALLEL_MIN_NODES)
+            _workers->parallelFor(end - begin, [&](uint32_t _rangeBegin, uint32_t _rangeEnd) {
+                updateNodes(begin + _rangeBegin, begin + _rangeEnd);
+            });
+        else
+            updateNodes(begin, end);
+        parentLevelDirty = updatedNodes != before;
+        for (uint32_t node = begin; parentLevelDirty && node < end; ++node) {
+            if (dirtyList[node])
+                updatedList.push_back(objectOfNodeList[node]);
+        }
+    }
+
+    stats.updatedNodes = updatedNodes;
+    std::fill(dirtyList.begin(), dirtyList.end(), 0);
+    std::fill(levelDirtyList.begin(), levelDirtyList.end(), 0);
+    anyDirty = false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "TransformSystem.h"
+
+class ThreadPool;
+
+//nodes in the hierarchy and what the last update had to touch
+struct SceneGraphStats {
+    uint32_t nodes = 0;
+    uint32_t levels = 0;
+    uint32_t updatedNodes = 0;
+};
+
+//world matrices of objects placed relative to a parent object. nodes are stored breadth first: the roots, then all
+//their children, then the children's children, every level one contiguous range. a level only reads the level before
+//it, so its nodes are computed in parallel, and a node is only recomputed when its own transform or one above it
+//changed
+class SceneGraph {
+public:
+    static constexpr uint32_t NO_PARENT = 0xFFFFFFFFu;
+    //smaller levels stay on the calling thread, jobs cost more than they save
+    static constexpr uint32_t PARALLEL_MIN_NODES = 4096;
+
+    //_parents has one entry per object, the index of its parent object or NO_PARENT. the levels are only rebuilt when
+    //the hierarchy differs from the last one, every node is dirty after that. throws when the parents form a cycle
+    void setHierarchy(const std::vector<uint32_t> &_parents);
+
+    //recomputes the nodes whose local transform was rebuilt by the last update of _local and everything below them.
+    //_local holds the objects' transforms relative to their parents
+    void update(const TransformSystem &_local, ThreadPool *_workers = nullptr);
+
+    const glm::mat4 &getWorldMatrix(uint32_t _object) const { return worldMatricesList[nodeOfObjectList[_object]]; }
+    //inverse transpose of the world matrix's upper 3x3
+    const glm::mat3 &getNormalMatrix(uint32_t _object) const { return normalMatricesList[nodeOfObjectList[_object]]; }
+    //objects whose world matrix the last update recomputed, level by level
+    const std::vector<uint32_t> &getUpdatedList() const { return updatedList; }
+    //counts of the last update
+    const SceneGraphStats &getStats() const { return stats; }
+
+private:
+    //the hierarchy as given, by object
+    std::vector<uint32_t> parentsList;
+    //the rest by node
+    std::vector<uint32_t> objectOfNodeList;
+    std::vector<uint32_t> parentNodeList;
+    //first node of every level, and one past the last node at the end
+    std::vector<uint32_t> levelOffsetsList;
+    std::vector<uint8_t> dirtyList;
+    std::vector<uint8_t> levelDirtyList;
+    bool anyDirty = false;
+    std::vector<uint32_t> nodeOfObjectList;
+    std::vector<uint32_t> updatedList;
+
+    std::vector<glm::mat4> worldMatricesList;
+    std::vector<glm::mat3> normalMatricesList;
+    SceneGraphStats stats{};
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+//32 bit reference into a SlotMap: the slot in the low INDEX_BITS, the slot's generation above them. it keeps pointing
+//at its element however the others move, and stops resolving once the element is erased
+using SlotHandle = uint32_t;
+static constexpr SlotHandle INVALID_SLOT_HANDLE = 0xFFFFFFFFu;
+
+//elements packed back to back in one array that systems walk linearly, with handles that survive insertions and
+//removals. erasing moves the last element into the gap, so dense indices are only stable until the next erase.
+//insert and erase are O(1) and allocate nothing once the arrays have grown, a slot whose generation would run out
+//is retired instead of reused, so an old handle never resolves to a new element
+template<typename T>
+class SlotMap {
+public:
+    static constexpr uint32_t INDEX_BITS = 20;
+    static constexpr uint32_t MAX_SLOTS = 1u << INDEX_BITS;
+    //the last generation is never handed out, INVALID_SLOT_HANDLE stays unreachable
+    static constexpr uint32_t MAX_GENERATION = (1u << (32 - INDEX_BITS)) - 2;
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+    //throws once MAX_SLOTS slots are in use or retired
+    SlotHandle insert(T &&_value) {
+        uint32_t slot;
+        if (freeHead != NO_SLOT) {
+            slot = freeHead;
+            freeHead = slotsList[slot].dense;
+        } else {
+            //a handle only has INDEX_BITS for the slot, one more would alias slot 0
+            if (slotsList.size() >= MAX_SLOTS)
+                throw std::runtime_error("slot map is full");
+            slot = static_cast<uint32_t>(slotsList.size());
+            slotsList.push_back({});
+        }
+        slotsList[slot].dense = static_cast<uint32_t>(denseList.size());
+        denseList.push_back(std::move(_value));
+        slotOfDenseList.push_back(slot);
+        return makeHandle(slot, slotsList[slot].generation);
+    }
+
+    //false when the handle no longer resolves
+    bool erase(SlotHandle _handle) {
+        uint32_t index = getIndex(_handle);
+        if (index == INVALID_INDEX)
+            return false;
+
+        uint32_t slot = _handle & (MAX_SLOTS - 1);
+        auto last = static_cast<uint32_t>(denseList.size()) - 1;
+        if (index != last) {
+            denseList[index] = std::move(denseList[last]);
+            slotOfDenseList[index] = slotOfDenseList[last];
+            slotsList[slotOfDenseList[index]].dense = index;
+        }
+        denseList.pop_back();
+        slotOfDenseList.pop_back();
+
+        auto &entry = slotsList[slot];
+        entry.dense = NO_SLOT;
+        if (entry.generation < MAX_GENERATION) {
+            entry.generation++;
+            entry.dense = freeHead;
+            freeHead = slot;
+        }
+        return true;
+    }
+
+    void clear() {
+        while (!denseList.empty())
+            erase(getHandle(static_cast<uint32_t>(denseList.size()) - 1));
+    }
+
+    void reserve(uint32_t _count) {
+        denseList.reserve(_count);
+        slotOfDenseList.reserve(_count);
+        slotsList.reserve(_count);
+    }
+
+    //position of the element in the dense array, INVALID_INDEX once it is erased
+    uint32_t getIndex(SlotHandle _handle) const {
+        uint32_t slot = _handle & (MAX_SLOTS - 1);
+        if (_handle == INVALID_SLOT_HANDLE || slot >= slotsList.size())
+            return INVALID_INDEX;
+        const auto &entry = slotsList[slot];
+        bool alive = entry.generation == _handle >> INDEX_BITS && entry.dense < denseList.size() &&
+                     slotOfDenseList[entry.dense] == slot;
+        return alive ? entry.dense : INVALID_INDEX;
+    }
+    SlotHandle getHandle(uint32_t _index) const {
+        uint32_t slot = slotOfDenseList[_index];
+        return makeHandle(slot, slotsList[slot].generation);
+    }
+    bool contains(SlotHandle _handle) const { return getIndex(_handle) != INVALID_INDEX; }
+    //null once the element is erased
+    T *get(SlotHandle _handle) {
+        uint32_t index = getIndex(_handle);
+        return index == INVALID_INDEX ? nullptr : &denseList[index];
+    }
+    const T *get(SlotHandle _handle) const {
+        uint32_t index = getIndex(_handle);
+        return index == INVALID_INDEX ? nullptr : &denseList[index];
+    }
+
+    //dense access, for systems walking every element
+    T &operator[](size_t _index) { return denseList[_index]; }
+    const T &operator[](size_t _index) const { return denseList[_index]; }
+    size_t size() const { return denseList.size(); }
+    bool empty() const { return denseList.empty(); }
+    typename std::vector<T>::iterator begin() { return denseList.begin(); }
+    typename std::vector<T>::iterator end() { return denseList.end(); }
+    typename std::vector<T>::const_iterator begin() const { return denseList.begin(); }
+    typename std::vector<T>::const_iterator end() const { return denseList.end(); }
+
+private:
+    static constexpr uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    //dense is the element's position while the slot is alive, the next free slot while it is free
+    struct Slot {
+        uint32_t dense = NO_SLOT;
+        uint32_t generation = 0;
+    };
+
+    static SlotHandle makeHandle(uint32_t _slot, uint32_t _generation) { return (_generation << INDEX_BITS) | _slot; }
+
+    std::vector<T> denseList;
+    std::vector<uint32_t> slotOfDenseList;
+    std::vector<Slot> slotsList;
+    uint32_t freeHead = NO_SLOT;
+};
@@ -0,0 +1,482 @@
+#include "SoftwareOcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "CpuFeatures.h"
+#include "../Jobs/ThreadPool.h"
+
+//vertices closer to the camera plane than this are not projected, their triangles are dropped as occluders
+static constexpr float MIN_CLIP_W = 1e-5f;
+static constexpr uint32_t FULL_ROW = 0xFFFFFFFFu;
+//boxes tested per job in cullAsync
+static constexpr uint32_t TEST_CHUNK_SIZE = 256;
+
+std::shared_ptr<OccluderMesh> OccluderMesh::box(const glm::vec3 &_min, const glm::vec3 &_max) {
+    auto mesh = std::make_shared<OccluderMesh>();
+    for (uint32_t i = 0; i < 8; ++i) {
+        mesh->positions.emplace_back((i & 1) ? _max.x : _min.x,
+                                     (i & 2) ? _max.y : _min.y,
+                                     (i & 4) ? _max.z : _min.z);
+    }
+    //winding does not matter, the rasterizer takes both sides
+    mesh->indices = {0, 1, 3, 0, 3, 2,
+                     4, 6, 7, 4, 7, 5,
+                     0, 4, 5, 0, 5, 1,
+                     2, 3, 7, 2, 7, 6,
+                     0, 2, 6, 0, 6, 4,
+                     1, 5, 7, 1, 7, 3};
+    return mesh;
+}
+
+SoftwareOcclusionCuller::SoftwareOcclusionCuller(uint32_t _width, uint32_t _height) : width(_width), height(_height) {
+    if (width == 0 || height == 0 || width % TILE_WIDTH != 0 || height % TILE_HEIGHT != 0)
+        throw std::runtime_error("software occlusion buffer size has to be a multiple of the tile size");
+
+    tilesX = width / TILE_WIDTH;
+    tilesY = height / TILE_HEIGHT;
+    tilesList.resize(tilesX * tilesY);
+    binsList.resize(tilesY);
+    clear();
+}
+
+void SoftwareOcclusionCuller::clear() {
+    for (auto &tile : tilesList) {
+        std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+        tile.zMax0 = 1.0f;
+        tile.zMax1 = 0.0f;
+    }
+}
+
+void SoftwareOcclusionCuller::transformVertices(const std::vector<glm::vec3> &_positions, const glm::mat4 &_matrix) {
+    size_t count = _positions.size();
+    screenX.resize(count);
+    screenY.resize(count);
+    screenZ.resize(count);
+    clipW.resize(count);
+
+    const float halfWidth = 0.5f * static_cast<float>(width);
+    const float halfHeight = 0.5f * static_cast<float>(height);
+
+    size_t i = 0;
+#ifdef CPU_AVX2
+    if (cpuSupportsAvx2())
+        i = transformVerticesAvx2(_positions, _matrix);
+#endif
+    for (; i < count; ++i) {
+        const glm::vec3 &p = _positions[i];
+        float clip[4];
+        for (int row = 0; row < 4; ++row)
+            clip[row] = _matrix[0][row] * p.x + _matrix[1][row] * p.y + _matrix[2][row] * p.z + _matrix[3][row];
+
+        float inverseW = 1.0f / clip[3];
+        screenX[i] = clip[0] * inverseW * halfWidth + halfWidth;
+        screenY[i] = clip[1] * inverseW * halfHeight + halfHeight;
+        screenZ[i] = clip[2] * inverseW;
+        clipW[i] = clip[3];
+    }
+}
+
+#ifdef CPU_AVX2
+CPU_AVX2_TARGET size_t SoftwareOcclusionCuller::transformVerticesAvx2(const std::vector<glm::vec3> &_positions, const glm::mat4 &_matrix) {
+    size_t count = _positions.size();
+    const float halfWidth = 0.5f * static_cast<float>(width);
+    const float halfHeight = 0.5f * static_cast<float>(height);
+
+    size_t i = 0;
+    //eight vertices per iteration, the matrix is broadcast once
+    __m256 m[4][4];
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row)
+            m[column][row] = _mm256_set1_ps(_matrix[column][row]);
+    }
+    const __m256 halfWidthVector = _mm256_set1_ps(halfWidth);
+    const __m256 halfHeightVector = _mm256_set1_ps(halfHeight);
+
+    for (; i + 8 <= count; i += 8) {
+        alignas(32) float xs[8], ys[8], zs[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            xs[lane] = _positions[i + lane].x;
+            ys[lane] = _positions[i + lane].y;
+            zs[lane] = _positions[i + lane].z;
+        }
+        __m256 x = _mm256_load_ps(xs);
+        __m256 y = _mm256_load_ps(ys);
+        __m256 z = _mm256_load_ps(zs);
+
+        __m256 clip[4];
+        for (int row = 0; row < 4; ++row) {
+            clip[row] = _mm256_fmadd_ps(m[0][row], x,
+                        _mm256_fmadd_ps(m[1][row], y,
+                        _mm256_fmadd_ps(m[2][row], z, m[3][row])));
+        }
+
+        __m256 inverseW = _mm256_div_ps(_mm256_set1_ps(1.0f), clip[3]);
+        _mm256_storeu_ps(&screenX[i], _mm256_fmadd_ps(_mm256_mul_ps(clip[0], inverseW), halfWidthVector, halfWidthVector));
+        _mm256_storeu_ps(&screenY[i], _mm256_fmadd_ps(_mm256_mul_ps(clip[1], inverseW), halfHeightVector, halfHeightVector));
+        _mm256_storeu_ps(&screenZ[i], _mm256_mul_ps(clip[2], inverseW));
+        _mm256_storeu_ps(&clipW[i], clip[3]);
+    }
+    return i;
+}
+#endif
+
+void SoftwareOcclusionCuller::setupTriangle(uint32_t _a, uint32_t _b, uint32_t _c) {
+    //a missing occluder only costs culling efficiency, so anything that would need clipping is skipped
+    if (clipW[_a] < MIN_CLIP_W || clipW[_b] < MIN_CLIP_W || clipW[_c] < MIN_CLIP_W)
+        return;
+
+    float x[3] = {screenX[_a], screenX[_b], screenX[_c]};
+    float y[3] = {screenY[_a], screenY[_b], screenY[_c]};
+    float z[3] = {screenZ[_a], screenZ[_b], screenZ[_c]};
+
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(std::fabs(area) > 1e-6f))
+        return;
+    if (area < 0.0f) {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+
+    ScreenTriangle triangle{};
+    triangle.minX = std::min({x[0], x[1], x[2]});
+    triangle.maxX = std::max({x[0], x[1], x[2]});
+    triangle.minY = std::min({y[0], y[1], y[2]});
+    triangle.maxY = std::max({y[0], y[1], y[2]});
+    float zMin = std::min({z[0], z[1], z[2]});
+    triangle.zMax = std::max({z[0], z[1], z[2]});
+
+    if (triangle.maxX <= 0.0f || triangle.minX >= static_cast<float>(width) ||
+        triangle.maxY <= 0.0f || triangle.minY >= static_cast<float>(height))
+        return;
+    if (zMin < 0.0f || zMin > 1.0f)
+        return;
+    triangle.zMax = std::min(triangle.zMax, 1.0f);
+
+    for (int edge = 0; edge < 3; ++edge) {
+        int next = (edge + 1) % 3;
+        triangle.edgeA[edge] = y[edge] - y[next];
+        triangle.edgeB[edge] = x[next] - x[edge];
+        triangle.edgeC[edge] = x[edge] * y[next] - x[next] * y[edge];
+        triangle.edgeSlope[edge] = triangle.edgeA[edge] != 0.0f ? -1.0f / triangle.edgeA[edge] : 0.0f;
+    }
+
+    triangle.zDx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    triangle.zDy = ((x[1] - x[0]) * (z[2] - z[0]) - (x[2] - x[0]) * (z[1] - z[0])) / area;
+    triangle.zOrigin = z[0] - triangle.zDx * x[0] - triangle.zDy * y[0];
+
+    auto pixelMinX = static_cast<uint32_t>(std::max(triangle.minX, 0.0f));
+    auto pixelMaxX = static_cast<uint32_t>(std::min(triangle.maxX, static_cast<float>(width - 1)));
+    auto pixelMinY = static_cast<uint32_t>(std::max(triangle.minY, 0.0f));
+    auto pixelMaxY = static_cast<uint32_t>(std::min(triangle.maxY, static_cast<float>(height - 1)));
+    triangle.tileMinX = pixelMinX / TILE_WIDTH;
+    triangle.tileMaxX = pixelMaxX / TILE_WIDTH;
+    triangle.tileMinY = pixelMinY / TILE_HEIGHT;
+    triangle.tileMaxY = pixelMaxY / TILE_HEIGHT;
+
+    auto index = static_cast<uint32_t>(trianglesList.size());
+    trianglesList.push_back(triangle);
+    for (uint32_t tileY = triangle.tileMinY; tileY <= triangle.tileMaxY; ++tileY)
+        binsList[tileY].push_back(index);
+    stats.rasterizedTriangles++;
+}
+
+void SoftwareOcclusionCuller::binOccluders(const std::vector<OccluderInstance> &_occluders) {
+    trianglesList.clear();
+    for (auto &bin : binsList)
+        bin.clear();
+    stats.occluderTriangles = 0;
+    stats.rasterizedTriangles = 0;
+
+    for (const auto &occluder : _occluders) {
+        const auto &mesh = *occluder.mesh;
+        transformVertices(mesh.positions, projectionView * occluder.modelMatrix);
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+            setupTriangle(mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]);
+        stats.occluderTriangles += static_cast<uint32_t>(mesh.indices.size() / 3);
+    }
+}
+
+void SoftwareOcclusionCuller::rasterizeBin(uint32_t _bin) {
+    //a bin is one row of tiles, no other job touches them
+    for (uint32_t index : binsList[_bin]) {
+        const auto &triangle = trianglesList[index];
+        for (uint32_t tileX = triangle.tileMinX; tileX <= triangle.tileMaxX; ++tileX)
+            rasterizeTriangleInTile(triangle, tileX, _bin);
+    }
+}
+
+void SoftwareOcclusionCuller::rasterizeTriangleInTile(const ScreenTriangle &_triangle, uint32_t _tileX, uint32_t _tileY) {
+    Tile &tile = tilesList[_tileY * tilesX + _tileX];
+    const float tileLeft = static_cast<float>(_tileX * TILE_WIDTH);
+    const float tileTop = static_cast<float>(_tileY * TILE_HEIGHT);
+
+    //the plane is linear, so its farthest point over the part of the bounding box inside the tile is a corner
+    float left = std::max(tileLeft, _triangle.minX);
+    float right = std::min(tileLeft + TILE_WIDTH, _triangle.maxX);
+    float top = std::max(tileTop, _triangle.minY);
+    float bottom = std::min(tileTop + TILE_HEIGHT, _triangle.maxY);
+    float depth = std::max({_triangle.zOrigin + _triangle.zDx * left + _triangle.zDy * top,
+                            _triangle.zOrigin + _triangle.zDx * right + _triangle.zDy * top,
+                            _triangle.zOrigin + _triangle.zDx * left + _triangle.zDy * bottom,
+                            _triangle.zOrigin + _triangle.zDx * right + _triangle.zDy * bottom});
+    depth = std::min(depth, _triangle.zMax);
+
+    //everything in the tile is already nearer
+    if (depth >= tile.zMax0)
+        return;
+
+    alignas(32) uint32_t coverage[TILE_HEIGHT];
+#ifdef CPU_AVX2
+    bool covered = cpuSupportsAvx2() ? coverTileAvx2(_triangle, tileLeft, tileTop, coverage)
+                                     : coverTile(_triangle, tileLeft, tileTop, coverage);
+#else
+    bool covered = coverTile(_triangle, tileLeft, tileTop, coverage);
+#endif
+    if (!covered)
+        return;
+
+    updateTile(tile, coverage, depth);
+}
+
+bool SoftwareOcclusionCuller::coverTile(const ScreenTriangle &_triangle, float _tileLeft, float _tileTop,
+                                        uint32_t _coverage[TILE_HEIGHT]) {
+    uint32_t anyCoverage = 0;
+    for (uint32_t row = 0; row < TILE_HEIGHT; ++row) {
+        float rowCenter = _tileTop + static_cast<float>(row) + 0.5f;
+        uint32_t rowMask = FULL_ROW;
+        for (int edge = 0; edge < 3; ++edge) {
+            const float a = _triangle.edgeA[edge];
+            float rowValue = _triangle.edgeB[edge] * rowCenter + _triangle.edgeC[edge];
+            if (a == 0.0f) {
+                if (rowValue < 0.0f)
+                    rowMask = 0;
+                continue;
+            }
+
+            float crossing = rowValue * _triangle.edgeSlope[edge] - (_tileLeft + 0.5f);
+            if (a > 0.0f) {
+                auto first = static_cast<int>(std::min(std::max(std::ceil(crossing), 0.0f), 32.0f));
+                rowMask &= first >= 32 ? 0u : FULL_ROW << first;
+            } else {
+                auto last = static_cast<int>(std::min(std::max(std::floor(crossing), -1.0f), 31.0f));
+                rowMask &= last < 0 ? 0u : FULL_ROW >> (31 - last);
+            }
+        }
+        _coverage[row] = rowMask;
+        anyCoverage |= rowMask;
+    }
+    return anyCoverage != 0;
+}
+
+#ifdef CPU_AVX2
+CPU_AVX2_TARGET bool SoftwareOcclusionCuller::coverTileAvx2(const ScreenTriangle &_triangle, float _tileLeft, float _tileTop,
+                                                            uint32_t _coverage[TILE_HEIGHT]) {
+    //one lane per tile row: an edge covers a run of pixels starting or ending where it crosses the row,
+    //which turns into a shifted full row mask
+    const __m256 rowCenters = _mm256_add_ps(_mm256_set1_ps(_tileTop + 0.5f), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i fullRows = _mm256_set1_epi32(-1);
+    __m256i rows = fullRows;
+
+    for (int edge = 0; edge < 3; ++edge) {
+        const float a = _triangle.edgeA[edge];
+        __m256 rowValue = _mm256_fmadd_ps(_mm256_set1_ps(_triangle.edgeB[edge]), rowCenters, _mm256_set1_ps(_triangle.edgeC[edge]));
+
+        if (a == 0.0f) {
+            __m256 inside = _mm256_cmp_ps(rowValue, _mm256_setzero_ps(), _CMP_GE_OQ);
+            rows = _mm256_and_si256(rows, _mm256_castps_si256(inside));
+            continue;
+        }
+
+        //pixel x is inside when a * (x + 0.5) + rowValue >= 0
+        __m256 crossing = _mm256_fmsub_ps(rowValue, _mm256_set1_ps(_triangle.edgeSlope[edge]), _mm256_set1_ps(_tileLeft + 0.5f));
+        if (a > 0.0f) {
+            __m256 first = _mm256_min_ps(_mm256_max_ps(_mm256_ceil_ps(crossing), _mm256_setzero_ps()), _mm256_set1_ps(32.0f));
+            rows = _mm256_and_si256(rows, _mm256_sllv_epi32(fullRows, _mm256_cvttps_epi32(first)));
+        } else {
+            __m256 last = _mm256_min_ps(_mm256_max_ps(_mm256_floor_ps(crossing), _mm256_set1_ps(-1.0f)), _mm256_set1_ps(31.0f));
+            __m256i shift = _mm256_sub_epi32(_mm256_set1_epi32(31), _mm256_cvttps_epi32(last));
+            rows = _mm256_and_si256(rows, _mm256_srlv_epi32(fullRows, shift));
+        }
+    }
+
+    _mm256_store_si256(reinterpret_cast<__m256i *>(_coverage), rows);
+    return !_mm256_testz_si256(rows, rows);
+}
+#endif
+
+void SoftwareOcclusionCuller::updateTile(Tile &_tile, const uint32_t _coverage[TILE_HEIGHT], float _depth) {
+    bool hasWorkingLayer = false;
+    for (uint32_t row = 0; row < TILE_HEIGHT; ++row)
+        hasWorkingLayer |= _tile.mask[row] != 0;
+
+    //merging a triangle much farther than the working layer would push that layer back for little coverage,
+    //dropping the layer instead only forgets coverage, so both choices stay conservative
+    if (hasWorkingLayer && std::fabs(_depth - _tile.zMax1) > _tile.zMax0 - _depth) {
+        std::fill(std::begin(_tile.mask), std::end(_tile.mask), 0u);
+        hasWorkingLayer = false;
+    }
+
+    bool full = true;
+    for (uint32_t row = 0; row < TILE_HEIGHT; ++row) {
+        _tile.mask[row] |= _coverage[row];
+        full &= _tile.mask[row] == FULL_ROW;
+    }
+    _tile.zMax1 = hasWorkingLayer ? std::max(_tile.zMax1, _depth) : _depth;
+
+    //every pixel is covered, the working layer becomes the depth of the whole tile
+    if (full) {
+        _tile.zMax0 = _tile.zMax1;
+        _tile.zMax1 = 0.0f;
+        std::fill(std::begin(_tile.mask), std::end(_tile.mask), 0u);
+    }
+}
+
+void SoftwareOcclusionCuller::renderOccluders(const glm::mat4 &_projectionView, const std::vector<OccluderInstance> &_occluders,
+                                              ThreadPool *workers) {
+    projectionView = _projectionView;
+    clear();
+    binOccluders(_occluders);
+
+    if (workers != nullptr) {
+        workers->parallelFor(tilesY, [this](uint32_t begin, uint32_t end) {
+            for (uint32_t bin = begin; bin < end; ++bin)
+                rasterizeBin(bin);
+        });
+    } else {
+        for (uint32_t bin = 0; bin < tilesY; ++bin)
+            rasterizeBin(bin);
+    }
+}
+
+bool SoftwareOcclusionCuller::isVisible(const glm::vec3 &_min, const glm::vec3 &_max) const {
+    float minX = static_cast<float>(width), maxX = 0.0f;
+    float minY = static_cast<float>(height), maxY = 0.0f;
+    float nearestDepth = 1.0f;
+
+    for (uint32_t i = 0; i < 8; ++i) {
+        float corner[3] = {(i & 1) ? _max.x : _min.x, (i & 2) ? _max.y : _min.y, (i & 4) ? _max.z : _min.z};
+        float clip[4];
+        for (int row = 0; row < 4; ++row) {
+            clip[row] = projectionView[0][row] * corner[0] + projectionView[1][row] * corner[1] +
+                        projectionView[2][row] * corner[2] + projectionView[3][row];
+        }
+        //reaches behind the camera, the projected box means nothing
+        if (clip[3] < MIN_CLIP_W)
+            return true;
+
+        float inverseW = 1.0f / clip[3];
+        float x = (clip[0] * inverseW * 0.5f + 0.5f) * static_cast<float>(width);
+        float y = (clip[1] * inverseW * 0.5f + 0.5f) * static_cast<float>(height);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearestDepth = std::min(nearestDepth, clip[2] * inverseW);
+    }
+    if (nearestDepth <= 0.0f)
+        return true;
+
+    //every pixel the box touches, even partly
+    auto left = static_cast<int32_t>(std::max(std::floor(minX), 0.0f));
+    auto right = static_cast<int32_t>(std::min(std::ceil(maxX), static_cast<float>(width)));
+    auto top = static_cast<int32_t>(std::max(std::floor(minY), 0.0f));
+    auto bottom = static_cast<int32_t>(std::min(std::ceil(maxY), static_cast<float>(height)));
+    if (left >= right || top >= bottom)
+        return false;
+
+    for (int32_t tileY = top / static_cast<int32_t>(TILE_HEIGHT); tileY <= (bottom - 1) / static_cast<int32_t>(TILE_HEIGHT); ++tileY) {
+        for (int32_t tileX = left / static_cast<int32_t>(TILE_WIDTH); tileX <= (right - 1) / static_cast<int32_t>(TILE_WIDTH); ++tileX) {
+            const Tile &tile = tilesList[tileY * tilesX + tileX];
+            if (nearestDepth > tile.zMax0)
+                continue;
+            if (nearestDepth <= tile.zMax1)
+                return true;
+
+            //only behind the covered pixels, visible if it reaches any other one
+            int32_t firstColumn = std::max(left - tileX * static_cast<int32_t>(TILE_WIDTH), 0);
+            int32_t endColumn = std::min(right - tileX * static_cast<int32_t>(TILE_WIDTH), static_cast<int32_t>(TILE_WIDTH));
+            uint32_t columns = (endColumn == 32 ? FULL_ROW : (1u << endColumn) - 1u) & (FULL_ROW << firstColumn);
+            for (int32_t row = 0; row < static_cast<int32_t>(TILE_HEIGHT); ++row) {
+                int32_t pixelY = tileY * static_cast<int32_t>(TILE_HEIGHT) + row;
+                if (pixelY >= top && pixelY < bottom && (columns & ~tile.mask[row]) != 0)
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+void SoftwareOcclusionCuller::cullAsync(ThreadPool &workers, const glm::mat4 &_projectionView,
+                                        std::vector<OccluderInstance> _occluders, std::vector<OcclusionBounds> _bounds) {
+    waitForResults();
+
+    projectionView = _projectionView;
+    asyncOccluders = std::move(_occluders);
+    asyncBounds = std::move(_bounds);
+    visibilityList.assign(asyncBounds.size(), 1);
+    occludedCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        resultsPending = true;
+    }
+
+    //binning is serial, the tile rows and the box tests fan out, the last job of each step starts the next one
+    workers.submit([this, &workers] {
+        clear();
+        binOccluders(asyncOccluders);
+
+        remainingJobs = tilesY;
+        for (uint32_t bin = 0; bin < tilesY; ++bin) {
+            workers.submit([this, &workers, bin] {
+                rasterizeBin(bin);
+                if (remainingJobs.fetch_sub(1) == 1)
+                    testBoundsAsync(workers);
+            });
+        }
+    });
+}
+
+void SoftwareOcclusionCuller::testBoundsAsync(ThreadPool &workers) {
+    auto count = static_cast<uint32_t>(asyncBounds.size());
+    uint32_t chunks = (count + TEST_CHUNK_SIZE - 1) / TEST_CHUNK_SIZE;
+    if (chunks == 0) {
+        finishAsync();
+        return;
+    }
+
+    remainingJobs = chunks;
+    for (uint32_t begin = 0; begin < count; begin += TEST_CHUNK_SIZE) {
+        uint32_t end = std::min(begin + TEST_CHUNK_SIZE, count);
+        workers.submit([this, begin, end] {
+            uint32_t occluded = 0;
+            for (uint32_t i = begin; i < end; ++i) {
+                bool visible = isVisible(asyncBounds[i].min, asyncBounds[i].max);
+                visibilityList[i] = visible ? 1 : 0;
+                occluded += visible ? 0 : 1;
+            }
+            occludedCount += occluded;
+            if (remainingJobs.fetch_sub(1) == 1)
+                finishAsync();
+        });
+    }
+}
+
+void SoftwareOcclusionCuller::finishAsync() {
+    stats.testedObjects = static_cast<uint32_t>(asyncBounds.size());
+    stats.occludedObjects = occludedCount;
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        resultsPending = false;
+    }
+    resultReady.notify_all();
+}
+
+const std::vector<uint8_t> &SoftwareOcclusionCuller::waitForResults() {
+    std::unique_lock<std::mutex> lock(resultMutex);
+    resultReady.wait(lock, [this] { return !resultsPending; });
+    return visibilityList;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_TO_ZERO
+#include <glm/vec3.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ThreadPool;
+
+//occluder geometry kept on the cpu, should be a few hundred triangles that lie inside the real mesh
+struct OccluderMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+
+    //only conservative for meshes that are solid boxes themselves, walls, floors, buildings
+    static std::shared_ptr<OccluderMesh> box(const glm::vec3 &_min, const glm::vec3 &_max);
+};
+
+struct OccluderInstance {
+    std::shared_ptr<const OccluderMesh> mesh;
+    glm::mat4 modelMatrix{1.0f};
+};
+
+//world space box of an object that gets tested
+struct OcclusionBounds {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+};
+
+struct SoftwareOcclusionStats {
+    uint32_t occluderTriangles = 0;
+    uint32_t rasterizedTriangles = 0;
+    uint32_t testedObjects = 0;
+    uint32_t occludedObjects = 0;
+};
+
+//masked software occlusion culling: occluders are rasterized into a small hierarchical depth buffer of 32x8 pixel
+//tiles. a tile keeps one coverage bit per pixel and two depths, the farthest depth of the whole tile and the
+//farthest depth of the pixels covered so far, so no per pixel depth is stored. depth is [0, 1], 0 is near
+class SoftwareOcclusionCuller {
+public:
+    static constexpr uint32_t TILE_WIDTH = 32;
+    static constexpr uint32_t TILE_HEIGHT = 8;
+
+    //width has to be a multiple of TILE_WIDTH, height of TILE_HEIGHT
+    explicit SoftwareOcclusionCuller(uint32_t _width = 256, uint32_t _height = 128);
+
+    SoftwareOcclusionCuller(const SoftwareOcclusionCuller &) = delete;
+    SoftwareOcclusionCuller &operator=(const SoftwareOcclusionCuller &) = delete;
+
+    //clears the buffer, transforms and bins the occluders, then rasterizes one tile row per job.
+    //without workers everything runs on the calling thread. do not call from a job of the same pool
+    void renderOccluders(const glm::mat4 &_projectionView, const std::vector<OccluderInstance> &_occluders, ThreadPool *workers = nullptr);
+    //false only when the box is hidden behind the occluders or entirely off screen
+    bool isVisible(const glm::vec3 &_min, const glm::vec3 &_max) const;
+
+    //runs renderOccluders and the tests of every box as a chain of jobs and returns right away,
+    //the calling thread is free for other frame work until waitForResults
+    void cullAsync(ThreadPool &workers, const glm::mat4 &_projectionView,
+                   std::vector<OccluderInstance> _occluders, std::vector<OcclusionBounds> _bounds);
+    //one entry per box of the last cullAsync, 1 when it has to be drawn
+    const std::vector<uint8_t> &waitForResults();
+
+    const SoftwareOcclusionStats &getStats() const { return stats; }
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+
+private:
+    struct alignas(32) Tile {
+        //bit x of row y is pixel (x, y) of the tile, set when the working layer covers it
+        uint32_t mask[TILE_HEIGHT];
+        //farthest depth anywhere in the tile
+        float zMax0;
+        //farthest depth of the covered pixels, always nearer than zMax0
+        float zMax1;
+    };
+
+    //edges as a * x + b * y + c >= 0 inside, depth as a plane over the screen
+    struct ScreenTriangle {
+        float edgeA[3], edgeB[3], edgeC[3];
+        //-1 / a, turns a row's b * y + c into the x where the edge crosses it
+        float edgeSlope[3];
+        float zDx, zDy, zOrigin;
+        float zMax;
+        float minX, maxX, minY, maxY;
+        uint32_t tileMinX, tileMaxX, tileMinY, tileMaxY;
+    };
+
+    void clear();
+    void binOccluders(const std::vector<OccluderInstance> &_occluders);
+    void transformVertices(const std::vector<glm::vec3> &_positions, const glm::mat4 &_matrix);
+    //eight vertices at a time, returns how many it did, the scalar loop takes the rest. only with avx2
+    size_t transformVerticesAvx2(const std::vector<glm::vec3> &_positions, const glm::mat4 &_matrix);
+    void setupTriangle(uint32_t _a, uint32_t _b, uint32_t _c);
+    void rasterizeBin(uint32_t _bin);
+    void rasterizeTriangleInTile(const ScreenTriangle &_triangle, uint32_t _tileX, uint32_t _tileY);
+    //pixels of the tile inside the triangle, one mask per row. false when there are none
+    static bool coverTile(const ScreenTriangle &_triangle, float _tileLeft, float _tileTop, uint32_t _coverage[TILE_HEIGHT]);
+    //the same with one lane per row, only with avx2. _coverage is 32 byte aligned
+    static bool coverTileAvx2(const ScreenTriangle &_triangle, float _tileLeft, float _tileTop, uint32_t _coverage[TILE_HEIGHT]);
+    void updateTile(Tile &_tile, const uint32_t _coverage[TILE_HEIGHT], float _depth);
+    void testBoundsAsync(ThreadPool &workers);
+    void finishAsync();
+
+    uint32_t width;
+    uint32_t height;
+    uint32_t tilesX;
+    uint32_t tilesY;
+    std::vector<Tile> tilesList;
+
+    glm::mat4 projectionView{1.0f};
+
+    //screen space vertices of the occluder being binned, x and y in pixels
+    std::vector<float> screenX, screenY, screenZ, clipW;
+    std::vector<ScreenTriangle> trianglesList;
+    //triangle indices per tile row
+    std::vector<std::vector<uint32_t>> binsList;
+
+    SoftwareOcclusionStats stats{};
+
+    std::vector<OccluderInstance> asyncOccluders;
+    std::vector<OcclusionBounds> asyncBounds;
+    std::vector<uint8_t> visibilityList;
+    std::atomic<uint32_t> remainingJobs{0};
+    std::atomic<uint32_t> occludedCount{0};
+    std::mutex resultMutex;
+    std::condition_variable resultReady;
+    bool resultsPending = false;
+};
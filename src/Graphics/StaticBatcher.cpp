@@ -0,0 +1,183 @@
+#include "StaticBatcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "AssetManager.h"
+#include "../IO/ContentHash.h"
+#include "../Jobs/ThreadPool.h"
+
+//texture and grid cell, objects only merge when both match
+using BatchKey = std::tuple<uintptr_t, int, int, int>;
+
+struct SourceGeometry {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+struct BatchInput {
+    Builder builder;
+    std::shared_ptr<ImageBuffer> texture;
+    std::shared_ptr<OccluderMesh> occluder;
+    std::vector<size_t> objectsList;
+    //of the merged vertices and indices, the processed batch is found in the mesh cache under it
+    uint64_t contentHash = 0;
+};
+
+//bakes the transform into a copy of the mesh and its occluder
+static void appendObject(BatchInput &_batch, size_t _objectIndex, Object &_object, const SourceGeometry &_source) {
+    glm::mat4 modelMatrix = _object.transform.getTransformationMatrixFAST();
+    glm::mat3 normalMatrix = _object.transform.getNormalMatrix();
+    //a mirroring transform turns the triangles inside out once it is baked in
+    bool mirrored = glm::determinant(glm::mat3(modelMatrix)) < 0.0f;
+
+    auto &vertices = _batch.builder.vertices;
+    auto &indices = _batch.builder.indices;
+    uint32_t baseVertex = static_cast<uint32_t>(vertices.size());
+    for (Vertex vertex : _source.vertices) {
+        vertex.position = glm::vec3(modelMatrix * glm::vec4(vertex.position, 1.0f));
+        glm::vec3 normal = normalMatrix * vertex.normal;
+        float length = glm::length(normal);
+        vertex.normal = length > 0.0f ? normal / length : normal;
+        vertices.push_back(vertex);
+    }
+    for (size_t i = 0; i + 2 < _source.indices.size(); i += 3) {
+        uint32_t a = _source.indices[i], b = _source.indices[i + 1], c = _source.indices[i + 2];
+        if (mirrored)
+            std::swap(b, c);
+        indices.insert(indices.end(), {baseVertex + a, baseVertex + b, baseVertex + c});
+    }
+
+    if (_object.occluder) {
+        if (!_batch.occluder)
+            _batch.occluder = std::make_shared<OccluderMesh>();
+        auto &occluder = *_batch.occluder;
+        uint32_t baseOccluderVertex = static_cast<uint32_t>(occluder.positions.size());
+        for (const auto &position : _object.occluder->positions)
+            occluder.positions.push_back(glm::vec3(modelMatrix * glm::vec4(position, 1.0f)));
+        const auto &occluderIndices = _object.occluder->indices;
+        for (size_t i = 0; i + 2 < occluderIndices.size(); i += 3) {
+            uint32_t a = occluderIndices[i], b = occluderIndices[i + 1], c = occluderIndices[i + 2];
+            if (mirrored)
+                std::swap(b, c);
+            occluder.indices.insert(occluder.indices.end(), {baseOccluderVertex + a, baseOccluderVertex + b, baseOccluderVertex + c});
+        }
+    }
+    _batch.objectsList.push_back(_objectIndex);
+}
+
+StaticBatchStats StaticBatcher::build(AssetManager &_assets, ThreadPool &_workers, SlotMap<Object> &_objects, float _cellSize) {
+    StaticBatchStats stats{};
+
+    std::vector<bool> hasChildrenList(_objects.size(), false);
+    for (const auto &obj : _objects) {
+        uint32_t parent = _objects.getIndex(obj.parent);
+        if (parent != SlotMap<Object>::INVALID_INDEX)
+            hasChildrenList[parent] = true;
+    }
+
+    //ordered, so the batches come out the same on every run
+    std::map<BatchKey, std::vector<size_t>> groupsList;
+    for (size_t i = 0; i < _objects.size(); ++i) {
+        auto &obj = _objects[i];
+        if (!obj.isStatic || !obj.mesh || _objects.contains(obj.parent) || hasChildrenList[i])
+            continue;
+
+        glm::mat4 modelMatrix = obj.transform.getTransformationMatrixFAST();
+        float scale = std::max({glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])),
+                                glm::length(glm::vec3(modelMatrix[2]))});
+        const glm::vec4 &sphere = obj.mesh->getBoundingSphere();
+        if (sphere.w * scale > _cellSize)
+            continue;
+
+        glm::vec3 cell = glm::floor(glm::vec3(modelMatrix * glm::vec4(glm::vec3(sphere), 1.0f)) / _cellSize);
+        BatchKey key{reinterpret_cast<uintptr_t>(obj.mesh->getSharedTexture().get()),
+                     static_cast<int>(cell.x), static_cast<int>(cell.y), static_cast<int>(cell.z)};
+        groupsList[key].push_back(i);
+    }
+
+    //every mesh is read back once, however many objects use it
+    std::unordered_map<const Model *, SourceGeometry> sourcesList;
+    std::vector<BatchInput> batchInputsList;
+    BatchInput batch{};
+    auto finishBatch = [&]() {
+        //a single object gains nothing from being imported again
+        if (batch.objectsList.size() > 1)
+            batchInputsList.push_back(std::move(batch));
+        batch = BatchInput{};
+    };
+
+    for (auto &group : groupsList) {
+        if (group.second.size() < 2)
+            continue;
+
+        std::shared_ptr<ImageBuffer> texture = _objects[group.second[0]].mesh->getSharedTexture();
+        batch.texture = texture;
+        for (size_t objectIndex : group.second) {
+            auto &obj = _objects[objectIndex];
+            auto source = sourcesList.find(obj.mesh.get());
+            if (source == sourcesList.end()) {
+                source = sourcesList.emplace(obj.mesh.get(), SourceGeometry{}).first;
+                obj.mesh->readGeometry(source->second.vertices, source->second.indices);
+            }
+
+            if (!batch.objectsList.empty() && batch.builder.vertices.size() + source->second.vertices.size() > MAX_BATCH_VERTICES) {
+                finishBatch();
+                batch.texture = texture;
+            }
+            appendObject(batch, objectIndex, obj, source->second);
+        }
+        finishBatch();
+    }
+
+    //the imports are independent, and the expensive part when the mesh cache misses
+    _workers.parallelFor(static_cast<uint32_t>(batchInputsList.size()), [&](uint32_t _begin, uint32_t _end) {
+        for (uint32_t i = _begin; i < _end; ++i) {
+            auto &builder = batchInputsList[i].builder;
+            uint64_t verticesHash = ContentHash::hash64(builder.vertices.data(), builder.vertices.size() * sizeof(Vertex));
+            batchInputsList[i].contentHash = ContentHash::hash64(builder.indices.data(), builder.indices.size() * sizeof(uint32_t),
+                                                                 verticesHash);
+            builder.importMesh(batchInputsList[i].contentHash);
+        }
+    });
+
+    std::vector<bool> mergedList(_objects.size(), false);
+    std::vector<Object> batchesList;
+    for (auto &input : batchInputsList) {
+        auto &builder = input.builder;
+        Object batchObject{};
+        batchObject.mesh = _assets.addModel("static batch " + std::to_string(stats.batches), builder, input.texture, input.contentHash);
+        batchObject.occluder = std::move(input.occluder);
+        batchObject.isStatic = true;
+        batchesList.push_back(std::move(batchObject));
+
+        for (size_t objectIndex : input.objectsList)
+            mergedList[objectIndex] = true;
+        stats.objects += static_cast<uint32_t>(input.objectsList.size());
+        stats.batches++;
+        stats.triangles += static_cast<uint32_t>(builder.lods.empty() ? builder.indices.size() / 3 : builder.lods[0].indexCount / 3);
+    }
+
+    if (stats.batches == 0)
+        return stats;
+
+    //erasing moves other objects, the handles are taken before the first one goes
+    std::vector<SlotHandle> mergedHandlesList;
+    for (size_t i = 0; i < _objects.size(); ++i) {
+        if (mergedList[i])
+            mergedHandlesList.push_back(_objects.getHandle(static_cast<uint32_t>(i)));
+    }
+    for (SlotHandle handle : mergedHandlesList)
+        _objects.erase(handle);
+    for (auto &batch : batchesList)
+        _objects.insert(std::move(batch));
+    return stats;
+}
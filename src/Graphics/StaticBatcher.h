@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Object.h"
+
+class AssetManager;
+class ThreadPool;
+
+struct StaticBatchStats {
+    //static objects that were merged, and the batches that replaced them
+    uint32_t objects = 0;
+    uint32_t batches = 0;
+    uint32_t triangles = 0;
+};
+
+//merges objects that never move into a few large meshes at scene build time. static objects with the same texture
+//are grouped by the cell of a uniform grid their bounding sphere center falls in, pre-transformed into world space and
+//imported again like a loaded file, so every batch gets its own lods, meshlets and bounds and is still culled on its own
+class StaticBatcher {
+public:
+    static constexpr float DEFAULT_CELL_SIZE = 8.0f;
+    //keeps every batch on 16 bit indices
+    static constexpr uint32_t MAX_BATCH_VERTICES = 65536;
+
+    //replaces the static objects of _objects that have a neighbour to merge with by batch objects with an identity
+    //transform, occluders are merged along. reads the meshes back from the pool and waits for the gpu doing so, so call
+    //it once while building the scene, after every static object finished loading and before the first frame. the
+    //batches are imported on _workers, through the mesh cache, and registered with _assets. objects larger than a
+    //cell stay on their own, they would only blow up the batch bounds, and so do objects in a hierarchy. the handles
+    //of the objects left stay valid
+    static StaticBatchStats build(AssetManager &_assets, ThreadPool &_workers, SlotMap<Object> &_objects,
+                                  float _cellSize = DEFAULT_CELL_SIZE);
+};
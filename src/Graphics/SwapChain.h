@@ -17,6 +17,9 @@ public:
 
     VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
     VkRenderPass getRenderPass() { return renderPass; }
+    //compatible with getRenderPass, loads what the scene pass stored and leaves the image ready to present
+    VkRenderPass getOverlayRenderPass() { return overlayRenderPass; }
+    VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
     size_t imageCount() { return swapChainImages.size(); }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
@@ -43,6 +46,7 @@ private:
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
+    void createOverlayRenderPass();
     void createFramebuffers();
     void createSyncObjects();
 
@@ -59,6 +63,7 @@ private:
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkRenderPass renderPass;
+    VkRenderPass overlayRenderPass;
 
     std::vector<VkImage> depthImages;
     std::vector<VkDeviceMemory> depthImageMemorys;
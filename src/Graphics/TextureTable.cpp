@@ -0,0 +1,132 @@
+#include "TextureTable.h"
+
+#include <algorithm>
+
+#include "ImageBuffer.h"
+#include "Model.h"
+
+static bool sameImage(const VkDescriptorImageInfo &_a, const VkDescriptorImageInfo &_b) {
+    return _a.sampler == _b.sampler && _a.imageView == _b.imageView && _a.imageLayout == _b.imageLayout;
+}
+
+TextureTable::TextureTable(Device &_device) {
+    const auto &features = _device.getFeatures();
+    bindless = features.descriptorIndexing && features.maxBindlessTextures > 1;
+    if (bindless) {
+        capacity = std::min(BINDLESS_CAPACITY, features.maxBindlessTextures);
+    } else if (features.sampledImageArrayDynamicIndexing) {
+        const auto &limits = _device.properties.limits;
+        capacity = std::min({FALLBACK_CAPACITY, limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages});
+    }
+    //without any indexing the array is the default texture alone
+
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(uint32_t);
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(uint32_t);
+    specializationInfo.pData = &capacity;
+
+    uint32_t whitePixel = 0xffffffff;
+    ImageBuilder image{};
+    image.pixels = &whitePixel;
+    image.width = 1;
+    image.height = 1;
+    image.channels_size = 4;
+    image.initialized = true;
+    defaultTexture = Model::createTexture(_device, image);
+
+    texturesList.resize(capacity);
+    //partially bound slots may stay empty until they are used, the bounded array has to be valid everywhere
+    imageInfosList.resize(capacity, VkDescriptorImageInfo{});
+    for (uint32_t slot = 0; slot < (bindless ? 1 : capacity); ++slot)
+        clearSlot(slot);
+}
+
+TextureTable::~TextureTable() = default;
+
+VkDescriptorBindingFlags TextureTable::getBindingFlags() const {
+    if (!bindless)
+        return 0;
+    return VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+}
+
+uint32_t TextureTable::acquire(const std::shared_ptr<ImageBuffer> &_texture) {
+    if (!_texture)
+        return DEFAULT_TEXTURE;
+    auto it = slotOfTextureList.find(_texture.get());
+    if (it != slotOfTextureList.end())
+        return it->second;
+
+    uint32_t slot;
+    if (!freeSlotsList.empty()) {
+        slot = freeSlotsList.back();
+        freeSlotsList.pop_back();
+    } else if (nextSlot < capacity) {
+        slot = nextSlot++;
+    } else {
+        return DEFAULT_TEXTURE;
+    }
+    texturesList[slot] = _texture;
+    imageInfosList[slot] = _texture->descriptorInfo();
+    slotOfTextureList.emplace(_texture.get(), slot);
+    version++;
+    return slot;
+}
+
+uint32_t TextureTable::getIndex(const ImageBuffer *_texture) const {
+    auto it = slotOfTextureList.find(_texture);
+    return it != slotOfTextureList.end() ? it->second : DEFAULT_TEXTURE;
+}
+
+void TextureTable::releaseUnused() {
+    for (auto it = slotOfTextureList.begin(); it != slotOfTextureList.end();) {
+        if (!texturesList[it->second].expired()) {
+            ++it;
+            continue;
+        }
+        //the image is destroyed once no frame in flight can use it, the slot stops pointing at it before that
+        clearSlot(it->second);
+        freeSlotsList.push_back(it->second);
+        it = slotOfTextureList.erase(it);
+        version++;
+    }
+}
+
+bool TextureTable::writeDescriptors(int _frameIndex, lve::LveDescriptorSetLayout &_layout, lve::LveDescriptorPool &_pool,
+                                    VkDescriptorSet &_set, uint32_t _binding) {
+    auto &frame = frameSlotsList[_frameIndex];
+    if (frame.version == version)
+        return false;
+    frame.writtenList.resize(capacity, VkDescriptorImageInfo{});
+
+    //runs of changed slots are written in one go
+    lve::LveDescriptorWriter writer{_layout, _pool};
+    bool written = false;
+    uint32_t runBegin = 0;
+    uint32_t runLength = 0;
+    for (uint32_t slot = 0; slot <= capacity; ++slot) {
+        bool changed = slot < capacity && !sameImage(imageInfosList[slot], frame.writtenList[slot]);
+        if (changed) {
+            if (runLength == 0)
+                runBegin = slot;
+            runLength++;
+        } else if (runLength > 0) {
+            writer.writeImages(_binding, runBegin, runLength, &imageInfosList[runBegin]);
+            written = true;
+            runLength = 0;
+        }
+    }
+    if (written)
+        writer.overwrite(_set);
+
+    frame.writtenList = imageInfosList;
+    frame.version = version;
+    return written;
+}
+
+void TextureTable::clearSlot(uint32_t _slot) {
+    texturesList[_slot].reset();
+    imageInfosList[_slot] = defaultTexture->descriptorInfo();
+}
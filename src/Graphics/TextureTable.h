@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Descriptors.h"
+#include "SwapChain.h"
+
+class ImageBuffer;
+
+//every texture the shading passes sample, one COMBINED_IMAGE_SAMPLER array in the global set. objects reach theirs
+//through the texture index of their instance, so the whole scene is drawn with a single bind of that set.
+//with descriptor indexing the array is large, partially bound and written after being bound, so new textures never
+//invalidate recorded command buffers. without it the array is bounded by the per stage sampler limits and every
+//element always holds a texture. slot 0 is white: models without a texture, free slots and textures that did not
+//fit all sample it
+class TextureTable {
+public:
+    static constexpr uint32_t BINDLESS_CAPACITY = 4096;
+    static constexpr uint32_t FALLBACK_CAPACITY = 64;
+    static constexpr uint32_t DEFAULT_TEXTURE = 0;
+
+    explicit TextureTable(Device &_device);
+    ~TextureTable();
+
+    TextureTable(const TextureTable &) = delete;
+    TextureTable &operator=(const TextureTable &) = delete;
+
+    bool isBindless() const { return bindless; }
+    //elements of the array binding
+    uint32_t getCapacity() const { return capacity; }
+    VkDescriptorBindingFlags getBindingFlags() const;
+    //TEXTURE_COUNT of the fragment shaders, constant 0
+    const VkSpecializationInfo *getSpecializationInfo() const { return &specializationInfo; }
+
+    //slot of the texture, a free one is taken the first time it is seen. the table only keeps a weak reference
+    uint32_t acquire(const std::shared_ptr<ImageBuffer> &_texture);
+    //slot of an acquired texture, DEFAULT_TEXTURE for anything else
+    uint32_t getIndex(const ImageBuffer *_texture) const;
+    //frees the slots of textures nothing else holds anymore, call before acquiring so their addresses are not
+    //mistaken for new textures
+    void releaseUnused();
+    //writes the slots that changed since _set was last written for _frameIndex, the set must not be in use by a
+    //pending frame. true when anything was written
+    bool writeDescriptors(int _frameIndex, lve::LveDescriptorSetLayout &_layout, lve::LveDescriptorPool &_pool,
+                          VkDescriptorSet &_set, uint32_t _binding);
+
+    //bumped whenever a slot is taken or freed, the texture indices of objects may have changed since
+    uint64_t getVersion() const { return version; }
+    //textures in the table, the default one included
+    uint32_t getUsedCount() const { return static_cast<uint32_t>(slotOfTextureList.size()) + 1; }
+
+private:
+    //points slots that hold nothing at the default texture
+    void clearSlot(uint32_t _slot);
+
+    bool bindless = false;
+    uint32_t capacity = 1;
+    VkSpecializationMapEntry specializationEntry{};
+    VkSpecializationInfo specializationInfo{};
+
+    std::unique_ptr<ImageBuffer> defaultTexture;
+    //by slot, what the array should hold. slots never used stay empty with descriptor indexing
+    std::vector<std::weak_ptr<ImageBuffer>> texturesList;
+    std::vector<VkDescriptorImageInfo> imageInfosList;
+    std::unordered_map<const ImageBuffer *, uint32_t> slotOfTextureList;
+    std::vector<uint32_t> freeSlotsList;
+    uint32_t nextSlot = DEFAULT_TEXTURE + 1;
+
+    //what every frame's set holds, compared against imageInfosList once the table changed
+    uint64_t version = 1;
+    struct FrameSlots {
+        uint64_t version = 0;
+        std::vector<VkDescriptorImageInfo> writtenList;
+    };
+    FrameSlots frameSlotsList[SwapChain::MAX_FRAMES_IN_FLIGHT];
+};
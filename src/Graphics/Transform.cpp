@@ -1,4 +1,4 @@
-#include "Object.h"
+#include "Transform.h"
 
 glm::mat4 TransformationPrimitive::getTransformationMatrix() {
 
@@ -0,0 +1,17 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_TO_ZERO
+#include <glm/vec2.hpp>
+#include <glm/ext/matrix_float2x2.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+struct TransformationPrimitive{
+    glm::vec3 translation{};
+    glm::vec3 scaleVector = {1.0f, 1.0f, 1.0f};
+    glm::vec3 rotation{0.0f};
+
+    glm::mat4 getTransformationMatrix();
+    glm::mat4 getTransformationMatrixFAST();
+    glm::mat3 getNormalMatrix();
+};
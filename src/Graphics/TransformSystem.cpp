@@ -0,0 +1,247 @@
+#include "TransformSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CpuFeatures.h"
+
+//x - k * pi / 2 in three steps, the leading parts are exact in float so large angles keep their precision
+static constexpr float TWO_OVER_PI = 0.636619772367581f;
+static constexpr float PI_OVER_2_HIGH = 1.5703125f;
+static constexpr float PI_OVER_2_MID = 4.837512969970703125e-4f;
+static constexpr float PI_OVER_2_LOW = 7.54978995489188216e-8f;
+//minimax polynomials on [-pi / 4, pi / 4]
+static constexpr float SIN_C1 = -1.6666654611e-1f;
+static constexpr float SIN_C2 = 8.3321608736e-3f;
+static constexpr float SIN_C3 = -1.9515295891e-4f;
+static constexpr float COS_C1 = 4.166664568298827e-2f;
+static constexpr float COS_C2 = -1.388731625493765e-3f;
+static constexpr float COS_C3 = 2.443315711809948e-5f;
+
+//rows of a group of lanes: the scaled rotation columns of the model matrix, the inverse scaled ones of the normal
+//matrix and the translation
+static constexpr uint32_t MODEL_ROW = 0;
+static constexpr uint32_t NORMAL_ROW = 9;
+static constexpr uint32_t TRANSLATION_ROW = 18;
+static constexpr uint32_t ROW_COUNT = 21;
+static constexpr uint32_t LANES = TransformSystem::LANES;
+
+//first element of a group in every component array
+struct GroupComponents {
+    const float *translation[3];
+    const float *rotation[3];
+    const float *scale[3];
+};
+
+#ifdef CPU_AVX2
+CPU_AVX2_TARGET static void sinCos(__m256 _angle, __m256 &_sin, __m256 &_cos) {
+    __m256 quadrant = _mm256_round_ps(_mm256_mul_ps(_angle, _mm256_set1_ps(TWO_OVER_PI)),
+                                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(quadrant, _mm256_set1_ps(PI_OVER_2_HIGH), _angle);
+    r = _mm256_fnmadd_ps(quadrant, _mm256_set1_ps(PI_OVER_2_MID), r);
+    r = _mm256_fnmadd_ps(quadrant, _mm256_set1_ps(PI_OVER_2_LOW), r);
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 s = _mm256_fmadd_ps(r2, _mm256_set1_ps(SIN_C3), _mm256_set1_ps(SIN_C2));
+    s = _mm256_fmadd_ps(r2, s, _mm256_set1_ps(SIN_C1));
+    s = _mm256_fmadd_ps(_mm256_mul_ps(r, r2), s, r);
+    __m256 c = _mm256_fmadd_ps(r2, _mm256_set1_ps(COS_C3), _mm256_set1_ps(COS_C2));
+    c = _mm256_fmadd_ps(r2, c, _mm256_set1_ps(COS_C1));
+    c = _mm256_fmadd_ps(_mm256_mul_ps(r2, r2), c, _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), r2, _mm256_set1_ps(1.0f)));
+
+    __m256i q = _mm256_cvtps_epi32(quadrant);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i two = _mm256_set1_epi32(2);
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+    //bit 1 of the quadrant moved up to the sign bit
+    __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30));
+    __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), 30));
+    _sin = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+    _cos = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+}
+#endif
+
+static void sinCos(float _angle, float &_sin, float &_cos) {
+    float quadrant = std::nearbyint(_angle * TWO_OVER_PI);
+    float r = _angle - quadrant * PI_OVER_2_HIGH;
+    r -= quadrant * PI_OVER_2_MID;
+    r -= quadrant * PI_OVER_2_LOW;
+    float r2 = r * r;
+    float s = r + r * r2 * (SIN_C1 + r2 * (SIN_C2 + r2 * SIN_C3));
+    float c = 1.0f - 0.5f * r2 + r2 * r2 * (COS_C1 + r2 * (COS_C2 + r2 * COS_C3));
+
+    //every quarter turn swaps the two and flips one sign
+    auto q = static_cast<uint32_t>(static_cast<int32_t>(quadrant));
+    _sin = (q & 1) ? c : s;
+    _cos = (q & 1) ? s : c;
+    if (q & 2)
+        _sin = -_sin;
+    if ((q + 1) & 2)
+        _cos = -_cos;
+}
+
+//same terms as getTransformationMatrixFAST: 1 is the yaw around y, 2 the pitch around x, 3 the roll around z
+static void buildRows(const GroupComponents &_group, float _rows[ROW_COUNT][LANES]) {
+    for (uint32_t lane = 0; lane < LANES; ++lane) {
+        float s1, c1, s2, c2, s3, c3;
+        sinCos(_group.rotation[1][lane], s1, c1);
+        sinCos(_group.rotation[0][lane], s2, c2);
+        sinCos(_group.rotation[2][lane], s3, c3);
+
+        float rotation[9] = {
+                c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1,
+                c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3,
+                c2 * s1, -s2, c1 * c2,
+        };
+        for (uint32_t column = 0; column < 3; ++column) {
+            float scale = _group.scale[column][lane];
+            for (uint32_t row = 0; row < 3; ++row) {
+                _rows[MODEL_ROW + column * 3 + row][lane] = scale * rotation[column * 3 + row];
+                _rows[NORMAL_ROW + column * 3 + row][lane] = (1.0f / scale) * rotation[column * 3 + row];
+            }
+            _rows[TRANSLATION_ROW + column][lane] = _group.translation[column][lane];
+        }
+    }
+}
+
+#ifdef CPU_AVX2
+//every lane at once, _rows is 32 byte aligned
+CPU_AVX2_TARGET static void buildRowsAvx2(const GroupComponents &_group, float _rows[ROW_COUNT][LANES]) {
+    __m256 s1, c1, s2, c2, s3, c3;
+    sinCos(_mm256_loadu_ps(_group.rotation[1]), s1, c1);
+    sinCos(_mm256_loadu_ps(_group.rotation[0]), s2, c2);
+    sinCos(_mm256_loadu_ps(_group.rotation[2]), s3, c3);
+
+    __m256 s2s3 = _mm256_mul_ps(s2, s3);
+    __m256 c3s2 = _mm256_mul_ps(c3, s2);
+    __m256 rotation[9] = {
+            _mm256_fmadd_ps(s1, s2s3, _mm256_mul_ps(c1, c3)),
+            _mm256_mul_ps(c2, s3),
+            _mm256_fmsub_ps(c1, s2s3, _mm256_mul_ps(c3, s1)),
+            _mm256_fmsub_ps(s1, c3s2, _mm256_mul_ps(c1, s3)),
+            _mm256_mul_ps(c2, c3),
+            _mm256_fmadd_ps(c1, c3s2, _mm256_mul_ps(s1, s3)),
+            _mm256_mul_ps(c2, s1),
+            _mm256_xor_ps(s2, _mm256_set1_ps(-0.0f)),
+            _mm256_mul_ps(c1, c2),
+    };
+    __m256 scale[3] = {_mm256_loadu_ps(_group.scale[0]), _mm256_loadu_ps(_group.scale[1]), _mm256_loadu_ps(_group.scale[2])};
+    __m256 one = _mm256_set1_ps(1.0f);
+    for (uint32_t column = 0; column < 3; ++column) {
+        __m256 inverseScale = _mm256_div_ps(one, scale[column]);
+        for (uint32_t row = 0; row < 3; ++row) {
+            _mm256_store_ps(_rows[MODEL_ROW + column * 3 + row], _mm256_mul_ps(scale[column], rotation[column * 3 + row]));
+            _mm256_store_ps(_rows[NORMAL_ROW + column * 3 + row], _mm256_mul_ps(inverseScale, rotation[column * 3 + row]));
+        }
+    }
+    std::memcpy(_rows[TRANSLATION_ROW], _group.translation[0], LANES * sizeof(float));
+    std::memcpy(_rows[TRANSLATION_ROW + 1], _group.translation[1], LANES * sizeof(float));
+    std::memcpy(_rows[TRANSLATION_ROW + 2], _group.translation[2], LANES * sizeof(float));
+}
+#endif
+
+void TransformSystem::resize(uint32_t _count) {
+    uint32_t padded = (_count + LANES - 1) / LANES * LANES;
+    auto resizeComponent = [padded](std::vector<float> &_component, float _identity) { _component.resize(padded, _identity); };
+    resizeComponent(translationX, 0.0f);
+    resizeComponent(translationY, 0.0f);
+    resizeComponent(translationZ, 0.0f);
+    resizeComponent(rotationX, 0.0f);
+    resizeComponent(rotationY, 0.0f);
+    resizeComponent(rotationZ, 0.0f);
+    resizeComponent(scaleX, 1.0f);
+    resizeComponent(scaleY, 1.0f);
+    resizeComponent(scaleZ, 1.0f);
+    //padding is never dirty, growing marks the new transforms
+    dirtyList.resize(padded, 0);
+    for (uint32_t i = count; i < _count; ++i)
+        dirtyList[i] = 1;
+    for (uint32_t i = _count; i < padded; ++i) {
+        translationX[i] = translationY[i] = translationZ[i] = 0.0f;
+        rotationX[i] = rotationY[i] = rotationZ[i] = 0.0f;
+        scaleX[i] = scaleY[i] = scaleZ[i] = 1.0f;
+        dirtyList[i] = 0;
+    }
+    anyDirty = anyDirty || _count > count;
+    count = _count;
+    modelMatricesList.resize(count, glm::mat4{1.0f});
+    normalMatricesList.resize(count, glm::mat3{1.0f});
+}
+
+void TransformSystem::set(uint32_t _index, const TransformationPrimitive &_transform) {
+    bool changed = translationX[_index] != _transform.translation.x || translationY[_index] != _transform.translation.y ||
+                   translationZ[_index] != _transform.translation.z || rotationX[_index] != _transform.rotation.x ||
+                   rotationY[_index] != _transform.rotation.y || rotationZ[_index] != _transform.rotation.z ||
+                   scaleX[_index] != _transform.scaleVector.x || scaleY[_index] != _transform.scaleVector.y ||
+                   scaleZ[_index] != _transform.scaleVector.z;
+    if (!changed)
+        return;
+
+    translationX[_index] = _transform.translation.x;
+    translationY[_index] = _transform.translation.y;
+    translationZ[_index] = _transform.translation.z;
+    rotationX[_index] = _transform.rotation.x;
+    rotationY[_index] = _transform.rotation.y;
+    rotationZ[_index] = _transform.rotation.z;
+    scaleX[_index] = _transform.scaleVector.x;
+    scaleY[_index] = _transform.scaleVector.y;
+    scaleZ[_index] = _transform.scaleVector.z;
+    dirtyList[_index] = 1;
+    anyDirty = true;
+}
+
+void TransformSystem::markAllDirty() {
+    std::fill(dirtyList.begin(), dirtyList.begin() + count, 1);
+    anyDirty = count > 0;
+}
+
+void TransformSystem::update() {
+    stats = {};
+    stats.transforms = count;
+    updatedList.clear();
+    if (!anyDirty)
+        return;
+
+#ifdef CPU_AVX2
+    const bool avx2 = cpuSupportsAvx2();
+#endif
+    alignas(32) float rows[ROW_COUNT][LANES];
+    for (uint32_t first = 0; first < count; first += LANES) {
+        uint32_t dirty = 0;
+        for (uint32_t lane = 0; lane < LANES; ++lane)
+            dirty += dirtyList[first + lane];
+        if (dirty == 0)
+            continue;
+
+        GroupComponents group{{&translationX[first], &translationY[first], &translationZ[first]},
+                              {&rotationX[first], &rotationY[first], &rotationZ[first]},
+                              {&scaleX[first], &scaleY[first], &scaleZ[first]}};
+#ifdef CPU_AVX2
+        if (avx2)
+            buildRowsAvx2(group, rows);
+        else
+#endif
+            buildRows(group, rows);
+
+        //clean lanes come out as they were, writing them back is cheaper than skipping them one by one
+        uint32_t lanes = std::min(LANES, count - first);
+        for (uint32_t lane = 0; lane < lanes; ++lane) {
+            glm::mat4 &model = modelMatricesList[first + lane];
+            glm::mat3 &normal = normalMatricesList[first + lane];
+            for (uint32_t column = 0; column < 3; ++column) {
+                for (uint32_t row = 0; row < 3; ++row) {
+                    model[column][row] = rows[MODEL_ROW + column * 3 + row][lane];
+                    normal[column][row] = rows[NORMAL_ROW + column * 3 + row][lane];
+                }
+                model[column][3] = 0.0f;
+            }
+            model[3] = glm::vec4{rows[TRANSLATION_ROW][lane], rows[TRANSLATION_ROW + 1][lane], rows[TRANSLATION_ROW + 2][lane], 1.0f};
+            if (dirtyList[first + lane])
+                updatedList.push_back(first + lane);
+            dirtyList[first + lane] = 0;
+        }
+        stats.updated += dirty;
+    }
+    anyDirty = false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Transform.h"
+
+//transforms in the last update and how many of them had to be rebuilt
+struct TransformStats {
+    uint32_t transforms = 0;
+    uint32_t updated = 0;
+};
+
+//translation, rotation and scale of every object in one array per component, and the model and normal matrices
+//built from them. update rebuilds only dirty transforms, LANES at a time when the cpu has avx2 and fma, one sin and cos per
+//angle shared by both matrices. the matrices are the same as TransformationPrimitive's FAST ones up to float
+//rounding, the sine and cosine are polynomials
+class TransformSystem {
+public:
+    //transforms per group, one avx2 register. the scalar path walks the same groups
+    static constexpr uint32_t LANES = 8;
+
+    //keeps the first _count transforms, new ones are identities and dirty
+    void resize(uint32_t _count);
+    uint32_t size() const { return count; }
+
+    //marks the transform dirty only when it differs from the stored one, so all of them can be set every frame
+    void set(uint32_t _index, const TransformationPrimitive &_transform);
+    void markAllDirty();
+
+    //rebuilds the matrices of the dirty transforms
+    void update();
+
+    const glm::mat4 &getModelMatrix(uint32_t _index) const { return modelMatricesList[_index]; }
+    //inverse transpose of the model matrix's upper 3x3
+    const glm::mat3 &getNormalMatrix(uint32_t _index) const { return normalMatricesList[_index]; }
+    //transforms rebuilt by the last update, ascending
+    const std::vector<uint32_t> &getUpdatedList() const { return updatedList; }
+    //counts of the last update
+    const TransformStats &getStats() const { return stats; }
+
+private:
+    uint32_t count = 0;
+    //padded to a multiple of LANES with identities, the last group never needs a scalar tail
+    std::vector<float> translationX, translationY, translationZ;
+    std::vector<float> rotationX, rotationY, rotationZ;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<uint8_t> dirtyList;
+    bool anyDirty = false;
+    std::vector<uint32_t> updatedList;
+
+    std::vector<glm::mat4> modelMatricesList;
+    std::vector<glm::mat3> normalMatricesList;
+    TransformStats stats{};
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils.h"
+
+//one vertex attribute: the member it reads, where it sits and how the gpu sees it. use VERTEX_ATTRIBUTE to declare one
+template<auto Member, uint32_t Offset, VkFormat Format>
+struct VertexAttribute {
+    static constexpr auto member = Member;
+    static constexpr uint32_t offset = Offset;
+    static constexpr VkFormat format = Format;
+};
+
+#define VERTEX_ATTRIBUTE(type, member, format) VertexAttribute<&type::member, static_cast<uint32_t>(offsetof(type, member)), format>
+
+//member helpers, c arrays are compared and hashed element wise
+namespace VertexLayoutDetail {
+    template<typename T>
+    bool equalMember(const T &_a, const T &_b) { return _a == _b; }
+
+    template<typename T, size_t N>
+    bool equalMember(const T (&_a)[N], const T (&_b)[N]) { return std::equal(_a, _a + N, _b); }
+
+    template<typename T>
+    void hashMember(size_t &seed, const T &_value) { hashCombine(seed, _value); }
+
+    template<typename T, size_t N>
+    void hashMember(size_t &seed, const T (&_value)[N]) {
+        for (const auto &element : _value)
+            hashCombine(seed, element);
+    }
+}
+
+//everything vulkan and the loaders need to know about a vertex type, built at compile time from its attribute list.
+//locations follow the order of the list. equality and hashing use the same members, so a vertex welds exactly
+//when everything the gpu reads from it matches
+template<typename VertexType, typename... Attributes>
+struct VertexLayout {
+    static constexpr uint32_t attributeCount = sizeof...(Attributes);
+
+    static constexpr std::array<VkVertexInputBindingDescription, 1> bindings = {
+            VkVertexInputBindingDescription{0, static_cast<uint32_t>(sizeof(VertexType)), VK_VERTEX_INPUT_RATE_VERTEX}
+    };
+
+    static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> createAttributes() {
+        std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> attributesList{};
+        uint32_t location = 0;
+        ((attributesList[location] = {location, 0, Attributes::format, Attributes::offset}, ++location), ...);
+        return attributesList;
+    }
+
+    static constexpr std::array<VkVertexInputAttributeDescription, sizeof...(Attributes)> attributes = createAttributes();
+
+    static bool equal(const VertexType &_a, const VertexType &_b) {
+        return (VertexLayoutDetail::equalMember(_a.*Attributes::member, _b.*Attributes::member) && ...);
+    }
+
+    static size_t hash(const VertexType &_vertex) {
+        size_t seed = 0;
+        (VertexLayoutDetail::hashMember(seed, _vertex.*Attributes::member), ...);
+        return seed;
+    }
+};
+
+//specialized next to every vertex type, derive from VertexLayout:
+//template<> struct VertexDescription<MyVertex> : VertexLayout<MyVertex, VERTEX_ATTRIBUTE(MyVertex, position, ...)> {};
+template<typename VertexType>
+struct VertexDescription;
+
+//for hash maps that weld identical vertices
+template<typename VertexType>
+struct VertexHash {
+    size_t operator()(const VertexType &_vertex) const { return VertexDescription<VertexType>::hash(_vertex); }
+};
+
+template<typename VertexType>
+struct VertexEqual {
+    bool operator()(const VertexType &_a, const VertexType &_b) const { return VertexDescription<VertexType>::equal(_a, _b); }
+};
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <set>
 #include <functional>
 #include "Vh.h"
@@ -209,18 +210,80 @@ QueueFamilyIndices Vh::findQueueFamilies(const VkPhysicalDevice &device, const V
     return indices;
 }
 
-VkDevice Vh::createLogicalDevice(const VkPhysicalDevice &physDevice, const QueueFamilyIndices &indices, const std::vector<VkDeviceQueueCreateInfo> &queueCreateInfoList) {
+DeviceFeatures Vh::queryDeviceFeatures(const VkPhysicalDevice &physDevice) {
+    DeviceFeatures features{};
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physDevice, &deviceProperties);
+    //the 1.2 structs may only be chained on devices that report 1.2, older ones keep the 1.0 features alone
+    features.vulkan12 = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+    features.maxDrawIndirectCount = deviceProperties.limits.maxDrawIndirectCount;
+    if (!features.vulkan12) {
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physDevice, &supportedFeatures);
+        features.multiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+        features.sampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing == VK_TRUE;
+        return features;
+    }
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(physDevice, &supportedFeatures);
+
+    features.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect == VK_TRUE;
+    features.drawIndirectCount = vulkan12Features.drawIndirectCount == VK_TRUE;
+    features.sampledImageArrayDynamicIndexing = supportedFeatures.features.shaderSampledImageArrayDynamicIndexing == VK_TRUE;
+    features.descriptorIndexing = vulkan12Features.shaderSampledImageArrayNonUniformIndexing == VK_TRUE &&
+                                  vulkan12Features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+                                  vulkan12Features.descriptorBindingPartiallyBound == VK_TRUE;
+    if (features.descriptorIndexing) {
+        VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+        vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &vulkan12Properties;
+        vkGetPhysicalDeviceProperties2(physDevice, &properties);
+        //a combined image sampler counts as a sampler and as a sampled image
+        features.maxBindlessTextures = std::min({vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                                 vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                                 vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers,
+                                                 vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages});
+    }
+    return features;
+}
+
+VkDevice Vh::createLogicalDevice(const VkPhysicalDevice &physDevice, const QueueFamilyIndices &indices, const std::vector<VkDeviceQueueCreateInfo> &queueCreateInfoList, const DeviceFeatures &features) {
 
     //set data for logical physDevice
-    VkPhysicalDeviceFeatures deviceFeatures{};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.drawIndirectCount = features.drawIndirectCount ? VK_TRUE : VK_FALSE;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing = features.descriptorIndexing ? VK_TRUE : VK_FALSE;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = features.descriptorIndexing ? VK_TRUE : VK_FALSE;
+    vulkan12Features.descriptorBindingPartiallyBound = features.descriptorIndexing ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures{};
+    deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.pNext = &vulkan12Features;
+    deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.features.multiDrawIndirect = features.multiDrawIndirect ? VK_TRUE : VK_FALSE;
+    deviceFeatures.features.shaderSampledImageArrayDynamicIndexing = features.sampledImageArrayDynamicIndexing ? VK_TRUE : VK_FALSE;
 
     VkDeviceCreateInfo deviceCreateInfo{};
     deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfoList.data();
     deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfoList.size());
 
-    deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
+    //features go through the pNext chain so the 1.2 ones can be enabled too, older devices get the 1.0 ones only
+    if (features.vulkan12) {
+        deviceCreateInfo.pEnabledFeatures = nullptr;
+        deviceCreateInfo.pNext = &deviceFeatures;
+    } else {
+        deviceCreateInfo.pEnabledFeatures = &deviceFeatures.features;
+    }
 
     deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(Vh::requiredDeviceExtensionsList.size());
     deviceCreateInfo.ppEnabledExtensionNames = Vh::requiredDeviceExtensionsList.data();
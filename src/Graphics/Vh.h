@@ -7,6 +7,7 @@
 #include "../Logger/Logger.h"
 #include "QueueFamilyIndices.h"
 #include "SwapChainSupportDetails.h"
+#include "DeviceFeatures.h"
 #include "SyncObjects.h"
 #include <GLFW/glfw3.h>
 #include <stdexcept>
@@ -24,7 +25,8 @@ public:
     createPhysicalDevice(const VkInstance &instance, const VkSurfaceKHR &windowSurface, const Logger &log);
     static bool                                 ifDeviceSuitable(const VkPhysicalDevice &device,const VkSurfaceKHR &windowSurface);
     static QueueFamilyIndices                   findQueueFamilies(const VkPhysicalDevice &device,const VkSurfaceKHR &windowSurface);
-    static VkDevice                             createLogicalDevice(const VkPhysicalDevice &physDevice, const QueueFamilyIndices &indices, const std::vector<VkDeviceQueueCreateInfo> &queueCreateInfoList);
+    static DeviceFeatures                       queryDeviceFeatures(const VkPhysicalDevice &physDevice);
+    static VkDevice                             createLogicalDevice(const VkPhysicalDevice &physDevice, const QueueFamilyIndices &indices, const std::vector<VkDeviceQueueCreateInfo> &queueCreateInfoList, const DeviceFeatures &features);
     static VkQueue                              createGraphicsQueue(const VkDevice &logDevice, const QueueFamilyIndices &indices);
     static VkSurfaceKHR                         createWindowSurface(VkInstance const &instance, GLFWwindow *window);
     static std::vector<VkDeviceQueueCreateInfo> populateQueueCreateInfo(QueueFamilyIndices indices);
@@ -1,78 +1,343 @@
 #include "BasicRenderSystem.h"
 
+#include <algorithm>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "IndirectRenderSystem.h"
+#include "../TextureTable.h"
+
+static constexpr uint32_t MIN_INSTANCE_CAPACITY = 256;
+
 BasicRenderSystem::BasicRenderSystem(Device &_device, VkRenderPass renderPass, VkDescriptorSetLayout _globalDescriptorSetLayout,
-                                     Logger &_log)
-        : device(_device), log(_log) {
+                                     const TextureTable &_textures, bool _depthPrePass, Logger &_log, ThreadPool *_workers)
+        : device(_device), log(_log), workers(_workers) {
+    createDescriptors();
     createPipelineLayout(_globalDescriptorSetLayout);
-    createPipeline(renderPass);
+    createPipeline(renderPass, _textures, _depthPrePass);
 }
 
 BasicRenderSystem::~BasicRenderSystem() {
+    for (auto &cache : cachedCommandsList) {
+        if (cache.commandBuffer != VK_NULL_HANDLE)
+            vkFreeCommandBuffers(device.getDevice(), device.getCommandPool(), 1, &cache.commandBuffer);
+    }
     vkDestroyPipelineLayout(device.getDevice(), pipelineLayout, nullptr);
 }
 
-void BasicRenderSystem::createPipelineLayout(VkDescriptorSetLayout &_globalDescriptorSetLayout) {
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PushConstantData);
+void BasicRenderSystem::createDescriptors() {
+    descriptorPool = lve::LveDescriptorPool::Builder(device)
+            .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .build();
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayout{_globalDescriptorSetLayout};
+    instanceSetLayout = lve::LveDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+}
+
+void BasicRenderSystem::createPipelineLayout(VkDescriptorSetLayout &_globalDescriptorSetLayout) {
+    std::vector<VkDescriptorSetLayout> descriptorSetLayout{_globalDescriptorSetLayout, instanceSetLayout->getDescriptorSetLayout()};
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayout.size());
     pipelineLayoutInfo.pSetLayouts = descriptorSetLayout.data();
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    pipelineLayoutInfo.pushConstantRangeCount = 0;
+    pipelineLayoutInfo.pPushConstantRanges = nullptr;
     if (vkCreatePipelineLayout(device.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
         VK_SUCCESS) {
         throw std::runtime_error("failed to create pipeline layout!");
     }
 }
 
-void BasicRenderSystem::createPipeline(VkRenderPass renderPass) {
+void BasicRenderSystem::createPipeline(VkRenderPass renderPass, const TextureTable &_textures, bool _depthPrePass) {
     assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
     PipelineConfigInfo pipelineConfig{};
-    Pipeline::getDefaultPipelineInfo(pipelineConfig);
+    if (_depthPrePass)
+        Pipeline::getDepthEqualPipelineInfo(pipelineConfig);
+    else
+        Pipeline::getDefaultPipelineInfo(pipelineConfig);
     pipelineConfig.renderPass = renderPass;
     pipelineConfig.pipelineLayoutInfo = pipelineLayout;
+    pipelineConfig.fragmentSpecializationInfo = _textures.getSpecializationInfo();
     lvePipeline = std::make_unique<Pipeline>(
             device,
             "shaders/shader.vert.spv",
-            "shaders/shader.frag.spv",
+            _textures.isBindless() ? "shaders/shader.bindless.frag.spv" : "shaders/shader.frag.spv",
             pipelineConfig,
             log);
+
+    if (!_depthPrePass)
+        return;
+
+    PipelineConfigInfo depthConfig{};
+    Pipeline::getDepthPrePassPipelineInfo(depthConfig);
+    depthConfig.renderPass = renderPass;
+    depthConfig.pipelineLayoutInfo = pipelineLayout;
+    depthPipeline = std::make_unique<Pipeline>(
+            device,
+            "shaders/depth_prepass.vert.spv",
+            "",
+            depthConfig,
+            log);
+}
+
+void BasicRenderSystem::renderGameObjects(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects,
+                                          const std::vector<uint8_t> *_visibility) {
+    uploadInstances(_frameInfo, gameObjects);
+    cullMeshlets(_frameInfo, gameObjects, _visibility);
+    fillQueue(_frameInfo, gameObjects, _visibility);
+    renderQueue.sort(workers);
+    recordQueue(_frameInfo, gameObjects);
+}
+
+void BasicRenderSystem::renderCachedGameObjects(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects,
+                                                const std::vector<uint8_t> *_visibility, uint64_t _sceneVersion,
+                                                VkRenderPass _renderPass, VkExtent2D _extent) {
+    //texture slots change without a new recording, the instances are written before every replay
+    uploadInstances(_frameInfo, gameObjects);
+    auto &cache = cachedCommandsList[_frameInfo.frameIndex];
+    if (cache.commandBuffer == VK_NULL_HANDLE) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandPool = device.getCommandPool();
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(device.getDevice(), &allocInfo, &cache.commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("cant allocate secondary command buffer");
+    }
+
+    bool upToDate = cache.recorded && cache.sceneVersion == _sceneVersion && cache.renderPass == _renderPass &&
+                    cache.extent.width == _extent.width && cache.extent.height == _extent.height;
+    if (upToDate) {
+        commandCacheStats.replayedFrames++;
+    } else {
+        //the fence of this frame was waited on, so the buffer is not pending anymore
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = _renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        if (vkBeginCommandBuffer(cache.commandBuffer, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("cant begin secondary command buffer");
+
+        //secondaries inherit no state at all, dynamic state included
+        CommandRecorder recorder{cache.commandBuffer};
+        VkViewport viewport{0.0f, 0.0f, static_cast<float>(_extent.width), static_cast<float>(_extent.height), 0.0f, 1.0f};
+        VkRect2D scissor{{0, 0}, _extent};
+        recorder.setViewport(viewport);
+        recorder.setScissor(scissor);
+
+        FrameInfo cachedFrameInfo{_frameInfo.frameIndex, _frameInfo.frameTime, cache.commandBuffer, recorder,
+                                  _frameInfo.camera, _frameInfo.globalDescriptorSet, _frameInfo.sceneGraph,
+                                  _frameInfo.textureTable, _frameInfo.changedObjects};
+        cullMeshlets(cachedFrameInfo, gameObjects, _visibility);
+        fillQueue(cachedFrameInfo, gameObjects, _visibility);
+        renderQueue.sort(workers);
+        recordQueue(cachedFrameInfo, gameObjects);
+
+        if (vkEndCommandBuffer(cache.commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("cant end secondary command buffer");
+        cache.recorded = true;
+        cache.sceneVersion = _sceneVersion;
+        cache.renderPass = _renderPass;
+        cache.extent = _extent;
+        commandCacheStats.recordedFrames++;
+    }
+
+    vkCmdExecuteCommands(_frameInfo.commandBuffer, 1, &cache.commandBuffer);
+    //state after executing secondaries is undefined
+    _frameInfo.recorder.invalidate();
+}
+
+void BasicRenderSystem::uploadInstances(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects) {
+    auto &frame = frameInstancesList[_frameInfo.frameIndex];
+    auto count = static_cast<uint32_t>(gameObjects.size());
+
+    //the changes reach instancesList once, and every frame's buffer the next time that frame is recorded
+    const auto &changes = _frameInfo.changedObjects;
+    if (changes.isAllDirty() || instancesList.size() != count) {
+        instancesList.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+            updateInstance(_frameInfo, i, gameObjects[i]);
+        for (auto &instances : frameInstancesList)
+            instances.dirtyObjects.markAll();
+    } else {
+        for (uint32_t object : changes.getList()) {
+            updateInstance(_frameInfo, object, gameObjects[object]);
+            for (auto &instances : frameInstancesList)
+                instances.dirtyObjects.mark(object);
+        }
+    }
+
+    //the fence of this frame was waited on, so its buffer and set are not in use anymore
+    if (count > frame.capacity || frame.buffer == nullptr) {
+        frame.capacity = std::max({count, frame.capacity * 2, MIN_INSTANCE_CAPACITY});
+        frame.buffer = std::make_unique<Buffer>(device,
+                                                sizeof(InstanceData),
+                                                frame.capacity,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        frame.buffer->map();
+        frame.dirtyObjects.markAll();
+
+        auto bufferInfo = frame.buffer->descriptorInfo();
+        lve::LveDescriptorWriter writer{*instanceSetLayout, *descriptorPool};
+        writer.writeBuffer(0, &bufferInfo);
+        if (frame.descriptorSet == VK_NULL_HANDLE) {
+            if (!writer.build(frame.descriptorSet))
+                throw std::runtime_error("cant allocate instance descriptors");
+        } else {
+            writer.overwrite(frame.descriptorSet);
+            //updating a set invalidates every command buffer that bound it
+            cachedCommandsList[_frameInfo.frameIndex].recorded = false;
+        }
+    }
+
+    instanceStats = {};
+    instanceStats.instances = count;
+    auto *mapped = static_cast<InstanceData *>(frame.buffer->getMappedMemory());
+    if (frame.dirtyObjects.isAllDirty()) {
+        std::copy(instancesList.begin(), instancesList.end(), mapped);
+        instanceStats.uploadedInstances = count;
+        instanceStats.uploadedRanges = count > 0 ? 1 : 0;
+    } else if (!frame.dirtyObjects.empty()) {
+        //runs of changed instances are copied in one go
+        sortedDirtyList = frame.dirtyObjects.getList();
+        std::sort(sortedDirtyList.begin(), sortedDirtyList.end());
+        size_t runBegin = 0;
+        for (size_t i = 1; i <= sortedDirtyList.size(); ++i) {
+            if (i < sortedDirtyList.size() && sortedDirtyList[i] == sortedDirtyList[i - 1] + 1)
+                continue;
+            uint32_t first = sortedDirtyList[runBegin];
+            auto length = static_cast<uint32_t>(i - runBegin);
+            std::copy(instancesList.begin() + first, instancesList.begin() + first + length, mapped + first);
+            instanceStats.uploadedInstances += length;
+            instanceStats.uploadedRanges++;
+            runBegin = i;
+        }
+    }
+    frame.dirtyObjects.clear();
+}
+
+void BasicRenderSystem::updateInstance(const FrameInfo &_frameInfo, uint32_t _index, const Object &_object) {
+    InstanceData &instance = instancesList[_index];
+    instance.modelMatrix = _frameInfo.sceneGraph.getWorldMatrix(_index) * _object.mesh->getDequantizationMatrix();
+    const glm::mat3 &normalMatrix = _frameInfo.sceneGraph.getNormalMatrix(_index);
+    for (int column = 0; column < 3; ++column)
+        instance.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+    instance.textureIndex = _frameInfo.textureTable.getIndex(_object.mesh->getSharedTexture().get());
+}
+
+void BasicRenderSystem::fillQueue(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects,
+                                  const std::vector<uint8_t> *_visibility) {
+    renderQueue.clear();
+    const glm::mat4 &view = _frameInfo.camera.getViewMatrix();
+
+    //view depth of every bounding sphere center, normalized by the farthest one
+    std::vector<float> depthsList(gameObjects.size(), 0.0f);
+    float maxDepth = 0.0f;
+    for (size_t i = 0; i < gameObjects.size(); ++i) {
+        if (_visibility != nullptr && !(*_visibility)[i])
+            continue;
+        auto &obj = gameObjects[i];
+        glm::vec3 center = glm::vec3(obj.mesh->getBoundingSphere());
+        depthsList[i] = std::max((view * _frameInfo.sceneGraph.getWorldMatrix(i) * glm::vec4(center, 1.0f)).z, 0.0f);
+        maxDepth = std::max(maxDepth, depthsList[i]);
+    }
+
+    for (size_t i = 0; i < gameObjects.size(); ++i) {
+        if (_visibility != nullptr && !(*_visibility)[i])
+            continue;
+        auto &obj = gameObjects[i];
+        float depth = maxDepth > 0.0f ? depthsList[i] / maxDepth : 0.0f;
+        uint32_t block = obj.mesh->getGeometry().block;
+        uint32_t mesh = renderQueue.getMeshId(obj.mesh.get());
+        auto object = static_cast<uint32_t>(i);
+
+        //textures play no part in the depth pass, so its draws only group by geometry
+        if (depthPipeline)
+            renderQueue.push(RenderQueue::makeKey(DEPTH_PASS, 0, 0, block, mesh, depth), object);
+        //the instances were written before the queue is filled, the texture slot is the material
+        uint32_t material = instancesList[i].textureIndex;
+        renderQueue.push(RenderQueue::makeKey(SHADING_PASS, 0, material, block, mesh, depth), object);
+    }
 }
 
-void BasicRenderSystem::renderGameObjects(const FrameInfo &_frameInfo, std::vector<Object> &gameObjects) {
-    lvePipeline->bind(_frameInfo.commandBuffer);
-
-    vkCmdBindDescriptorSets(_frameInfo.commandBuffer,
-                            VK_PIPELINE_BIND_POINT_GRAPHICS,
-                            pipelineLayout,
-                            0,
-                            1,
-                            &_frameInfo.globalDescriptorSet,
-                            0,
-                            nullptr);
-
-    for (auto& obj : gameObjects) {
-
-        PushConstantData push{};
-
-        push.normalMatrix = obj.transform.getNormalMatrix();
-        push.modelMatrix = obj.transform.getTransformationMatrixFAST();
-
-        vkCmdPushConstants(
-                _frameInfo.commandBuffer,
-                pipelineLayout,
-                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                0,
-                sizeof(PushConstantData),
-                &push);
-        obj.mesh->bindDataToBuffer(_frameInfo.commandBuffer);
-        obj.mesh->drawDataToBuffer(_frameInfo.commandBuffer);
+void BasicRenderSystem::recordQueue(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects) {
+    //the recorder drops every bind that would not change anything, sorted items make most of them redundant
+    CommandRecorder &recorder = _frameInfo.recorder;
+    CommandRecorderStats before = recorder.getStats();
+    VkDescriptorSet descriptorSets[2]{_frameInfo.globalDescriptorSet, frameInstancesList[_frameInfo.frameIndex].descriptorSet};
+
+    for (const auto &item : renderQueue.getItems()) {
+        auto &obj = gameObjects[item.object];
+        bool positionsOnly = RenderQueue::getPass(item.key) == DEPTH_PASS;
+
+        (positionsOnly ? depthPipeline : lvePipeline)->bind(recorder);
+        //every material indexes the texture array of the global set, one bind serves the whole queue
+        recorder.bindDescriptorSets(pipelineLayout, 0, 2, descriptorSets);
+        if (positionsOnly)
+            obj.mesh->bindPositionsToBuffer(recorder);
+        else
+            obj.mesh->bindDataToBuffer(recorder);
+
+        //the object index is the first instance, the vertex shaders find the transforms through gl_InstanceIndex
+        if (obj.mesh->getLod(obj.lod).meshletCount > 0)
+            obj.mesh->drawMeshletsToBuffer(recorder, obj.lod, &meshletVisibilityList[meshletOffsetsList[item.object]], item.object);
+        else
+            obj.mesh->drawDataToBuffer(recorder, obj.lod, item.object);
+    }
+
+    const CommandRecorderStats &after = recorder.getStats();
+    queueStats = {};
+    queueStats.draws = static_cast<uint32_t>(renderQueue.size());
+    queueStats.pipelineBinds = after.issued[BIND_PIPELINE] - before.issued[BIND_PIPELINE];
+    queueStats.descriptorSetBinds = after.issued[BIND_DESCRIPTOR_SETS] - before.issued[BIND_DESCRIPTOR_SETS];
+    queueStats.vertexBufferBinds = after.issued[BIND_VERTEX_BUFFERS] - before.issued[BIND_VERTEX_BUFFERS];
+    queueStats.pipelineBindsAvoided = after.filtered[BIND_PIPELINE] - before.filtered[BIND_PIPELINE];
+    queueStats.descriptorSetBindsAvoided = after.filtered[BIND_DESCRIPTOR_SETS] - before.filtered[BIND_DESCRIPTOR_SETS];
+    queueStats.vertexBufferBindsAvoided = after.filtered[BIND_VERTEX_BUFFERS] - before.filtered[BIND_VERTEX_BUFFERS];
+}
+
+void BasicRenderSystem::cullMeshlets(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects,
+                                     const std::vector<uint8_t> *_visibility) {
+    glm::vec4 frustumPlanes[6];
+    IndirectRenderSystem::extractFrustumPlanes(_frameInfo.camera.getProjectionMatrix() * _frameInfo.camera.getViewMatrix(), frustumPlanes);
+    glm::vec4 cameraPosition = glm::inverse(_frameInfo.camera.getViewMatrix())[3];
+
+    meshletStats = {};
+    meshletVisibilityList.clear();
+    meshletOffsetsList.assign(gameObjects.size(), 0);
+    for (size_t i = 0; i < gameObjects.size(); ++i) {
+        auto &obj = gameObjects[i];
+        const auto &lod = obj.mesh->getLod(obj.lod);
+        if (lod.meshletCount == 0 || (_visibility != nullptr && !(*_visibility)[i]))
+            continue;
+
+        //camera and planes move into the space of the meshlet bounds, which keeps both tests exact under any affine
+        //model matrix. planes transform with the transpose
+        glm::mat4 modelMatrix = _frameInfo.sceneGraph.getWorldMatrix(i) * obj.mesh->getDequantizationMatrix();
+        glm::mat4 transposed = glm::transpose(modelMatrix);
+        float localPlanes[6][4];
+        for (int p = 0; p < 6; ++p) {
+            glm::vec4 plane = transposed * frustumPlanes[p];
+            plane /= glm::length(glm::vec3(plane));
+            for (int k = 0; k < 4; ++k)
+                localPlanes[p][k] = plane[k];
+        }
+        glm::vec3 localCamera = glm::vec3(glm::inverse(modelMatrix) * cameraPosition);
+
+        meshletOffsetsList[i] = static_cast<uint32_t>(meshletVisibilityList.size());
+        meshletVisibilityList.resize(meshletVisibilityList.size() + lod.meshletCount);
+        MeshletBuilder::cull(&obj.mesh->getMeshlets()[lod.firstMeshlet], lod.meshletCount, &localCamera.x, localPlanes,
+                             &meshletVisibilityList[meshletOffsetsList[i]], meshletStats);
     }
 }
\ No newline at end of file
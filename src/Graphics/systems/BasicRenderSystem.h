@@ -3,33 +3,136 @@
 #include <vulkan/vulkan.h>
 #include <memory>
 #include "../Pipeline.h"
+#include "../Descriptors.h"
 #include "../FrameInfo.h"
+#include "../MeshletBuilder.h"
+#include "../RenderQueue.h"
+#include "../SwapChain.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_TO_ZERO
-#include <glm/ext/matrix_float2x2.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
 
-struct PushConstantData{
+//frames whose draws were replayed from a secondary command buffer, and frames that had to record it first
+struct CommandCacheStats {
+    uint32_t replayedFrames = 0;
+    uint32_t recordedFrames = 0;
+};
+
+//matches Instance in shader.vert and depth_prepass.vert (std430), one per object at the object's index.
+//the model matrix includes the dequantization, the normal matrix is the 3x3 one as columns, w unused.
+//the texture index is the slot of the object's texture in the TextureTable
+struct InstanceData{
     glm::mat4 modelMatrix{1.0f};
-    glm::mat4 normalMatrix{1.0f};
+    glm::vec4 normalMatrix[3]{};
+    uint32_t textureIndex = 0;
+    uint32_t padding[3]{};
+};
+
+//objects in the instance buffer of the last frame and what of it had to be written
+struct InstanceUploadStats {
+    uint32_t instances = 0;
+    uint32_t uploadedInstances = 0;
+    uint32_t uploadedRanges = 0;
 };
 
 class BasicRenderSystem {
 public:
-    BasicRenderSystem(Device &_device, VkRenderPass renderPass, VkDescriptorSetLayout _globalDescriptorSetLayout, Logger &_log);
+    //with _depthPrePass the objects are first drawn depth only from the position stream of their pool,
+    //then shaded with an EQUAL depth test, so overdraw never reaches the fragment shader
+    //_workers sort the render queue once it is large enough
+    //_textures sizes the texture array of the fragment shader
+    BasicRenderSystem(Device &_device, VkRenderPass renderPass, VkDescriptorSetLayout _globalDescriptorSetLayout,
+                      const TextureTable &_textures, bool _depthPrePass, Logger &_log, ThreadPool *_workers = nullptr);
     ~BasicRenderSystem();
 
     BasicRenderSystem(const BasicRenderSystem &) = delete;
     BasicRenderSystem &operator=(const BasicRenderSystem &) = delete;
 
-    void renderGameObjects(const FrameInfo &_frameInfo, std::vector<Object> &gameObjects);
+    //_visibility has one entry per object, objects with 0 are skipped. objects whose level has meshlets get them
+    //culled on the cpu first, and only the surviving ones are drawn. the draws of both passes go through a sorted
+    //render queue, so state is only bound when it changes
+    void renderGameObjects(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects,
+                           const std::vector<uint8_t> *_visibility = nullptr);
+
+    //records the draws of renderGameObjects into a secondary command buffer of the frame, culled the same way, and
+    //replays it for as long as _sceneVersion, _renderPass and _extent stay the same. _renderPass has to be begun with
+    //secondary command buffer contents. whoever moves the camera or the objects, or changes _visibility, the object
+    //list, lods, meshes or the global descriptor set bumps _sceneVersion. texture indices are read from the instance
+    //buffer, which is uploaded before every replay, so swapping textures keeps the recording
+    void renderCachedGameObjects(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects,
+                                 const std::vector<uint8_t> *_visibility, uint64_t _sceneVersion,
+                                 VkRenderPass _renderPass, VkExtent2D _extent);
+
+    //counts of the last recording, for the cached path the last one that was not a replay
+    const MeshletCullStats &getMeshletStats() const { return meshletStats; }
+    const RenderQueueStats &getQueueStats() const { return queueStats; }
+    const InstanceUploadStats &getInstanceStats() const { return instanceStats; }
+    //counts since the last resetCommandCacheStats
+    const CommandCacheStats &getCommandCacheStats() const { return commandCacheStats; }
+    void resetCommandCacheStats() { commandCacheStats = {}; }
 
 private:
+    void createDescriptors();
     void createPipelineLayout(VkDescriptorSetLayout &_globalDescriptorSetLayout);
-    void createPipeline(VkRenderPass renderPass);
+    void createPipeline(VkRenderPass renderPass, const TextureTable &_textures, bool _depthPrePass);
+    //writes the instances of the objects that changed since this frame's buffer last saw them, taken from the
+    //frame's changed objects instead of comparing every instance
+    void uploadInstances(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects);
+    //recomputes the instance of one object in instancesList
+    void updateInstance(const FrameInfo &_frameInfo, uint32_t _index, const Object &_object);
+    void fillQueue(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects, const std::vector<uint8_t> *_visibility);
+    void recordQueue(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects);
+    //the same frustum and cone tests as meshlet_cull.comp, both passes draw the result
+    void cullMeshlets(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects, const std::vector<uint8_t> *_visibility);
+
+    //passes in the order they are drawn, the pass leads the sort key
+    enum Pass : uint32_t {
+        DEPTH_PASS = 0,
+        SHADING_PASS = 1,
+    };
 
     Device &device;
     Logger &log;
+    ThreadPool *workers;
     std::unique_ptr<Pipeline> lvePipeline;
+    //null without the depth pre-pass
+    std::unique_ptr<Pipeline> depthPipeline;
     VkPipelineLayout pipelineLayout;
+
+    std::unique_ptr<lve::LveDescriptorPool> descriptorPool;
+    std::unique_ptr<lve::LveDescriptorSetLayout> instanceSetLayout;
+    //one per frame in flight, persistently mapped and coherent, so writing a range is all an upload takes
+    struct FrameInstances {
+        std::unique_ptr<Buffer> buffer;
+        uint32_t capacity = 0;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        //objects whose instance in the buffer differs from instancesList
+        DirtyObjects dirtyObjects;
+    };
+    FrameInstances frameInstancesList[SwapChain::MAX_FRAMES_IN_FLIGHT];
+    std::vector<InstanceData> instancesList;
+    //the dirty objects of the frame being uploaded in ascending order, kept to reuse its memory
+    std::vector<uint32_t> sortedDirtyList;
+    InstanceUploadStats instanceStats{};
+
+    //visibility of the meshlets of every split object, starting at the object's offset
+    std::vector<uint8_t> meshletVisibilityList;
+    std::vector<uint32_t> meshletOffsetsList;
+    MeshletCullStats meshletStats{};
+
+    RenderQueue renderQueue;
+    RenderQueueStats queueStats{};
+
+    //one per frame in flight, a secondary cannot be recorded again while its frame may still run it and every frame
+    //binds its own global set
+    struct CachedCommands {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        bool recorded = false;
+        uint64_t sceneVersion = 0;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkExtent2D extent{};
+    };
+    CachedCommands cachedCommandsList[SwapChain::MAX_FRAMES_IN_FLIGHT];
+    CommandCacheStats commandCacheStats{};
 };
\ No newline at end of file
@@ -27,6 +27,9 @@ private:
     std::vector<std::unique_ptr<GuiLayer>> guiLayersList;
 
 public:
+    //runs the layers and produces the draw data, needs no frame, so it can overlap other cpu work
+    void buildImGui();
+    //records the draw data of the last buildImGui
     void renderImGui(FrameInfo &_frameInfo);
 
 private:
@@ -61,7 +61,7 @@ void ImGuiRenderSystem::initImGui() {
     //end init imgui
 }
 
-void ImGuiRenderSystem::renderImGui(FrameInfo &_frameInfo) {
+void ImGuiRenderSystem::buildImGui() {
     //make draw gui function
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -71,7 +71,12 @@ void ImGuiRenderSystem::renderImGui(FrameInfo &_frameInfo) {
     renderLayers();
 
     ImGui::Render();
+}
+
+void ImGuiRenderSystem::renderImGui(FrameInfo &_frameInfo) {
+    //the backend records on its own, whatever it bound is unknown to the recorder
     ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), _frameInfo.commandBuffer);
+    _frameInfo.recorder.invalidate();
 }
 
 void ImGuiRenderSystem::loadFontTextureAtlas() {
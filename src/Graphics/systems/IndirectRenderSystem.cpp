@@ -0,0 +1,457 @@
+#include "IndirectRenderSystem.h"
+
+#include <algorithm>
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "../TextureTable.h"
+
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+static constexpr uint32_t MIN_OBJECT_CAPACITY = 256;
+//phase index in cull.comp, also selects the commands and counts region
+static constexpr uint32_t EARLY_PHASE = 0;
+static constexpr uint32_t LATE_PHASE = 1;
+static constexpr uint32_t CULL_PHASES = 2;
+//VkDispatchIndirectCommand of each phase padded to a uvec4, the queued object indices follow
+static constexpr uint32_t MESHLET_DISPATCH_STRIDE = 4;
+
+IndirectRenderSystem::IndirectRenderSystem(Device &_device, GeometryPool &_geometryPool, VkRenderPass renderPass,
+                                           VkDescriptorSetLayout _globalDescriptorSetLayout, const TextureTable &_textures,
+                                           VkExtent2D _depthExtent, bool _depthPrePass, Logger &_log)
+        : device(_device), geometryPool(_geometryPool), log(_log) {
+    depthPyramid = std::make_unique<DepthPyramid>(device, _depthExtent, log);
+    reserveVisibility(MIN_OBJECT_CAPACITY);
+    createDescriptors();
+    createPipelineLayout(_globalDescriptorSetLayout);
+    createPipelines(renderPass, _textures, _depthPrePass);
+}
+
+IndirectRenderSystem::~IndirectRenderSystem() {
+    vkDestroyPipelineLayout(device.getDevice(), drawPipelineLayout, nullptr);
+}
+
+void IndirectRenderSystem::createDescriptors() {
+    descriptorPool = lve::LveDescriptorPool::Builder(device)
+            .setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT * 8)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+            .build();
+
+    cullSetLayout = lve::LveDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(5, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .addBinding(8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+            .build();
+
+    objectsSetLayout = lve::LveDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+            .build();
+
+    for (auto &frame : frames)
+        reserve(frame, MIN_OBJECT_CAPACITY, MIN_OBJECT_CAPACITY, geometryPool.getBlockCount());
+}
+
+void IndirectRenderSystem::createPipelineLayout(VkDescriptorSetLayout _globalDescriptorSetLayout) {
+    std::vector<VkDescriptorSetLayout> drawSetLayouts{_globalDescriptorSetLayout, objectsSetLayout->getDescriptorSetLayout()};
+
+    VkPipelineLayoutCreateInfo drawLayoutInfo{};
+    drawLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    drawLayoutInfo.setLayoutCount = static_cast<uint32_t>(drawSetLayouts.size());
+    drawLayoutInfo.pSetLayouts = drawSetLayouts.data();
+    drawLayoutInfo.pushConstantRangeCount = 0;
+    drawLayoutInfo.pPushConstantRanges = nullptr;
+    if (vkCreatePipelineLayout(device.getDevice(), &drawLayoutInfo, nullptr, &drawPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create indirect draw pipeline layout!");
+    }
+}
+
+void IndirectRenderSystem::createPipelines(VkRenderPass renderPass, const TextureTable &_textures, bool _depthPrePass) {
+    cullPipeline = std::make_unique<ComputePipeline>(device, "shaders/cull.comp.spv",
+                                                     std::vector<VkDescriptorSetLayout>{cullSetLayout->getDescriptorSetLayout()},
+                                                     sizeof(CullPushConstants), log);
+    meshletCullPipeline = std::make_unique<ComputePipeline>(device, "shaders/meshlet_cull.comp.spv",
+                                                            std::vector<VkDescriptorSetLayout>{cullSetLayout->getDescriptorSetLayout()},
+                                                            sizeof(CullPushConstants), log);
+
+    PipelineConfigInfo pipelineConfig{};
+    if (_depthPrePass)
+        Pipeline::getDepthEqualPipelineInfo(pipelineConfig);
+    else
+        Pipeline::getDefaultPipelineInfo(pipelineConfig);
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.pipelineLayoutInfo = drawPipelineLayout;
+    pipelineConfig.fragmentSpecializationInfo = _textures.getSpecializationInfo();
+    drawPipeline = std::make_unique<Pipeline>(
+            device,
+            "shaders/indirect.vert.spv",
+            _textures.isBindless() ? "shaders/indirect.bindless.frag.spv" : "shaders/indirect.frag.spv",
+            pipelineConfig,
+            log);
+
+    if (!_depthPrePass)
+        return;
+
+    assert(geometryPool.hasPositionStream() && "depth pre-pass needs a geometry pool with a position stream");
+    PipelineConfigInfo depthConfig{};
+    Pipeline::getDepthPrePassPipelineInfo(depthConfig);
+    depthConfig.renderPass = renderPass;
+    depthConfig.pipelineLayoutInfo = drawPipelineLayout;
+    depthPipeline = std::make_unique<Pipeline>(
+            device,
+            "shaders/indirect_depth.vert.spv",
+            "",
+            depthConfig,
+            log);
+}
+
+void IndirectRenderSystem::reserve(FrameResources &_frame, uint32_t _objectCount, uint32_t _drawCount, uint32_t _blockCount) {
+    if (_objectCount <= _frame.objectCapacity && _drawCount <= _frame.drawCapacity && _blockCount <= _frame.blockCapacity)
+        return;
+
+    if (_objectCount > _frame.objectCapacity)
+        _frame.objectCapacity = std::max({_objectCount, _frame.objectCapacity * 2, MIN_OBJECT_CAPACITY});
+    if (_drawCount > _frame.drawCapacity)
+        _frame.drawCapacity = std::max({_drawCount, _frame.drawCapacity * 2, MIN_OBJECT_CAPACITY});
+    _frame.blockCapacity = std::max(_blockCount, _frame.blockCapacity);
+
+    _frame.objectsBuffer = std::make_unique<Buffer>(device,
+                                                    sizeof(GpuObjectData),
+                                                    _frame.objectCapacity,
+                                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+    _frame.objectsBuffer->map();
+    _frame.dirtyObjects.markAll();
+
+    //a full region per block and phase, compaction needs room for every object and meshlet landing in the same one
+    _frame.commandsBuffer = std::make_unique<Buffer>(device,
+                                                     sizeof(VkDrawIndexedIndirectCommand),
+                                                     _frame.drawCapacity * _frame.blockCapacity * CULL_PHASES,
+                                                     VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    _frame.countsBuffer = std::make_unique<Buffer>(device,
+                                                   sizeof(uint32_t),
+                                                   _frame.blockCapacity * CULL_PHASES,
+                                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    //every object is queued at most once per phase
+    _frame.meshletTasksBuffer = std::make_unique<Buffer>(device,
+                                                         sizeof(uint32_t),
+                                                         (MESHLET_DISPATCH_STRIDE + _frame.objectCapacity) * CULL_PHASES,
+                                                         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (_frame.uniformBuffer == nullptr) {
+        _frame.uniformBuffer = std::make_unique<Buffer>(device,
+                                                        sizeof(CullUniforms),
+                                                        1,
+                                                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        _frame.uniformBuffer->map();
+        _frame.statsBuffer = std::make_unique<Buffer>(device,
+                                                      sizeof(OcclusionCullingStats),
+                                                      1,
+                                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        _frame.statsBuffer->map();
+    }
+
+    writeDescriptors(_frame);
+}
+
+void IndirectRenderSystem::reserveVisibility(uint32_t _entryCount) {
+    if (_entryCount <= visibilityCapacity)
+        return;
+
+    //the other frame in flight reads and writes it too
+    if (visibilityBuffer != nullptr)
+        vkDeviceWaitIdle(device.getDevice());
+
+    visibilityCapacity = std::max({_entryCount, visibilityCapacity * 2, MIN_OBJECT_CAPACITY});
+    visibilityBuffer = std::make_unique<Buffer>(device,
+                                                sizeof(uint32_t),
+                                                visibilityCapacity,
+                                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    visibilityCleared = false;
+
+    for (auto &frame : frames) {
+        if (frame.cullDescriptorSet != VK_NULL_HANDLE)
+            writeDescriptors(frame);
+    }
+}
+
+void IndirectRenderSystem::writeDescriptors(FrameResources &_frame) {
+    auto objectsInfo = _frame.objectsBuffer->descriptorInfo();
+    auto commandsInfo = _frame.commandsBuffer->descriptorInfo();
+    auto countsInfo = _frame.countsBuffer->descriptorInfo();
+    auto visibilityInfo = visibilityBuffer->descriptorInfo();
+    auto statsInfo = _frame.statsBuffer->descriptorInfo();
+    auto uniformInfo = _frame.uniformBuffer->descriptorInfo();
+    auto pyramidInfo = depthPyramid->descriptorInfo();
+    auto meshletsInfo = geometryPool.getMeshletBuffer().descriptorInfo();
+    auto meshletTasksInfo = _frame.meshletTasksBuffer->descriptorInfo();
+    meshletCapacity = geometryPool.getMeshletCapacity();
+
+    lve::LveDescriptorWriter cullWriter{*cullSetLayout, *descriptorPool};
+    cullWriter.writeBuffer(0, &objectsInfo)
+            .writeBuffer(1, &commandsInfo)
+            .writeBuffer(2, &countsInfo)
+            .writeBuffer(3, &visibilityInfo)
+            .writeBuffer(4, &statsInfo)
+            .writeBuffer(5, &uniformInfo)
+            .writeImage(6, &pyramidInfo)
+            .writeBuffer(7, &meshletsInfo)
+            .writeBuffer(8, &meshletTasksInfo);
+    lve::LveDescriptorWriter objectsWriter{*objectsSetLayout, *descriptorPool};
+    objectsWriter.writeBuffer(0, &objectsInfo);
+
+    if (_frame.cullDescriptorSet == VK_NULL_HANDLE) {
+        if (!cullWriter.build(_frame.cullDescriptorSet) || !objectsWriter.build(_frame.objectsDescriptorSet))
+            throw std::runtime_error("cant allocate indirect rendering descriptors");
+    } else {
+        cullWriter.overwrite(_frame.cullDescriptorSet);
+        objectsWriter.overwrite(_frame.objectsDescriptorSet);
+    }
+}
+
+void IndirectRenderSystem::extractFrustumPlanes(const glm::mat4 &_projectionView, glm::vec4 _planes[6]) {
+    //rows of the combined matrix, glm stores columns
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+        rows[i] = {_projectionView[0][i], _projectionView[1][i], _projectionView[2][i], _projectionView[3][i]};
+
+    //depth is in [0, 1], so the near plane is the third row alone
+    _planes[0] = rows[3] + rows[0];
+    _planes[1] = rows[3] - rows[0];
+    _planes[2] = rows[3] + rows[1];
+    _planes[3] = rows[3] - rows[1];
+    _planes[4] = rows[2];
+    _planes[5] = rows[3] - rows[2];
+
+    for (int i = 0; i < 6; ++i)
+        _planes[i] /= glm::length(glm::vec3(_planes[i]));
+}
+
+void IndirectRenderSystem::rebuildObjects(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects) {
+    auto objectCount = static_cast<uint32_t>(gameObjects.size());
+    objectsList.assign(objectCount, GpuObjectData{});
+    meshletTotal = 0;
+
+    //meshlet visibility follows the objects' in scene order. every object keeps room for the meshlets of its largest
+    //level, so switching levels moves no one else's, it stays put while the scene does
+    uint32_t meshletVisibility = objectCount;
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        const Model &mesh = *gameObjects[i].mesh;
+        objectsList[i].meshletVisibility = meshletVisibility;
+        uint32_t maxMeshlets = 0;
+        for (uint32_t lod = 0; lod < mesh.getLodCount(); ++lod)
+            maxMeshlets = std::max(maxMeshlets, mesh.getLod(lod).meshletCount);
+        meshletVisibility += maxMeshlets;
+        updateObject(_frameInfo, i, gameObjects[i]);
+    }
+    visibilityEntries = meshletVisibility;
+}
+
+void IndirectRenderSystem::updateObject(const FrameInfo &_frameInfo, uint32_t _index, const Object &_object) {
+    const Model &mesh = *_object.mesh;
+    const auto &geometry = mesh.getGeometry();
+    const auto &lod = mesh.getLod(_object.lod);
+
+    GpuObjectData &data = objectsList[_index];
+    meshletTotal = meshletTotal - data.meshletCount + lod.meshletCount;
+    //the sphere lives in the quantized space of the vertices, like the model matrix that includes the dequantization
+    data.modelMatrix = _frameInfo.sceneGraph.getWorldMatrix(_index) * mesh.getDequantizationMatrix();
+    data.normalMatrix = _frameInfo.sceneGraph.getNormalMatrix(_index);
+    data.boundingSphere = mesh.getQuantizedBoundingSphere();
+    data.firstIndex = geometry.firstIndex + lod.firstIndex;
+    data.indexCount = lod.indexCount;
+    data.vertexOffset = static_cast<int32_t>(geometry.vertexOffset);
+    data.block = geometry.block;
+    data.firstMeshlet = geometry.firstMeshlet + lod.firstMeshlet;
+    data.meshletCount = lod.meshletCount;
+    data.textureIndex = _frameInfo.textureTable.getIndex(mesh.getSharedTexture().get());
+}
+
+void IndirectRenderSystem::cullGameObjects(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects, VkExtent2D _depthExtent) {
+    auto &frame = frames[_frameInfo.frameIndex];
+
+    //the fence of this frame was waited on, so what its last run counted is complete
+    if (frame.statsPending) {
+        frame.statsBuffer->invalidate();
+        stats = *static_cast<const OcclusionCullingStats *>(frame.statsBuffer->getMappedMemory());
+        frame.statsPending = false;
+    }
+
+    //descriptors may only change before this frame records anything that uses them. a grown meshlet buffer waited
+    //for the gpu, so no other frame is in flight either
+    bool meshletsMoved = geometryPool.getMeshletCapacity() != meshletCapacity;
+    if (depthPyramid->resize(_depthExtent) || meshletsMoved) {
+        for (auto &resources : frames)
+            writeDescriptors(resources);
+    }
+
+    //the changes reach objectsList once, and every frame's buffer the next time that frame is recorded
+    const auto &changes = _frameInfo.changedObjects;
+    if (changes.isAllDirty() || objectsList.size() != gameObjects.size()) {
+        rebuildObjects(_frameInfo, gameObjects);
+        for (auto &resources : frames)
+            resources.dirtyObjects.markAll();
+    } else {
+        for (uint32_t object : changes.getList()) {
+            updateObject(_frameInfo, object, gameObjects[object]);
+            for (auto &resources : frames)
+                resources.dirtyObjects.mark(object);
+        }
+    }
+
+    frame.objectCount = static_cast<uint32_t>(objectsList.size());
+    frame.blockCount = geometryPool.getBlockCount();
+    frame.drawCount = frame.objectCount + meshletTotal;
+    reserveVisibility(visibilityEntries);
+    reserve(frame, frame.objectCount, frame.drawCount, frame.blockCount);
+
+    auto *objectsData = static_cast<GpuObjectData *>(frame.objectsBuffer->getMappedMemory());
+    if (frame.dirtyObjects.isAllDirty()) {
+        std::copy(objectsList.begin(), objectsList.end(), objectsData);
+        frame.objectsBuffer->flush();
+    } else if (!frame.dirtyObjects.empty()) {
+        for (uint32_t object : frame.dirtyObjects.getList())
+            objectsData[object] = objectsList[object];
+        frame.objectsBuffer->flush();
+    }
+    frame.dirtyObjects.clear();
+
+    CullUniforms uniforms{};
+    uniforms.projectionView = _frameInfo.camera.getProjectionMatrix() * _frameInfo.camera.getViewMatrix();
+    extractFrustumPlanes(uniforms.projectionView, uniforms.frustumPlanes);
+    uniforms.cameraPosition = glm::inverse(_frameInfo.camera.getViewMatrix())[3];
+    uniforms.pyramidSize = {static_cast<float>(depthPyramid->getExtent().width), static_cast<float>(depthPyramid->getExtent().height)};
+    uniforms.pyramidLevels = depthPyramid->getLevelCount();
+    uniforms.objectCount = frame.objectCount;
+    uniforms.maxDrawsPerBlock = frame.drawCapacity;
+    uniforms.blockStride = frame.blockCapacity;
+    frame.uniformBuffer->writeToBuffer(&uniforms);
+    frame.uniformBuffer->flush();
+
+    VkCommandBuffer commandBuffer = _frameInfo.commandBuffer;
+
+    vkCmdFillBuffer(commandBuffer, frame.countsBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+    //without the count variant every slot is drawn, so unused ones must stay zero draws
+    if (!device.getFeatures().drawIndirectCount)
+        vkCmdFillBuffer(commandBuffer, frame.commandsBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(commandBuffer, frame.statsBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+    //no groups in x, one in y and z, cull.comp counts the queued objects into x
+    const uint32_t meshletDispatches[MESHLET_DISPATCH_STRIDE * CULL_PHASES] = {0, 1, 1, 0, 0, 1, 1, 0};
+    vkCmdUpdateBuffer(commandBuffer, frame.meshletTasksBuffer->getBuffer(), 0, sizeof(meshletDispatches), meshletDispatches);
+    //a fresh visibility buffer means nothing was seen yet, the late phase draws everything that passes
+    if (!visibilityCleared) {
+        vkCmdFillBuffer(commandBuffer, visibilityBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+        visibilityCleared = true;
+    }
+
+    //also orders the visibility writes of the previous frame's late phase before this read
+    ComputePipeline::barrier(commandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    dispatchCulling(commandBuffer, frame, EARLY_PHASE);
+    ComputePipeline::computeToIndirect(commandBuffer);
+    //compute push constants share their state with the graphics ones
+    _frameInfo.recorder.invalidate();
+}
+
+void IndirectRenderSystem::cullOccludedGameObjects(const FrameInfo &_frameInfo, VkImageView _depthView) {
+    auto &frame = frames[_frameInfo.frameIndex];
+    VkCommandBuffer commandBuffer = _frameInfo.commandBuffer;
+
+    depthPyramid->build(commandBuffer, _frameInfo.frameIndex, _depthView);
+
+    dispatchCulling(commandBuffer, frame, LATE_PHASE);
+    ComputePipeline::computeToIndirect(commandBuffer);
+    ComputePipeline::computeToHost(commandBuffer);
+    frame.statsPending = true;
+    _frameInfo.recorder.invalidate();
+}
+
+void IndirectRenderSystem::dispatchCulling(VkCommandBuffer commandBuffer, FrameResources &_frame, uint32_t _phase) {
+    CullPushConstants push{};
+    push.phase = _phase;
+
+    cullPipeline->bind(commandBuffer);
+    cullPipeline->bindDescriptorSets(commandBuffer, {_frame.cullDescriptorSet});
+    cullPipeline->pushConstants(commandBuffer, &push, sizeof(CullPushConstants));
+    ComputePipeline::dispatchThreads(commandBuffer, _frame.objectCount, CULL_GROUP_SIZE);
+
+    //the queued objects and their group count, the draw commands and counts are appended to
+    ComputePipeline::barrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    meshletCullPipeline->bind(commandBuffer);
+    meshletCullPipeline->bindDescriptorSets(commandBuffer, {_frame.cullDescriptorSet});
+    meshletCullPipeline->pushConstants(commandBuffer, &push, sizeof(CullPushConstants));
+    ComputePipeline::dispatchIndirect(commandBuffer, _frame.meshletTasksBuffer->getBuffer(),
+                                      sizeof(uint32_t) * MESHLET_DISPATCH_STRIDE * _phase);
+}
+
+void IndirectRenderSystem::renderGameObjects(const FrameInfo &_frameInfo) {
+    drawPhase(_frameInfo, EARLY_PHASE);
+}
+
+void IndirectRenderSystem::renderLateGameObjects(const FrameInfo &_frameInfo) {
+    drawPhase(_frameInfo, LATE_PHASE);
+}
+
+void IndirectRenderSystem::drawPhase(const FrameInfo &_frameInfo, uint32_t _phase) {
+    auto &frame = frames[_frameInfo.frameIndex];
+    CommandRecorder &recorder = _frameInfo.recorder;
+
+    //both pipelines share the layout, the sets stay bound across the switch
+    VkDescriptorSet descriptorSets[] = {_frameInfo.globalDescriptorSet, frame.objectsDescriptorSet};
+    recorder.bindDescriptorSets(drawPipelineLayout, 0, 2, descriptorSets);
+
+    if (depthPipeline) {
+        depthPipeline->bind(recorder);
+        drawBlocks(recorder, frame, _phase, true);
+    }
+    drawPipeline->bind(recorder);
+    drawBlocks(recorder, frame, _phase, false);
+}
+
+void IndirectRenderSystem::drawBlocks(CommandRecorder &_recorder, FrameResources &_frame, uint32_t _phase, bool _positionsOnly) {
+    //recording cost depends on the number of pool blocks, not on the number of objects
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    const DeviceFeatures &features = device.getFeatures();
+    for (uint32_t block = 0; block < _frame.blockCount; ++block) {
+        if (_positionsOnly)
+            geometryPool.bindPositions(_recorder, block);
+        else
+            geometryPool.bind(_recorder, block);
+
+        uint32_t region = _phase * _frame.blockCapacity + block;
+        VkDeviceSize commandsOffset = static_cast<VkDeviceSize>(region) * _frame.drawCapacity * stride;
+        if (features.drawIndirectCount) {
+            //devices with the count draws report a limit far above any scene, the clamp only keeps the call valid
+            _recorder.drawIndexedIndirectCount(_frame.commandsBuffer->getBuffer(), commandsOffset,
+                                               _frame.countsBuffer->getBuffer(), region * sizeof(uint32_t),
+                                               std::min(_frame.drawCount, features.maxDrawIndirectCount), stride);
+            continue;
+        }
+        //every slot of the region is drawn, in calls of at most the device limit
+        for (uint32_t first = 0; first < _frame.drawCount; first += features.maxDrawIndirectCount) {
+            uint32_t count = std::min(_frame.drawCount - first, features.maxDrawIndirectCount);
+            _recorder.drawIndexedIndirect(_frame.commandsBuffer->getBuffer(), commandsOffset + static_cast<VkDeviceSize>(first) * stride,
+                                          count, stride);
+        }
+    }
+}
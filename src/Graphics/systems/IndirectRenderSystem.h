@@ -0,0 +1,176 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <vector>
+#include "../Pipeline.h"
+#include "../ComputePipeline.h"
+#include "../Descriptors.h"
+#include "../GeometryPool.h"
+#include "../SwapChain.h"
+#include "../FrameInfo.h"
+#include "../DepthPyramid.h"
+#include "../DirtyObjects.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_TO_ZERO
+#include <glm/ext/matrix_float4x4.hpp>
+
+//matches ObjectData in indirect.vert, cull.comp and meshlet_cull.comp (std430)
+struct GpuObjectData{
+    glm::mat4 modelMatrix{1.0f};
+    glm::mat4 normalMatrix{1.0f};
+    glm::vec4 boundingSphere{0.0f};
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+    uint32_t block = 0;
+    //meshlets of the drawn level in the pool's meshlet buffer, none means the object is drawn whole
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletCount = 0;
+    //where the visibility of the first meshlet is kept, the objects' own entries come first
+    uint32_t meshletVisibility = 0;
+    //slot of the object's texture in the TextureTable
+    uint32_t textureIndex = 0;
+};
+
+//matches Uniforms in cull.comp and meshlet_cull.comp (std140)
+struct CullUniforms{
+    glm::mat4 projectionView{1.0f};
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 cameraPosition{0.0f};
+    glm::vec2 pyramidSize{0.0f};
+    uint32_t pyramidLevels = 0;
+    uint32_t objectCount = 0;
+    uint32_t maxDrawsPerBlock = 0;
+    uint32_t blockStride = 0;
+};
+
+struct CullPushConstants{
+    uint32_t phase = 0;
+};
+
+//written by cull.comp and meshlet_cull.comp, read back once the frame that produced it has finished.
+//objects split into meshlets count as objects only when their bounds leave the frustum, the rest is counted per meshlet
+struct OcclusionCullingStats{
+    uint32_t frustumCulled = 0;
+    uint32_t occlusionCulled = 0;
+    uint32_t drawnEarly = 0;
+    uint32_t drawnLate = 0;
+    uint32_t trianglesFrustumCulled = 0;
+    uint32_t trianglesOcclusionCulled = 0;
+    uint32_t trianglesDrawn = 0;
+    uint32_t meshletsDrawn = 0;
+    uint32_t meshletsFrustumCulled = 0;
+    uint32_t meshletsBackfaceCulled = 0;
+    uint32_t meshletsOcclusionCulled = 0;
+    uint32_t trianglesBackfaceCulled = 0;
+    uint32_t padding[4] = {};
+};
+
+//gpu driven path: per object transforms and bounds live in a storage buffer, compute passes cull them and write
+//compacted indirect draws, one indirect draw per pool block and phase.
+//occlusion culling runs in two phases: the objects visible last frame are drawn first, a depth pyramid is built
+//from what they wrote, then everything is tested against it and only newly visible objects are drawn on top.
+//objects whose level has meshlets are queued by cull.comp instead of drawn, meshlet_cull.comp then runs a workgroup
+//per queued object through an indirect dispatch and tests every meshlet like an object, plus its normal cone, with
+//visibility of its own. every surviving meshlet is one command of the same indirect draw
+class IndirectRenderSystem {
+public:
+    //with _depthPrePass every phase first draws its objects depth only from the pool's position stream,
+    //then shades them with an EQUAL depth test so every pixel runs the fragment shader once.
+    //_textures sizes the texture array of the fragment shader
+    IndirectRenderSystem(Device &_device, GeometryPool &_geometryPool, VkRenderPass renderPass,
+                         VkDescriptorSetLayout _globalDescriptorSetLayout, const TextureTable &_textures,
+                         VkExtent2D _depthExtent, bool _depthPrePass, Logger &_log);
+    ~IndirectRenderSystem();
+
+    IndirectRenderSystem(const IndirectRenderSystem &) = delete;
+    IndirectRenderSystem &operator=(const IndirectRenderSystem &) = delete;
+
+    //uploads the objects that changed and records the early culling dispatch, call before the scene render pass begins
+    void cullGameObjects(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects, VkExtent2D _depthExtent);
+    //draws what the early phase kept, inside the scene pass
+    void renderGameObjects(const FrameInfo &_frameInfo);
+    //builds the depth pyramid from the scene pass depth and records the late culling dispatch, call between the passes
+    void cullOccludedGameObjects(const FrameInfo &_frameInfo, VkImageView _depthView);
+    //draws objects that became visible this frame, inside the overlay pass
+    void renderLateGameObjects(const FrameInfo &_frameInfo);
+
+    //counts of the most recent finished frame
+    const OcclusionCullingStats &getStats() const { return stats; }
+
+    static void extractFrustumPlanes(const glm::mat4 &_projectionView, glm::vec4 _planes[6]);
+
+private:
+    struct FrameResources {
+        std::unique_ptr<Buffer> objectsBuffer;
+        std::unique_ptr<Buffer> commandsBuffer;
+        std::unique_ptr<Buffer> countsBuffer;
+        std::unique_ptr<Buffer> uniformBuffer;
+        std::unique_ptr<Buffer> statsBuffer;
+        //dispatch arguments for meshlet_cull.comp of both phases, then the objects queued for it
+        std::unique_ptr<Buffer> meshletTasksBuffer;
+        uint32_t objectCapacity = 0;
+        //draws a block region has room for, objects plus meshlets
+        uint32_t drawCapacity = 0;
+        uint32_t blockCapacity = 0;
+        uint32_t objectCount = 0;
+        uint32_t drawCount = 0;
+        uint32_t blockCount = 0;
+        //objects whose entry in objectsBuffer differs from objectsList
+        DirtyObjects dirtyObjects;
+        bool statsPending = false;
+        VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+        VkDescriptorSet objectsDescriptorSet = VK_NULL_HANDLE;
+    };
+
+    void createDescriptors();
+    void createPipelineLayout(VkDescriptorSetLayout _globalDescriptorSetLayout);
+    void createPipelines(VkRenderPass renderPass, const TextureTable &_textures, bool _depthPrePass);
+    //recomputes every entry of objectsList, the meshlet total and where every object's meshlet visibility lives
+    void rebuildObjects(const FrameInfo &_frameInfo, SlotMap<Object> &gameObjects);
+    //recomputes the entry of one object, its meshlet visibility stays where it is
+    void updateObject(const FrameInfo &_frameInfo, uint32_t _index, const Object &_object);
+    //grows the buffers of one frame, safe because the frame's fence was already waited on. a new objects buffer
+    //is rewritten whole
+    void reserve(FrameResources &_frame, uint32_t _objectCount, uint32_t _drawCount, uint32_t _blockCount);
+    //the visibility buffer is shared by all frames, growing it waits for the gpu. one entry per object and meshlet
+    void reserveVisibility(uint32_t _entryCount);
+    void writeDescriptors(FrameResources &_frame);
+    void dispatchCulling(VkCommandBuffer commandBuffer, FrameResources &_frame, uint32_t _phase);
+    void drawPhase(const FrameInfo &_frameInfo, uint32_t _phase);
+    void drawBlocks(CommandRecorder &_recorder, FrameResources &_frame, uint32_t _phase, bool _positionsOnly);
+
+    Device &device;
+    GeometryPool &geometryPool;
+    Logger &log;
+
+    std::unique_ptr<lve::LveDescriptorPool> descriptorPool;
+    std::unique_ptr<lve::LveDescriptorSetLayout> cullSetLayout;
+    std::unique_ptr<lve::LveDescriptorSetLayout> objectsSetLayout;
+
+    VkPipelineLayout drawPipelineLayout;
+    std::unique_ptr<ComputePipeline> cullPipeline;
+    std::unique_ptr<ComputePipeline> meshletCullPipeline;
+    std::unique_ptr<Pipeline> drawPipeline;
+    //null without the depth pre-pass
+    std::unique_ptr<Pipeline> depthPipeline;
+
+    std::unique_ptr<DepthPyramid> depthPyramid;
+    std::unique_ptr<Buffer> visibilityBuffer;
+    uint32_t visibilityCapacity = 0;
+    bool visibilityCleared = false;
+    //capacity of the pool's meshlet buffer when the descriptors were written, it is replaced when it grows
+    uint32_t meshletCapacity = 0;
+
+    //what every frame's objects buffer should hold, only the entries of changed objects are recomputed
+    std::vector<GpuObjectData> objectsList;
+    //meshlets of the objects' current levels, kept up to date as levels change
+    uint32_t meshletTotal = 0;
+    //visibility entries of the objects and the room reserved for their meshlets
+    uint32_t visibilityEntries = 0;
+
+    FrameResources frames[SwapChain::MAX_FRAMES_IN_FLIGHT];
+    OcclusionCullingStats stats{};
+};
@@ -0,0 +1,194 @@
+#include "AssetPack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ContentHash.h"
+#include "Lz4.h"
+#include "../FileHelper.h"
+
+static constexpr char PACK_MAGIC[4] = {'S', 'P', 'A', 'K'};
+
+AssetPack::AssetPack(const std::string &_packPath) : packPath(_packPath) {
+    fd = open(packPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("failed to open asset pack: " + packPath);
+
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error("asset pack is too small: " + packPath);
+    }
+    mappedSize = static_cast<size_t>(fileStat.st_size);
+
+    mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("failed to map asset pack: " + packPath);
+    }
+
+    auto base = static_cast<const char *>(mapped);
+    header = reinterpret_cast<const Header *>(base);
+    bool valid = memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0
+            && header->version == VERSION
+            && header->tocOffset + header->entryCount * sizeof(Entry) <= mappedSize
+            && header->namesOffset + header->namesSize <= mappedSize;
+    if (!valid) {
+        munmap(mapped, mappedSize);
+        close(fd);
+        throw std::runtime_error("invalid asset pack: " + packPath);
+    }
+
+    entries = reinterpret_cast<const Entry *>(base + header->tocOffset);
+    names = base + header->namesOffset;
+}
+
+AssetPack::~AssetPack() {
+    munmap(mapped, mappedSize);
+    close(fd);
+}
+
+const AssetPack::Entry *AssetPack::find(const std::string &_path) const {
+    std::string name = normalizePath(_path);
+
+    auto compare = [this](const Entry &entry, const std::string &value) {
+        size_t length = std::min<size_t>(entry.nameLength, value.size());
+        int res = memcmp(names + entry.nameOffset, value.data(), length);
+        return res < 0 || (res == 0 && entry.nameLength < value.size());
+    };
+
+    const Entry *end = entries + header->entryCount;
+    const Entry *it = std::lower_bound(entries, end, name, compare);
+    if (it == end || it->nameLength != name.size() || memcmp(names + it->nameOffset, name.data(), name.size()) != 0)
+        return nullptr;
+    return it;
+}
+
+std::string AssetPack::getName(const Entry &_entry) const {
+    return {names + _entry.nameOffset, _entry.nameLength};
+}
+
+void AssetPack::readInto(const Entry &_entry, char *dst) const {
+    if (_entry.dataOffset + _entry.storedSize > mappedSize)
+        throw std::runtime_error("asset pack entry out of bounds: " + getName(_entry));
+
+    const char *src = static_cast<const char *>(mapped) + _entry.dataOffset;
+    if (_entry.compression == COMPRESSION_LZ4) {
+        if (!Lz4::decompress(src, _entry.storedSize, dst, _entry.originalSize))
+            throw std::runtime_error("corrupted asset pack entry: " + getName(_entry));
+    } else {
+        memcpy(dst, src, _entry.originalSize);
+    }
+
+#ifndef NDEBUG
+    if (ContentHash::hash64(dst, _entry.originalSize) != _entry.contentHash)
+        throw std::runtime_error("asset pack entry hash mismatch: " + getName(_entry));
+#endif
+}
+
+std::vector<char> AssetPack::read(const Entry &_entry) const {
+    std::vector<char> buffer(_entry.originalSize);
+    readInto(_entry, buffer.data());
+    return buffer;
+}
+
+uint32_t AssetPack::verify() const {
+    uint32_t damaged = 0;
+    std::vector<char> buffer;
+    for (uint32_t i = 0; i < header->entryCount; ++i) {
+        buffer.resize(entries[i].originalSize);
+        try {
+            readInto(entries[i], buffer.data());
+            if (ContentHash::hash64(buffer.data(), buffer.size()) != entries[i].contentHash)
+                damaged++;
+        } catch (const std::runtime_error &) {
+            damaged++;
+        }
+    }
+    return damaged;
+}
+
+std::string AssetPack::normalizePath(const std::string &_path) {
+    size_t start = 0;
+    while (_path.compare(start, 2, "./") == 0)
+        start += 2;
+    return _path.substr(start);
+}
+
+void AssetPack::write(const std::string &_packPath, std::vector<std::pair<std::string, std::string>> _files, bool _compress) {
+    for (auto &file : _files)
+        file.first = normalizePath(file.first);
+    std::sort(_files.begin(), _files.end());
+    for (size_t i = 1; i < _files.size(); ++i) {
+        if (_files[i].first == _files[i - 1].first)
+            throw std::runtime_error("duplicate asset pack entry: " + _files[i].first);
+    }
+
+    std::ofstream out(_packPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        throw std::runtime_error("failed to create asset pack: " + _packPath);
+
+    auto padTo = [&out](uint64_t alignment) {
+        uint64_t position = static_cast<uint64_t>(out.tellp());
+        uint64_t padding = (alignment - position % alignment) % alignment;
+        static const char zeros[DATA_ALIGNMENT] = {};
+        out.write(zeros, static_cast<std::streamsize>(padding));
+    };
+
+    Header header{};
+    memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = VERSION;
+    header.entryCount = static_cast<uint32_t>(_files.size());
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    std::vector<Entry> entriesList;
+    std::string namesBlob;
+    std::vector<char> compressed;
+
+    for (const auto &file : _files) {
+        auto bytes = FileHelper::readFile(file.second);
+
+        Entry entry{};
+        entry.nameOffset = static_cast<uint32_t>(namesBlob.size());
+        entry.nameLength = static_cast<uint32_t>(file.first.size());
+        entry.originalSize = bytes.size();
+        entry.contentHash = ContentHash::hash64(bytes.data(), bytes.size());
+        namesBlob += file.first;
+
+        const char *data = bytes.data();
+        entry.storedSize = bytes.size();
+        entry.compression = COMPRESSION_NONE;
+        if (_compress) {
+            Lz4::compress(bytes.data(), bytes.size(), compressed);
+            //already compressed formats like png dont shrink, keep those raw so reads are a plain copy
+            if (compressed.size() < bytes.size() - bytes.size() / 16) {
+                data = compressed.data();
+                entry.storedSize = compressed.size();
+                entry.compression = COMPRESSION_LZ4;
+            }
+        }
+
+        padTo(DATA_ALIGNMENT);
+        entry.dataOffset = static_cast<uint64_t>(out.tellp());
+        out.write(data, static_cast<std::streamsize>(entry.storedSize));
+        entriesList.push_back(entry);
+    }
+
+    padTo(alignof(Entry));
+    header.tocOffset = static_cast<uint64_t>(out.tellp());
+    out.write(reinterpret_cast<const char *>(entriesList.data()), static_cast<std::streamsize>(entriesList.size() * sizeof(Entry)));
+    header.namesOffset = static_cast<uint64_t>(out.tellp());
+    header.namesSize = namesBlob.size();
+    out.write(namesBlob.data(), static_cast<std::streamsize>(namesBlob.size()));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!out.good())
+        throw std::runtime_error("failed to write asset pack: " + _packPath);
+}
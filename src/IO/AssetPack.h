@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//single file archive: header, 4K aligned entry data, then a table of contents sorted by path.
+//the whole file is mmapped and entries are looked up with a binary search, one open for every asset
+class AssetPack {
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t DATA_ALIGNMENT = 4096;
+
+    enum Compression : uint32_t {
+        COMPRESSION_NONE = 0,
+        COMPRESSION_LZ4 = 1
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t tocOffset;
+        uint64_t namesOffset;
+        uint64_t namesSize;
+    };
+
+    struct Entry {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t compression;
+        uint32_t reserved;
+        uint64_t dataOffset;
+        uint64_t storedSize;
+        uint64_t originalSize;
+        uint64_t contentHash;
+    };
+
+    explicit AssetPack(const std::string &_packPath);
+    ~AssetPack();
+
+    AssetPack(const AssetPack &) = delete;
+    AssetPack &operator=(const AssetPack &) = delete;
+
+    const Entry *find(const std::string &_path) const;
+    std::string getName(const Entry &_entry) const;
+    //dst must hold entry.originalSize bytes
+    void readInto(const Entry &_entry, char *dst) const;
+    std::vector<char> read(const Entry &_entry) const;
+    //recomputes every content hash, returns the number of damaged entries
+    uint32_t verify() const;
+
+    uint32_t getEntryCount() const { return header->entryCount; }
+    const Entry &getEntry(uint32_t index) const { return entries[index]; }
+    const std::string &getPath() const { return packPath; }
+
+    //_files is a list of (name inside the pack, path on disk)
+    static void write(const std::string &_packPath, std::vector<std::pair<std::string, std::string>> _files, bool _compress = true);
+    //strips leading "./" so "./models/cube.obj" and "models/cube.obj" resolve to the same entry
+    static std::string normalizePath(const std::string &_path);
+
+private:
+    std::string packPath;
+    int fd = -1;
+    void *mapped = nullptr;
+    size_t mappedSize = 0;
+
+    const Header *header = nullptr;
+    const Entry *entries = nullptr;
+    const char *names = nullptr;
+};
@@ -0,0 +1,411 @@
+#include "BatchFileReader.h"
+#include "AssetPack.h"
+#include "../FileHelper.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define SPECTRARE_HAS_IO_URING 1
+#else
+#define SPECTRARE_HAS_IO_URING 0
+#endif
+
+static size_t alignUp(size_t _value, size_t _alignment) {
+    return (_value + _alignment - 1) & ~(_alignment - 1);
+}
+
+#if SPECTRARE_HAS_IO_URING
+
+//minimal io_uring wrapper over the raw syscalls so we dont depend on liburing
+struct BatchFileReader::Uring {
+    int ringFd = -1;
+
+    void *sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    void *cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t sqesSize = 0;
+
+    unsigned *sqTail = nullptr;
+    unsigned *sqMask = nullptr;
+    unsigned *sqArray = nullptr;
+    unsigned sqEntries = 0;
+
+    unsigned *cqHead = nullptr;
+    unsigned *cqTail = nullptr;
+    unsigned *cqMask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    bool init(uint32_t _depth) {
+        io_uring_params params{};
+        ringFd = static_cast<int>(syscall(__NR_io_uring_setup, _depth, &params));
+        if (ringFd < 0)
+            return false;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap)
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED)
+            return false;
+        cqRing = singleMap ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED)
+            return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED)
+            return false;
+
+        auto sqBase = static_cast<char *>(sqRing);
+        sqTail = reinterpret_cast<unsigned *>(sqBase + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned *>(sqBase + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sqBase + params.sq_off.array);
+        sqEntries = params.sq_entries;
+
+        auto cqBase = static_cast<char *>(cqRing);
+        cqHead = reinterpret_cast<unsigned *>(cqBase + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cqBase + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned *>(cqBase + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cqBase + params.cq_off.cqes);
+        return true;
+    }
+
+    ~Uring() {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+            munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED)
+            munmap(sqRing, sqRingSize);
+        if (ringFd >= 0)
+            close(ringFd);
+    }
+
+    //only the submitting thread touches the sq tail, the kernel publishes the head
+    void queueRead(int _fd, iovec *_iov, uint64_t _offset, uint64_t _userData) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+
+        io_uring_sqe &sqe = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = _fd;
+        sqe.addr = reinterpret_cast<uint64_t>(_iov);
+        sqe.len = 1;
+        sqe.off = _offset;
+        sqe.user_data = _userData;
+
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    int submitAndWait(unsigned _toSubmit, unsigned _minComplete) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, ringFd, _toSubmit, _minComplete, IORING_ENTER_GETEVENTS, nullptr, 0));
+    }
+
+    template<typename Func>
+    unsigned reap(Func &&_onCompletion) {
+        unsigned head = *cqHead;
+        unsigned reaped = 0;
+        while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe &cqe = cqes[head & *cqMask];
+            _onCompletion(cqe.user_data, cqe.res);
+            head++;
+            reaped++;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        return reaped;
+    }
+};
+
+#else
+
+struct BatchFileReader::Uring {
+    bool init(uint32_t) { return false; }
+};
+
+#endif
+
+BatchFileReader::BatchFileReader(ThreadPool &_workers, const Logger &_log, bool _preferIoUring, uint32_t _queueDepth)
+        : workers(_workers), log(_log), queueDepth(_queueDepth) {
+    if (!_preferIoUring)
+        return;
+
+    ring = std::make_unique<Uring>();
+    if (!ring->init(queueDepth)) {
+        log.printWarn("io_uring is not available, falling back to pread worker pool");
+        ring.reset();
+    }
+}
+
+BatchFileReader::~BatchFileReader() = default;
+
+void BatchFileReader::enqueue(const std::string &_path, DecodeCallback _onLoaded) {
+    Request request{};
+    request.path = _path;
+    request.onLoaded = std::move(_onLoaded);
+    request.pack = FileHelper::findMountedPack(_path);
+    requestsList.push_back(std::move(request));
+}
+
+void BatchFileReader::readAll() {
+    firstError = nullptr;
+
+    try {
+        if (ring)
+            readAllIoUring();
+        else
+            readAllPread();
+    } catch (...) {
+        //decoders already submitted still reference the requests
+        waitForJobs();
+        requestsList.clear();
+        throw;
+    }
+
+    waitForJobs();
+    requestsList.clear();
+
+    if (firstError)
+        std::rethrow_exception(firstError);
+}
+
+void BatchFileReader::openRequest(Request &_request) {
+    int flags = O_RDONLY | O_CLOEXEC;
+    _request.fd = directIO ? open(_request.path.c_str(), flags | O_DIRECT) : -1;
+    //tmpfs and some network filesystems reject O_DIRECT, use buffered reads there
+    if (_request.fd < 0)
+        _request.fd = open(_request.path.c_str(), flags);
+    if (_request.fd < 0)
+        throw std::runtime_error("failed to open file: " + _request.path);
+
+    struct stat fileStat{};
+    if (fstat(_request.fd, &fileStat) != 0) {
+        close(_request.fd);
+        throw std::runtime_error("failed to stat file: " + _request.path);
+    }
+
+    _request.fileSize = static_cast<size_t>(fileStat.st_size);
+    _request.bytesRead = 0;
+
+    //O_DIRECT needs both the address and the length aligned, so round the allocation up
+    size_t capacity = std::max(alignUp(_request.fileSize, IO_ALIGNMENT), IO_ALIGNMENT);
+    char *memory = static_cast<char *>(aligned_alloc(IO_ALIGNMENT, capacity));
+    if (!memory) {
+        close(_request.fd);
+        throw std::runtime_error("failed to allocate read buffer for: " + _request.path);
+    }
+    _request.blob.path = _request.path;
+    _request.blob.data.reset(memory);
+    _request.blob.size = _request.fileSize;
+}
+
+void BatchFileReader::readFromPack(Request &_request) {
+    const AssetPack::Entry *entry = _request.pack->find(_request.path);
+
+    size_t capacity = std::max(alignUp(entry->originalSize, IO_ALIGNMENT), IO_ALIGNMENT);
+    char *memory = static_cast<char *>(aligned_alloc(IO_ALIGNMENT, capacity));
+    if (!memory)
+        throw std::runtime_error("failed to allocate read buffer for: " + _request.path);
+
+    _request.blob.path = _request.path;
+    _request.blob.data.reset(memory);
+    _request.blob.size = entry->originalSize;
+    _request.pack->readInto(*entry, memory);
+}
+
+void BatchFileReader::readAllIoUring() {
+#if SPECTRARE_HAS_IO_URING
+    std::vector<iovec> iovecsList(requestsList.size());
+    size_t nextRequest = 0;
+    size_t completed = 0;
+    unsigned inFlight = 0;
+    unsigned toSubmit = 0;
+
+    auto queueNextChunk = [&](size_t _index) {
+        Request &request = requestsList[_index];
+        size_t capacity = std::max(alignUp(request.fileSize, IO_ALIGNMENT), IO_ALIGNMENT);
+        iovecsList[_index].iov_base = request.blob.data.get() + request.bytesRead;
+        iovecsList[_index].iov_len = capacity - request.bytesRead;
+        ring->queueRead(request.fd, &iovecsList[_index], request.bytesRead, _index);
+        inFlight++;
+        toSubmit++;
+    };
+
+    while (completed < requestsList.size()) {
+        while (nextRequest < requestsList.size() && inFlight < ring->sqEntries) {
+            size_t index = nextRequest++;
+            if (requestsList[index].pack) {
+                //already mapped, no io to wait for
+                Request *requestPtr = &requestsList[index];
+                submitJob([this, requestPtr] {
+                    try {
+                        readFromPack(*requestPtr);
+                        requestPtr->onLoaded(requestPtr->blob);
+                    } catch (...) {
+                        recordError(std::current_exception());
+                    }
+                });
+                completed++;
+                continue;
+            }
+            try {
+                openRequest(requestsList[index]);
+            } catch (...) {
+                recordError(std::current_exception());
+                completed++;
+                continue;
+            }
+            queueNextChunk(index);
+        }
+
+        if (inFlight == 0)
+            continue;
+
+        int res = ring->submitAndWait(toSubmit, 1);
+        if (res < 0) {
+            if (errno == EINTR)
+                continue;
+            int error = errno;
+            //reads queued but never submitted will not complete. the ones already in the kernel still target our
+            //buffers, drain them before bailing out
+            inFlight -= toSubmit;
+            while (inFlight > 0 && ring->submitAndWait(0, 1) >= 0)
+                inFlight -= ring->reap([](uint64_t, int) {});
+            //the unsubmitted entries stay in the submission queue, a later batch would send them to the kernel
+            log.printWarn("io_uring_enter failed (" + std::string(strerror(error)) + "), falling back to pread worker pool");
+            ring.reset();
+            //requests still open never completed, they and the ones never started are read again from the start
+            for (size_t i = 0; i < requestsList.size(); ++i) {
+                Request &request = requestsList[i];
+                if (i < nextRequest && request.fd < 0)
+                    continue;
+                if (request.fd >= 0) {
+                    close(request.fd);
+                    request.fd = -1;
+                }
+                readPread(request);
+            }
+            return;
+        }
+        toSubmit -= static_cast<unsigned>(res);
+
+        ring->reap([&](uint64_t _index, int _result) {
+            Request &request = requestsList[_index];
+            inFlight--;
+
+            if (_result > 0) {
+                request.bytesRead += static_cast<size_t>(_result);
+                if (request.bytesRead < request.fileSize) {
+                    //short read, the remainder goes out with the next io_uring_enter
+                    queueNextChunk(_index);
+                    return;
+                }
+            }
+
+            close(request.fd);
+            request.fd = -1;
+            completed++;
+
+            if (_result < 0) {
+                recordError(std::make_exception_ptr(std::runtime_error("failed to read file: " + request.path + " (" + strerror(-_result) + ")")));
+            } else if (request.bytesRead < request.fileSize) {
+                recordError(std::make_exception_ptr(std::runtime_error("unexpected end of file: " + request.path)));
+            } else {
+                dispatchDecode(request);
+            }
+        });
+    }
+#endif
+}
+
+void BatchFileReader::readAllPread() {
+    for (auto &request : requestsList)
+        readPread(request);
+}
+
+void BatchFileReader::readPread(Request &_request) {
+    Request *requestPtr = &_request;
+    submitJob([this, requestPtr] {
+        try {
+            if (requestPtr->pack) {
+                readFromPack(*requestPtr);
+                requestPtr->onLoaded(requestPtr->blob);
+                return;
+            }
+
+            openRequest(*requestPtr);
+            //O_DIRECT needs an aligned length as well, the buffer is rounded up for it and the last read stops at eof
+            size_t capacity = std::max(alignUp(requestPtr->fileSize, IO_ALIGNMENT), IO_ALIGNMENT);
+            while (requestPtr->bytesRead < requestPtr->fileSize) {
+                ssize_t res = pread(requestPtr->fd,
+                                    requestPtr->blob.data.get() + requestPtr->bytesRead,
+                                    capacity - requestPtr->bytesRead,
+                                    static_cast<off_t>(requestPtr->bytesRead));
+                if (res < 0 && errno == EINTR)
+                    continue;
+                if (res <= 0)
+                    break;
+                requestPtr->bytesRead += static_cast<size_t>(res);
+            }
+            close(requestPtr->fd);
+            requestPtr->fd = -1;
+            if (requestPtr->bytesRead < requestPtr->fileSize)
+                throw std::runtime_error("failed to read file: " + requestPtr->path);
+
+            requestPtr->onLoaded(requestPtr->blob);
+        } catch (...) {
+            recordError(std::current_exception());
+        }
+    });
+}
+
+void BatchFileReader::dispatchDecode(Request &_request) {
+    _request.blob.size = std::min(_request.bytesRead, _request.fileSize);
+    Request *requestPtr = &_request;
+    submitJob([this, requestPtr] {
+        try {
+            requestPtr->onLoaded(requestPtr->blob);
+        } catch (...) {
+            recordError(std::current_exception());
+        }
+    });
+}
+
+void BatchFileReader::submitJob(std::function<void()> _job) {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        pendingJobs++;
+    }
+    workers.submit([this, job = std::move(_job)] {
+        job();
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        if (--pendingJobs == 0)
+            jobsFinished.notify_all();
+    });
+}
+
+void BatchFileReader::waitForJobs() {
+    std::unique_lock<std::mutex> lock(jobsMutex);
+    jobsFinished.wait(lock, [this] { return pendingJobs == 0; });
+}
+
+void BatchFileReader::recordError(std::exception_ptr _error) {
+    std::lock_guard<std::mutex> lock(errorMutex);
+    if (!firstError)
+        firstError = _error;
+}
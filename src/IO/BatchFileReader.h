@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../Jobs/ThreadPool.h"
+#include "../Logger/Logger.h"
+
+class AssetPack;
+
+//page aligned so the same buffers can be used as O_DIRECT targets
+struct FileBlob {
+    struct FreeDeleter {
+        void operator()(char *ptr) const { free(ptr); }
+    };
+
+    std::string path;
+    std::unique_ptr<char, FreeDeleter> data;
+    size_t size = 0;
+};
+
+//reads many files at once and hands every completed file to a decoder running on the worker pool.
+//uses io_uring when the kernel provides it, otherwise falls back to blocking pread calls on the workers.
+//files inside a pack mounted through FileHelper are decompressed from the pack instead
+class BatchFileReader {
+public:
+    using DecodeCallback = std::function<void(FileBlob &blob)>;
+
+    static constexpr size_t IO_ALIGNMENT = 4096;
+
+    BatchFileReader(ThreadPool &_workers, const Logger &_log, bool _preferIoUring = true, uint32_t _queueDepth = 64);
+    ~BatchFileReader();
+
+    BatchFileReader(const BatchFileReader &) = delete;
+    BatchFileReader &operator=(const BatchFileReader &) = delete;
+
+    //bypass the page cache, buffers are already aligned; silently ignored by filesystems without support
+    void setDirectIO(bool _enabled) { directIO = _enabled; }
+    bool usesIoUring() const { return ring != nullptr; }
+
+    void enqueue(const std::string &_path, DecodeCallback _onLoaded);
+    //reads every enqueued file, runs the decoders and blocks until all of them are done.
+    //first decoder or read error is rethrown on the calling thread
+    void readAll();
+
+private:
+    struct Request {
+        std::string path;
+        DecodeCallback onLoaded;
+        const AssetPack *pack = nullptr;
+        int fd = -1;
+        size_t fileSize = 0;
+        size_t bytesRead = 0;
+        FileBlob blob;
+    };
+    struct Uring;
+
+    void openRequest(Request &_request);
+    void readFromPack(Request &_request);
+    void readAllIoUring();
+    void readAllPread();
+    //reads one request with blocking preads on a worker, from the start
+    void readPread(Request &_request);
+    void dispatchDecode(Request &_request);
+    //jobs of this reader only, readAll does not wait for anything else on the workers
+    void submitJob(std::function<void()> _job);
+    void waitForJobs();
+    void recordError(std::exception_ptr _error);
+
+    ThreadPool &workers;
+    Logger log;
+    std::unique_ptr<Uring> ring;
+    bool directIO = false;
+    uint32_t queueDepth;
+
+    std::vector<Request> requestsList;
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+    std::mutex jobsMutex;
+    std::condition_variable jobsFinished;
+    uint32_t pendingJobs = 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//XXH64, fast enough to hash every asset on load and stable across runs so it can be stored on disk
+class ContentHash {
+public:
+    static uint64_t hash64(const void *data, size_t size, uint64_t seed = 0) {
+        auto ptr = static_cast<const uint8_t *>(data);
+        auto end = ptr + size;
+        uint64_t hash;
+
+        if (size >= 32) {
+            uint64_t v1 = seed + PRIME1 + PRIME2;
+            uint64_t v2 = seed + PRIME2;
+            uint64_t v3 = seed;
+            uint64_t v4 = seed - PRIME1;
+            const uint8_t *limit = end - 32;
+            do {
+                v1 = round(v1, read64(ptr));
+                v2 = round(v2, read64(ptr + 8));
+                v3 = round(v3, read64(ptr + 16));
+                v4 = round(v4, read64(ptr + 24));
+                ptr += 32;
+            } while (ptr <= limit);
+
+            hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            hash = mergeRound(hash, v1);
+            hash = mergeRound(hash, v2);
+            hash = mergeRound(hash, v3);
+            hash = mergeRound(hash, v4);
+        } else {
+            hash = seed + PRIME5;
+        }
+
+        hash += static_cast<uint64_t>(size);
+
+        while (ptr + 8 <= end) {
+            hash ^= round(0, read64(ptr));
+            hash = rotl(hash, 27) * PRIME1 + PRIME4;
+            ptr += 8;
+        }
+        if (ptr + 4 <= end) {
+            hash ^= static_cast<uint64_t>(read32(ptr)) * PRIME1;
+            hash = rotl(hash, 23) * PRIME2 + PRIME3;
+            ptr += 4;
+        }
+        while (ptr < end) {
+            hash ^= (*ptr) * PRIME5;
+            hash = rotl(hash, 11) * PRIME1;
+            ptr++;
+        }
+
+        hash ^= hash >> 33;
+        hash *= PRIME2;
+        hash ^= hash >> 29;
+        hash *= PRIME3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+private:
+    static constexpr uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t read64(const uint8_t *ptr) { uint64_t v; memcpy(&v, ptr, sizeof(v)); return v; }
+    static uint32_t read32(const uint8_t *ptr) { uint32_t v; memcpy(&v, ptr, sizeof(v)); return v; }
+
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    static uint64_t mergeRound(uint64_t acc, uint64_t value) {
+        acc ^= round(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+};
@@ -0,0 +1,154 @@
+#include "Lz4.h"
+
+#include <cstdint>
+#include <cstring>
+
+static constexpr size_t MIN_MATCH = 4;
+//the format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+static constexpr size_t LAST_LITERALS = 5;
+static constexpr size_t MF_LIMIT = 12;
+static constexpr size_t MAX_OFFSET = 65535;
+static constexpr uint32_t HASH_LOG = 16;
+static constexpr uint32_t NO_POSITION = 0xFFFFFFFFu;
+
+static uint32_t read32(const uint8_t *ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+static void writeLength(std::vector<char> &dst, size_t length) {
+    while (length >= 255) {
+        dst.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    dst.push_back(static_cast<char>(length));
+}
+
+static void emitSequence(std::vector<char> &dst, const uint8_t *literals, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength - MIN_MATCH;
+    uint8_t token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+    token |= static_cast<uint8_t>(matchCode >= 15 ? 15 : matchCode);
+    dst.push_back(static_cast<char>(token));
+
+    if (literalLength >= 15)
+        writeLength(dst, literalLength - 15);
+    dst.insert(dst.end(), literals, literals + literalLength);
+
+    dst.push_back(static_cast<char>(offset & 0xFF));
+    dst.push_back(static_cast<char>(offset >> 8));
+    if (matchCode >= 15)
+        writeLength(dst, matchCode - 15);
+}
+
+void Lz4::compress(const char *src, size_t srcSize, std::vector<char> &dst) {
+    dst.clear();
+    dst.reserve(srcSize + srcSize / 255 + 16);
+
+    auto input = reinterpret_cast<const uint8_t *>(src);
+    size_t anchor = 0;
+    size_t position = 0;
+
+    if (srcSize > MF_LIMIT) {
+        std::vector<uint32_t> hashTable(1u << HASH_LOG, NO_POSITION);
+        size_t matchLimit = srcSize - MF_LIMIT;
+        size_t extendLimit = srcSize - LAST_LITERALS;
+
+        while (position < matchLimit) {
+            uint32_t sequence = read32(input + position);
+            uint32_t &slot = hashTable[hashSequence(sequence)];
+            size_t reference = slot;
+            slot = static_cast<uint32_t>(position);
+
+            if (reference == NO_POSITION || position - reference > MAX_OFFSET || read32(input + reference) != sequence) {
+                position++;
+                continue;
+            }
+
+            //grow the match backwards into pending literals, then forwards as far as allowed
+            while (position > anchor && reference > 0 && input[position - 1] == input[reference - 1]) {
+                position--;
+                reference--;
+            }
+            size_t matchLength = MIN_MATCH;
+            while (position + matchLength < extendLimit && input[position + matchLength] == input[reference + matchLength])
+                matchLength++;
+
+            emitSequence(dst, input + anchor, position - anchor, position - reference, matchLength);
+            position += matchLength;
+            anchor = position;
+        }
+    }
+
+    //last sequence carries only literals
+    size_t literalLength = srcSize - anchor;
+    dst.push_back(static_cast<char>((literalLength >= 15 ? 15 : literalLength) << 4));
+    if (literalLength >= 15)
+        writeLength(dst, literalLength - 15);
+    dst.insert(dst.end(), input + anchor, input + srcSize);
+}
+
+static bool readLength(const uint8_t *&ip, const uint8_t *iend, size_t &length) {
+    uint8_t byte;
+    do {
+        if (ip >= iend)
+            return false;
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool Lz4::decompress(const char *src, size_t srcSize, char *dst, size_t dstSize) {
+    auto ip = reinterpret_cast<const uint8_t *>(src);
+    auto iend = ip + srcSize;
+    auto op = reinterpret_cast<uint8_t *>(dst);
+    auto ostart = op;
+    auto oend = op + dstSize;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, iend, literalLength))
+            return false;
+        if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op))
+            return false;
+        memcpy(op, ip, literalLength);
+        op += literalLength;
+        ip += literalLength;
+
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - ostart))
+            return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(ip, iend, matchLength))
+            return false;
+        matchLength += MIN_MATCH;
+        if (matchLength > static_cast<size_t>(oend - op))
+            return false;
+
+        const uint8_t *match = op - offset;
+        if (offset >= matchLength) {
+            memcpy(op, match, matchLength);
+        } else {
+            //overlapping copy repeats the last offset bytes
+            for (size_t i = 0; i < matchLength; ++i)
+                op[i] = match[i];
+        }
+        op += matchLength;
+    }
+
+    return op == oend;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//LZ4 block format codec, streams written here can be read by the reference lz4 library and vice versa
+class Lz4 {
+public:
+    static void compress(const char *src, size_t srcSize, std::vector<char> &dst);
+    //returns false on malformed input or when the output doesnt fill dst exactly
+    static bool decompress(const char *src, size_t srcSize, char *dst, size_t dstSize);
+};
@@ -0,0 +1,101 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(uint32_t _workerCount) {
+    _workerCount = std::max(_workerCount, 1u);
+    workersList.reserve(_workerCount);
+    for (uint32_t i = 0; i < _workerCount; ++i) {
+        workersList.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (auto &worker : workersList) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> _job) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        jobsQueue.push(std::move(_job));
+        activeJobs++;
+    }
+    jobAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    jobsFinished.wait(lock, [this] { return activeJobs == 0; });
+}
+
+void ThreadPool::parallelFor(uint32_t _count, const std::function<void(uint32_t, uint32_t)> &_job) {
+    if (_count == 0)
+        return;
+
+    //ranges are claimed by whoever gets to them first, the caller included, so the call finishes even when every
+    //worker is busy with something else or the caller is a worker itself
+    struct Ranges {
+        uint32_t count = 0;
+        uint32_t rangeSize = 0;
+        uint32_t rangeCount = 0;
+        std::atomic<uint32_t> nextRange{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        uint32_t finishedRanges = 0;
+    };
+    auto ranges = std::make_shared<Ranges>();
+    ranges->count = _count;
+    ranges->rangeCount = std::min(_count, getWorkerCount() + 1);
+    ranges->rangeSize = (_count + ranges->rangeCount - 1) / ranges->rangeCount;
+    ranges->rangeCount = (_count + ranges->rangeSize - 1) / ranges->rangeSize;
+
+    //_job is only touched while a range is unfinished, the caller is still waiting then
+    auto runRanges = [ranges, &_job] {
+        uint32_t range;
+        while ((range = ranges->nextRange.fetch_add(1)) < ranges->rangeCount) {
+            uint32_t begin = range * ranges->rangeSize;
+            _job(begin, std::min(begin + ranges->rangeSize, ranges->count));
+            std::lock_guard<std::mutex> lock(ranges->mutex);
+            if (++ranges->finishedRanges == ranges->rangeCount)
+                ranges->finished.notify_all();
+        }
+    };
+    for (uint32_t helper = 1; helper < ranges->rangeCount; ++helper)
+        submit(runRanges);
+    runRanges();
+
+    std::unique_lock<std::mutex> lock(ranges->mutex);
+    ranges->finished.wait(lock, [&ranges] { return ranges->finishedRanges == ranges->rangeCount; });
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            jobAvailable.wait(lock, [this] { return stopping || !jobsQueue.empty(); });
+            if (stopping && jobsQueue.empty())
+                return;
+            job = std::move(jobsQueue.front());
+            jobsQueue.pop();
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            activeJobs--;
+            if (activeJobs == 0)
+                jobsFinished.notify_all();
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t _workerCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> _job);
+    //blocks until every submitted job has finished
+    void wait();
+    //splits [0, _count) into contiguous ranges and runs them on the workers and the calling thread, blocks until
+    //those ranges are done. other submitted jobs are not waited for, and it may be called from a job
+    void parallelFor(uint32_t _count, const std::function<void(uint32_t begin, uint32_t end)> &_job);
+
+    uint32_t getWorkerCount() const { return static_cast<uint32_t>(workersList.size()); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workersList;
+    std::queue<std::function<void()>> jobsQueue;
+
+    std::mutex queueMutex;
+    std::condition_variable jobAvailable;
+    std::condition_variable jobsFinished;
+    uint32_t activeJobs = 0;
+    bool stopping = false;
+};
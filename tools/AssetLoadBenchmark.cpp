@@ -0,0 +1,112 @@
+//cold cache load time of every .obj in a directory: blocking sequential reads vs pread pool vs io_uring. every file
+//goes through the app's own import, Builder::loadFromModelMemory
+//usage: AssetLoadBenchmark [models directory] [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/FileHelper.h"
+#include "../src/Graphics/Model.h"
+#include "../src/IO/BatchFileReader.h"
+
+static std::vector<std::string> listModels(const std::string &directory) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        throw std::runtime_error("cant open directory: " + directory);
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".obj") == 0)
+            files.push_back(directory + "/" + name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+//drop the clean pages of every file so the next read has to hit storage, works without root
+static void evictFromPageCache(const std::vector<std::string> &files) {
+    for (const auto &file : files) {
+        int fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0)
+            continue;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+//the app's own import of a model file, as the loaders run it
+static void importObj(const char *data, size_t size) {
+    Builder builder{};
+    builder.loadFromModelMemory(data, size);
+}
+
+static double measure(const std::vector<std::string> &files, uint32_t iterations, const std::function<void()> &load) {
+    std::vector<double> timesList;
+    for (uint32_t i = 0; i < iterations; ++i) {
+        evictFromPageCache(files);
+        auto start = std::chrono::high_resolution_clock::now();
+        load();
+        auto end = std::chrono::high_resolution_clock::now();
+        timesList.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(timesList.begin(), timesList.end());
+    return timesList[timesList.size() / 2];
+}
+
+int main(int argc, char **argv) {
+    std::string directory = argc > 1 ? argv[1] : "./models";
+    uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 5;
+
+    Logger log;
+    ThreadPool workers{};
+    auto files = listModels(directory);
+
+    size_t totalBytes = 0;
+    for (const auto &file : files)
+        totalBytes += FileHelper::readFile(file).size();
+    printf("%zu models, %.2f MiB, %u workers, median of %u cold runs\n",
+           files.size(), totalBytes / (1024.0 * 1024.0), workers.getWorkerCount(), iterations);
+
+    double sequential = measure(files, iterations, [&] {
+        for (const auto &file : files) {
+            auto bytes = FileHelper::readFile(file);
+            importObj(bytes.data(), bytes.size());
+        }
+    });
+    printf("%-24s %10.2f ms\n", "sequential read+decode", sequential);
+
+    auto batched = [&](bool preferIoUring, bool directIO) {
+        BatchFileReader reader{workers, log, preferIoUring};
+        reader.setDirectIO(directIO);
+        bool ioUring = reader.usesIoUring();
+        double time = measure(files, iterations, [&] {
+            for (const auto &file : files)
+                reader.enqueue(file, [](FileBlob &blob) { importObj(blob.data.get(), blob.size); });
+            reader.readAll();
+        });
+        return std::make_pair(ioUring, time);
+    };
+
+    auto pread = batched(false, false);
+    printf("%-24s %10.2f ms  (x%.2f)\n", "pread pool", pread.second, sequential / pread.second);
+
+    auto uring = batched(true, false);
+    if (uring.first) {
+        printf("%-24s %10.2f ms  (x%.2f)\n", "io_uring", uring.second, sequential / uring.second);
+        auto uringDirect = batched(true, true);
+        printf("%-24s %10.2f ms  (x%.2f)\n", "io_uring + O_DIRECT", uringDirect.second, sequential / uringDirect.second);
+    } else {
+        printf("io_uring not available on this kernel\n");
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+//builds a single file asset pack out of loose files and directories
+//usage: AssetPacker [--no-compress] <output.pak> <file or directory>...
+//entry names are the paths as given on the command line, so run it from the directory the app loads from
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "../src/IO/AssetPack.h"
+
+int main(int argc, char **argv) {
+    bool compress = true;
+    std::vector<std::string> argsList;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--no-compress") == 0)
+            compress = false;
+        else
+            argsList.emplace_back(argv[i]);
+    }
+
+    if (argsList.size() < 2) {
+        fprintf(stderr, "usage: %s [--no-compress] <output.pak> <file or directory>...\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, std::string>> filesList;
+    for (size_t i = 1; i < argsList.size(); ++i) {
+        std::filesystem::path input = argsList[i];
+        if (std::filesystem::is_directory(input)) {
+            for (const auto &entry : std::filesystem::recursive_directory_iterator(input)) {
+                if (entry.is_regular_file())
+                    filesList.emplace_back(entry.path().generic_string(), entry.path().string());
+            }
+        } else if (std::filesystem::is_regular_file(input)) {
+            filesList.emplace_back(input.generic_string(), input.string());
+        } else {
+            fprintf(stderr, "skipping missing input: %s\n", argsList[i].c_str());
+        }
+    }
+
+    try {
+        AssetPack::write(argsList[0], filesList, compress);
+
+        AssetPack pack{argsList[0]};
+        uint64_t originalBytes = 0;
+        uint64_t storedBytes = 0;
+        for (uint32_t i = 0; i < pack.getEntryCount(); ++i) {
+            const auto &entry = pack.getEntry(i);
+            originalBytes += entry.originalSize;
+            storedBytes += entry.storedSize;
+            printf("%-40s %10llu -> %10llu %s\n", pack.getName(entry).c_str(),
+                   static_cast<unsigned long long>(entry.originalSize),
+                   static_cast<unsigned long long>(entry.storedSize),
+                   entry.compression == AssetPack::COMPRESSION_LZ4 ? "lz4" : "raw");
+        }
+
+        uint32_t damaged = pack.verify();
+        if (damaged > 0) {
+            fprintf(stderr, "%u entries failed verification\n", damaged);
+            return 1;
+        }
+        printf("packed %u files: %llu -> %llu bytes (%llu on disk)\n", pack.getEntryCount(),
+               static_cast<unsigned long long>(originalBytes),
+               static_cast<unsigned long long>(storedBytes),
+               static_cast<unsigned long long>(std::filesystem::file_size(argsList[0])));
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+//runs the prefix_sum.comp sample kernel through ComputePipeline and checks it against a cpu reference.
+//needs a vulkan device with presentation, a software driver works, e.g. lavapipe under xvfb-run
+//usage: ComputeSample [value count <= 65536], run from the build directory so shaders/ is found
+
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "../src/Graphics/Buffer.h"
+#include "../src/Graphics/ComputePipeline.h"
+#include "../src/Graphics/Descriptors.h"
+
+struct PrefixSumPush {
+    uint32_t count;
+    uint32_t pass;
+};
+
+static constexpr uint32_t GROUP_SIZE = 256;
+
+int main(int argc, char **argv) {
+    uint32_t count = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 50000;
+    if (count == 0 || count > GROUP_SIZE * GROUP_SIZE) {
+        fprintf(stderr, "value count has to be in [1, %u]\n", GROUP_SIZE * GROUP_SIZE);
+        return 1;
+    }
+
+    Logger log;
+    Window window{64, 64, "ComputeSample"};
+    Device device{window, log};
+
+    try {
+        std::mt19937 random{1234};
+        std::vector<uint32_t> values(count);
+        for (auto &value : values)
+            value = random() % 1000;
+
+        std::vector<uint32_t> expected(count);
+        std::partial_sum(values.begin(), values.end(), expected.begin());
+
+        uint32_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+
+        Buffer inputBuffer{device, sizeof(uint32_t), count,
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+        inputBuffer.map();
+        inputBuffer.writeToBuffer(values.data());
+
+        Buffer outputBuffer{device, sizeof(uint32_t), count,
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+        outputBuffer.map();
+
+        Buffer totalsBuffer{device, sizeof(uint32_t), groupCount,
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT};
+
+        auto descriptorPool = lve::LveDescriptorPool::Builder(device)
+                .setMaxSets(1)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3)
+                .build();
+        auto setLayout = lve::LveDescriptorSetLayout::Builder(device)
+                .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                .build();
+
+        auto inputInfo = inputBuffer.descriptorInfo();
+        auto outputInfo = outputBuffer.descriptorInfo();
+        auto totalsInfo = totalsBuffer.descriptorInfo();
+        VkDescriptorSet descriptorSet;
+        if (!lve::LveDescriptorWriter(*setLayout, *descriptorPool)
+                .writeBuffer(0, &inputInfo)
+                .writeBuffer(1, &outputInfo)
+                .writeBuffer(2, &totalsInfo)
+                .build(descriptorSet)) {
+            throw std::runtime_error("cant allocate descriptor");
+        }
+
+        ComputePipeline prefixSum{device, "shaders/prefix_sum.comp.spv", {setLayout->getDescriptorSetLayout()},
+                                  sizeof(PrefixSumPush), log};
+
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        prefixSum.bind(commandBuffer);
+        prefixSum.bindDescriptorSets(commandBuffer, {descriptorSet});
+
+        PrefixSumPush push{count, 0};
+        prefixSum.pushConstants(commandBuffer, &push, sizeof(push));
+        ComputePipeline::dispatchThreads(commandBuffer, count, GROUP_SIZE);
+        ComputePipeline::computeToCompute(commandBuffer);
+
+        push.pass = 1;
+        prefixSum.pushConstants(commandBuffer, &push, sizeof(push));
+        ComputePipeline::dispatch(commandBuffer, 1);
+        ComputePipeline::computeToCompute(commandBuffer);
+
+        push.pass = 2;
+        prefixSum.pushConstants(commandBuffer, &push, sizeof(push));
+        ComputePipeline::dispatchThreads(commandBuffer, count, GROUP_SIZE);
+        ComputePipeline::computeToHost(commandBuffer);
+
+        if (device.endSingleTimeCommands(commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("cant submit compute work");
+
+        auto *result = static_cast<const uint32_t *>(outputBuffer.getMappedMemory());
+        uint32_t mismatches = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (result[i] != expected[i]) {
+                if (mismatches < 10)
+                    fprintf(stderr, "index %u: gpu %u, cpu %u\n", i, result[i], expected[i]);
+                mismatches++;
+            }
+        }
+
+        vkDeviceWaitIdle(device.getDevice());
+        if (mismatches > 0) {
+            fprintf(stderr, "prefix sum: %u of %u values differ from the cpu reference\n", mismatches, count);
+            return 1;
+        }
+        printf("prefix sum of %u values matches the cpu reference\n", count);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
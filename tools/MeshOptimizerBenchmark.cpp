@@ -0,0 +1,172 @@
+//acmr and atvr of every .obj in a directory as imported and after each optimization stage, with the time the stages
+//take, then the lod chain and the meshlets the importer would build from the result. the meshlets also go through
+//the cpu reference cull from six views around the mesh
+//usage: MeshOptimizerBenchmark [models directory] [cache size]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../src/Graphics/MeshOptimizer.h"
+#include "../src/Graphics/MeshSimplifier.h"
+#include "../src/Graphics/MeshletBuilder.h"
+
+static std::vector<std::string> listModels(const std::string &directory) {
+    std::vector<std::string> files;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        throw std::runtime_error("cant open directory: " + directory);
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".obj") == 0)
+            files.push_back(directory + "/" + name);
+    }
+    closedir(dir);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+//positions and faces are all the optimizer looks at, so corners are welded by their full v/vt/vn reference the way
+//the importer welds whole vertices, and faces are fanned into triangles
+static void loadObj(const std::string &path, std::vector<float> &positions, std::vector<uint32_t> &indices) {
+    std::ifstream file{path};
+    if (!file)
+        throw std::runtime_error("cant open " + path);
+
+    std::vector<float> objPositions;
+    std::unordered_map<std::string, uint32_t> weldedCorners;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream stream{line};
+        std::string type;
+        stream >> type;
+        if (type == "v") {
+            float x = 0, y = 0, z = 0;
+            stream >> x >> y >> z;
+            objPositions.insert(objPositions.end(), {x, y, z});
+        } else if (type == "f") {
+            std::vector<uint32_t> face;
+            std::string corner;
+            while (stream >> corner) {
+                auto it = weldedCorners.find(corner);
+                if (it == weldedCorners.end()) {
+                    long position = std::strtol(corner.c_str(), nullptr, 10);
+                    size_t objIndex = position < 0 ? objPositions.size() / 3 + position : static_cast<size_t>(position - 1);
+                    it = weldedCorners.emplace(corner, static_cast<uint32_t>(positions.size() / 3)).first;
+                    positions.insert(positions.end(), objPositions.begin() + objIndex * 3, objPositions.begin() + objIndex * 3 + 3);
+                }
+                face.push_back(it->second);
+            }
+            for (size_t i = 2; i < face.size(); ++i)
+                indices.insert(indices.end(), {face[0], face[i - 1], face[i]});
+        }
+    }
+}
+
+template<typename Function>
+static double measureMilliseconds(Function &&_function) {
+    auto start = std::chrono::high_resolution_clock::now();
+    _function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char **argv) {
+    std::string directory = argc > 1 ? argv[1] : "models";
+    uint32_t cacheSize = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : MeshOptimizer::CACHE_SIZE;
+
+    printf("fifo cache of %u vertices\n", cacheSize);
+    printf("%-22s %8s %8s | %-13s %-13s %-13s %-13s | %8s\n", "model", "tris", "verts",
+           "imported", "vertex cache", "overdraw", "fetch", "ms");
+    for (const auto &path : listModels(directory)) {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+        loadObj(path, positions, indices);
+        uint32_t vertexCount = static_cast<uint32_t>(positions.size() / 3);
+        if (indices.empty())
+            continue;
+
+        VertexCacheStats imported = MeshOptimizer::analyzeVertexCache(indices, vertexCount, cacheSize);
+        VertexCacheStats cacheOptimized{}, overdrawOptimized{}, fetchOptimized{};
+        std::vector<uint32_t> remap;
+        double milliseconds = measureMilliseconds([&] {
+            auto clusters = MeshOptimizer::optimizeVertexCache(indices, vertexCount, cacheSize);
+            cacheOptimized = MeshOptimizer::analyzeVertexCache(indices, vertexCount, cacheSize);
+            MeshOptimizer::optimizeOverdraw(indices, clusters, positions.data(), sizeof(float) * 3, vertexCount,
+                                            MeshOptimizer::OVERDRAW_THRESHOLD, cacheSize);
+            overdrawOptimized = MeshOptimizer::analyzeVertexCache(indices, vertexCount, cacheSize);
+            remap = MeshOptimizer::optimizeVertexFetch(indices, vertexCount);
+            fetchOptimized = MeshOptimizer::analyzeVertexCache(indices, vertexCount, cacheSize);
+        });
+
+        struct Position {
+            float xyz[3];
+        };
+        std::vector<Position> positionsList(positions.size() / 3);
+        std::copy(positions.begin(), positions.end(), &positionsList[0].xyz[0]);
+        MeshOptimizer::remapVertices(positionsList, remap, vertexCount);
+
+        std::string name = path.substr(path.find_last_of('/') + 1);
+        printf("%-22s %8zu %8zu | %5.3f/%5.3f   %5.3f/%5.3f   %5.3f/%5.3f   %5.3f/%5.3f   | %8.2f\n",
+               name.c_str(), indices.size() / 3, positions.size() / 3,
+               imported.acmr, imported.atvr, cacheOptimized.acmr, cacheOptimized.atvr,
+               overdrawOptimized.acmr, overdrawOptimized.atvr, fetchOptimized.acmr, fetchOptimized.atvr, milliseconds);
+
+        //the chain Builder::generateLods builds from the optimized mesh
+        std::vector<float> errorsList;
+        std::vector<std::vector<uint32_t>> levelsList;
+        double lodMilliseconds = measureMilliseconds([&] {
+            levelsList = MeshSimplifier::buildLodChain(indices, positionsList[0].xyz, sizeof(Position), vertexCount, errorsList);
+        });
+        float scale = MeshSimplifier::getScale(positionsList[0].xyz, sizeof(Position), vertexCount);
+        printf("  lods:");
+        for (size_t level = 0; level < levelsList.size(); ++level)
+            printf(" %zu tris (error %.4f)", levelsList[level].size() / 3, errorsList[level] * scale);
+        printf(" | %.2f ms", lodMilliseconds);
+        printf("\n");
+
+        //full level only, Builder::generateMeshlets splits every level that is large enough the same way
+        std::vector<uint32_t> meshletIndices = indices;
+        std::vector<Meshlet> meshletsList;
+        bool closed = MeshletBuilder::isClosed(meshletIndices, positionsList[0].xyz, sizeof(Position), vertexCount);
+        double meshletMilliseconds = measureMilliseconds([&] {
+            meshletsList = MeshletBuilder::build(meshletIndices, positionsList[0].xyz, sizeof(Position), vertexCount, closed);
+        });
+        size_t meshletVertices = 0;
+        for (const auto &meshlet : meshletsList)
+            meshletVertices += meshlet.vertexCount;
+        VertexCacheStats meshletCache = MeshOptimizer::analyzeVertexCache(meshletIndices, vertexCount, cacheSize);
+        printf("  meshlets: %zu, %.1f tris %.1f verts each, acmr %5.3f, %s", meshletsList.size(),
+               static_cast<double>(indices.size() / 3) / meshletsList.size(),
+               static_cast<double>(meshletVertices) / meshletsList.size(), meshletCache.acmr,
+               closed ? "closed" : "open, no cone culling");
+
+        //cameras on the axes at twice the mesh size, planes that keep everything so only the cones cull
+        const float planes[6][4] = {{0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}, {0, 0, 0, 1}};
+        MeshletCullStats cullStats{};
+        std::vector<uint8_t> visible(meshletsList.size());
+        for (int view = 0; view < 6; ++view) {
+            float camera[3] = {0.0f, 0.0f, 0.0f};
+            for (const auto &position : positionsList) {
+                for (int axis = 0; axis < 3; ++axis)
+                    camera[axis] += position.xyz[axis] / static_cast<float>(vertexCount);
+            }
+            camera[view / 2] += (view % 2 == 0 ? 2.0f : -2.0f) * scale;
+            MeshletBuilder::cull(meshletsList.data(), static_cast<uint32_t>(meshletsList.size()), camera, planes,
+                                 visible.data(), cullStats);
+        }
+        printf(", %.1f%% of meshlets %.1f%% of triangles back facing | %.2f ms\n",
+               100.0 * cullStats.backfaceCulled / cullStats.meshlets,
+               100.0 * cullStats.trianglesCulled / (6.0 * static_cast<double>(indices.size() / 3)), meshletMilliseconds);
+    }
+    printf("columns are acmr/atvr\n");
+    return 0;
+}
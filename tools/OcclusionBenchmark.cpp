@@ -0,0 +1,111 @@
+//cost of the software occlusion culler: occluder rasterization per 1k triangles, single threaded and on the
+//job workers, and the box tests against the result
+//usage: OcclusionBenchmark [occluder triangles] [tested boxes] [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_TO_ZERO
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../src/Graphics/SoftwareOcclusionCuller.h"
+#include "../src/Jobs/ThreadPool.h"
+
+//a flat wall in the xy plane split into _cells x _cells quads, the typical shape of a good occluder
+static std::shared_ptr<OccluderMesh> createWall(uint32_t _cells) {
+    auto mesh = std::make_shared<OccluderMesh>();
+    for (uint32_t y = 0; y <= _cells; ++y) {
+        for (uint32_t x = 0; x <= _cells; ++x)
+            mesh->positions.emplace_back(static_cast<float>(x) / _cells - 0.5f, static_cast<float>(y) / _cells - 0.5f, 0.0f);
+    }
+    for (uint32_t y = 0; y < _cells; ++y) {
+        for (uint32_t x = 0; x < _cells; ++x) {
+            uint32_t corner = y * (_cells + 1) + x;
+            mesh->indices.insert(mesh->indices.end(), {corner, corner + 1, corner + _cells + 2,
+                                                       corner, corner + _cells + 2, corner + _cells + 1});
+        }
+    }
+    return mesh;
+}
+
+template<typename Function>
+static double averageMicroseconds(uint32_t _iterations, Function &&_function) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < _iterations; ++i)
+        _function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / _iterations;
+}
+
+int main(int argc, char **argv) {
+    uint32_t triangleTarget = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 20000;
+    uint32_t boxCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 10000;
+    uint32_t iterations = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 200;
+
+    constexpr uint32_t WALL_CELLS = 8;
+    auto wall = createWall(WALL_CELLS);
+    uint32_t trianglesPerWall = WALL_CELLS * WALL_CELLS * 2;
+    uint32_t wallCount = std::max(1u, triangleTarget / trianglesPerWall);
+
+    std::mt19937 random{1234};
+    std::uniform_real_distribution<float> spread{-20.0f, 20.0f};
+    std::uniform_real_distribution<float> distance{-60.0f, -5.0f};
+    std::uniform_real_distribution<float> wallSize{2.0f, 8.0f};
+    std::uniform_real_distribution<float> boxSize{0.2f, 2.0f};
+
+    std::vector<OccluderInstance> occluders;
+    for (uint32_t i = 0; i < wallCount; ++i) {
+        OccluderInstance occluder{};
+        occluder.mesh = wall;
+        float size = wallSize(random);
+        occluder.modelMatrix = glm::translate(glm::mat4(1.0f), {spread(random), spread(random) * 0.25f, distance(random)});
+        occluder.modelMatrix[0][0] = size;
+        occluder.modelMatrix[1][1] = size;
+        occluders.push_back(occluder);
+    }
+
+    std::vector<OcclusionBounds> boxes(boxCount);
+    for (auto &box : boxes) {
+        glm::vec3 center{spread(random), spread(random) * 0.25f, distance(random) - 10.0f};
+        float size = boxSize(random);
+        box.min = center - glm::vec3(size);
+        box.max = center + glm::vec3(size);
+    }
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3{0.0f}, glm::vec3{0.0f, 0.0f, -1.0f}, glm::vec3{0.0f, 1.0f, 0.0f});
+    glm::mat4 projectionView = projection * view;
+
+    SoftwareOcclusionCuller culler{};
+    ThreadPool workers{};
+
+    double serial = averageMicroseconds(iterations, [&] { culler.renderOccluders(projectionView, occluders); });
+    double parallel = averageMicroseconds(iterations, [&] { culler.renderOccluders(projectionView, occluders, &workers); });
+
+    uint32_t occluded = 0;
+    double tests = averageMicroseconds(iterations, [&] {
+        occluded = 0;
+        for (const auto &box : boxes)
+            occluded += culler.isVisible(box.min, box.max) ? 0 : 1;
+    });
+
+    double async = averageMicroseconds(iterations, [&] {
+        culler.cullAsync(workers, projectionView, occluders, boxes);
+        culler.waitForResults();
+    });
+
+    const auto &stats = culler.getStats();
+    double thousands = stats.occluderTriangles / 1000.0;
+    printf("buffer %ux%u, %u occluder triangles (%u rasterized), %u workers\n",
+           culler.getWidth(), culler.getHeight(), stats.occluderTriangles, stats.rasterizedTriangles, workers.getWorkerCount());
+    printf("rasterize, 1 thread:   %9.1f us, %7.2f us per 1k triangles\n", serial, serial / thousands);
+    printf("rasterize, workers:    %9.1f us, %7.2f us per 1k triangles\n", parallel, parallel / thousands);
+    printf("test %u boxes:      %9.1f us, %u occluded\n", boxCount, tests, occluded);
+    printf("async frame:           %9.1f us, %u of %u occluded\n", async, stats.occludedObjects, stats.testedObjects);
+    return 0;
+}
@@ -0,0 +1,95 @@
+//cost of building model and normal matrices: TransformationPrimitive's per object FAST methods against
+//TransformSystem with every transform dirty and with a few of them dirty, at 10k, 100k and 1M objects
+//usage: TransformBenchmark [iterations] [dirty percent]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../src/Graphics/TransformSystem.h"
+
+template<typename Function>
+static double averageMicroseconds(uint32_t _iterations, Function &&_function) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < _iterations; ++i)
+        _function();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / _iterations;
+}
+
+int main(int argc, char **argv) {
+    uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 20;
+    double dirtyPercent = argc > 2 ? std::strtod(argv[2], nullptr) : 1.0;
+
+    std::mt19937 random{1234};
+    std::uniform_real_distribution<float> position{-100.0f, 100.0f};
+    std::uniform_real_distribution<float> angle{-6.3f, 6.3f};
+    std::uniform_real_distribution<float> scale{0.1f, 4.0f};
+    std::uniform_real_distribution<float> chance{0.0f, 100.0f};
+
+    printf("%u lanes, %u iterations, %.1f%% dirty in the partial update\n", TransformSystem::LANES, iterations, dirtyPercent);
+    for (uint32_t count : {10000u, 100000u, 1000000u}) {
+        std::vector<TransformationPrimitive> primitives(count);
+        for (auto &primitive : primitives) {
+            primitive.translation = {position(random), position(random), position(random)};
+            primitive.rotation = {angle(random), angle(random), angle(random)};
+            primitive.scaleVector = {scale(random), scale(random), scale(random)};
+        }
+
+        std::vector<glm::mat4> modelMatrices(count);
+        std::vector<glm::mat3> normalMatrices(count);
+        double perObject = averageMicroseconds(iterations, [&] {
+            for (uint32_t i = 0; i < count; ++i) {
+                modelMatrices[i] = primitives[i].getTransformationMatrixFAST();
+                normalMatrices[i] = primitives[i].getNormalMatrix();
+            }
+        });
+
+        TransformSystem system;
+        system.resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+            system.set(i, primitives[i]);
+        double all = averageMicroseconds(iterations, [&] {
+            system.markAllDirty();
+            system.update();
+        });
+
+        //the same objects move every iteration, set has to find them among all the others
+        std::vector<uint32_t> moving;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (chance(random) < dirtyPercent)
+                moving.push_back(i);
+        }
+        float step = 0.0f;
+        double partial = averageMicroseconds(iterations, [&] {
+            step += 0.01f;
+            for (uint32_t i : moving)
+                primitives[i].rotation.y += step;
+            for (uint32_t i = 0; i < count; ++i)
+                system.set(i, primitives[i]);
+            system.update();
+        });
+
+        //the polynomials against the library sin and cos
+        float modelError = 0.0f;
+        float normalError = 0.0f;
+        for (uint32_t i = 0; i < count; ++i) {
+            glm::mat4 model = primitives[i].getTransformationMatrixFAST();
+            glm::mat3 normal = primitives[i].getNormalMatrix();
+            for (int column = 0; column < 3; ++column) {
+                for (int row = 0; row < 3; ++row) {
+                    modelError = std::max(modelError, std::abs(model[column][row] - system.getModelMatrix(i)[column][row]));
+                    normalError = std::max(normalError, std::abs(normal[column][row] - system.getNormalMatrix(i)[column][row]));
+                }
+            }
+        }
+
+        printf("%7u objects: per object %9.1f us, system all dirty %9.1f us (%.2fx), %u dirty %9.1f us; max error model %.2e normal %.2e\n",
+               count, perObject, all, perObject / all, system.getStats().updated, partial, modelError, normalError);
+    }
+    return 0;
+}